@@ -148,14 +148,14 @@ void st7796s_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_
 	st7796s_send_color((void *)color_map, size * 2);
 }
 
-void st7796s_sleep_in()
+void st7796s_sleep_in(void)
 {
 	uint8_t data[] = {0x08};
 	st7796s_send_cmd(0x10);
 	st7796s_send_data(&data, 1);
 }
 
-void st7796s_sleep_out()
+void st7796s_sleep_out(void)
 {
 	uint8_t data[] = {0x08};
 	st7796s_send_cmd(0x11);
@@ -111,6 +111,8 @@ extern "C"
 
   void st7796s_init(void);
   void st7796s_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
+  void st7796s_sleep_in(void);
+  void st7796s_sleep_out(void);
 
   /**********************
  *      MACROS
@@ -10,5 +10,23 @@
 #define APP_CONFIG_FIRMWARE_VERSION_PATCH 3U
 
 #define APP_CONFIG_TASK_SIZE 512
+// Core of the networking tasks; sdkconfig pins the main loop, which renders the interface, to the other one
+#define APP_CONFIG_NETWORK_CORE 0
+
+// RAM reserved for the alarm table and the descriptions, in bytes; the host benchmarks raise it to time larger tables
+#ifndef APP_CONFIG_ALARM_STORE_BUDGET
+#define APP_CONFIG_ALARM_STORE_BUDGET (32 * 1024)
+#endif
+
+// Times the phases of the main loop, see controller/loop_profiler.h; the simulator enables it from SConstruct
+#ifndef APP_CONFIG_LOOP_PROFILER
+#define APP_CONFIG_LOOP_PROFILER 0
+#endif
+
+#define APP_CONFIG_TIMEZONE "UTC-1CEST,M3.5.0,M10.5.0/3"
+
+// Default location of the solar schedule, in hundredths of a degree
+#define APP_CONFIG_LATITUDE  4190
+#define APP_CONFIG_LONGITUDE 1250
 
 #endif
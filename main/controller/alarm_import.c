@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "cJSON.h"
+#include "alarm_import.h"
+#include <esp_log.h>
+
+
+static int read_number(const cJSON *object, const char *key, double min, double max, double *value);
+
+
+static const char *TAG = "AlarmImport";
+
+
+/*
+ * Reads a JSON array of alarms like
+ *   [{"timestamp": 1711627200, "recurrence": 0, "weekdays": 0, "duration": 30, "description": "Dentist"}]
+ * where only the timestamp is required. Items that are not objects or have out of range fields are skipped; the
+ * model validates the rest when the alarms are added.
+ * Returns 0 on success, -1 if the JSON is not an array or memory runs out
+ */
+int alarm_import_parse(alarm_import_t *import, const char *json, size_t length) {
+    assert(import != NULL && json != NULL);
+    import->records = NULL;
+    import->count   = 0;
+
+    cJSON *array = cJSON_ParseWithLength(json, length);
+    if (!cJSON_IsArray(array)) {
+        ESP_LOGW(TAG, "Not a JSON array of alarms");
+        cJSON_Delete(array);
+        return -1;
+    }
+
+    size_t size = cJSON_GetArraySize(array);
+    if (size > 0 && (import->records = calloc(size, sizeof(alarm_record_t))) == NULL) {
+        cJSON_Delete(array);
+        return -1;
+    }
+
+    const cJSON *item     = NULL;
+    size_t       position = 0;
+    cJSON_ArrayForEach(item, array) {
+        double timestamp = 0, recurrence = ALARM_RECURRENCE_NONE, weekdays = 0, duration = 0;
+        if (!cJSON_IsObject(item) || read_number(item, "timestamp", 1, UINT32_MAX, &timestamp) ||
+            read_number(item, "recurrence", 0, ALARM_RECURRENCE_NUM - 1, &recurrence) ||
+            read_number(item, "weekdays", 0, 0x7F, &weekdays) ||
+            read_number(item, "duration", 0, UINT16_MAX, &duration)) {
+            ESP_LOGW(TAG, "Skipping item %zu", position++);
+            continue;
+        }
+        position++;
+
+        const cJSON *description = cJSON_GetObjectItemCaseSensitive(item, "description");
+        const char  *string      = cJSON_IsString(description) ? description->valuestring : "";
+        char        *copy        = malloc(strnlen(string, MAX_DESCRIPTION_LEN) + 1);
+        if (copy == NULL) {
+            cJSON_Delete(array);
+            alarm_import_release(import);
+            return -1;
+        }
+        snprintf(copy, MAX_DESCRIPTION_LEN + 1, "%s", string);
+
+        import->records[import->count++] = (alarm_record_t){
+            .timestamp   = (uint64_t)timestamp,
+            .recurrence  = (uint8_t)recurrence,
+            .weekdays    = (uint8_t)weekdays,
+            .duration    = (uint16_t)duration,
+            .description = copy,
+        };
+    }
+
+    cJSON_Delete(array);
+    return 0;
+}
+
+
+void alarm_import_release(alarm_import_t *import) {
+    assert(import != NULL);
+    for (size_t i = 0; i < import->count; i++) {
+        free((char *)import->records[i].description);
+    }
+    free(import->records);
+    import->records = NULL;
+    import->count   = 0;
+}
+
+
+/*
+ * A missing key keeps the default in `value`; a key that is not a whole number in range is an error
+ */
+static int read_number(const cJSON *object, const char *key, double min, double max, double *value) {
+    const cJSON *number = cJSON_GetObjectItemCaseSensitive(object, key);
+    if (number == NULL) {
+        return 0;
+    }
+    if (!cJSON_IsNumber(number) || number->valuedouble < min || number->valuedouble > max ||
+        number->valuedouble != (double)(uint64_t)number->valuedouble) {
+        return -1;
+    }
+    *value = number->valuedouble;
+    return 0;
+}
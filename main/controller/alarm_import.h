@@ -0,0 +1,20 @@
+#ifndef ALARM_IMPORT_H_INCLUDED
+#define ALARM_IMPORT_H_INCLUDED
+
+
+#include <stdlib.h>
+#include "model/model.h"
+
+
+// Alarms received in bulk, owning their descriptions
+typedef struct {
+    alarm_record_t *records;
+    size_t          count;
+} alarm_import_t;
+
+
+int  alarm_import_parse(alarm_import_t *import, const char *json, size_t length);
+void alarm_import_release(alarm_import_t *import);
+
+
+#endif
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "services/system_time.h"
+#include "view/view_event.h"
+#include "alarm_scheduler.h"
+#include "wakeup.h"
+#include "standby.h"
+#include <esp_log.h>
+
+
+// Longest sleep between two checks; keeps the tick based timer from drifting too far from the wall clock
+#define MAX_SLEEP_MS (60UL * 60UL * 1000UL)
+// Difference between wall clock and tick count that counts as a clock step
+#define CLOCK_STEP_MS 1000LL
+
+
+static void timer_cb(TimerHandle_t timer);
+static void arm(model_t *pmodel, int64_t now_ms);
+
+
+static const char      *TAG              = "AlarmScheduler";
+static TimerHandle_t    timer            = NULL;
+static volatile uint8_t fired            = 0;
+static uint64_t         checked_until    = 0;     // Alarms due up to this second (included) were already notified
+static uint32_t         armed_generation = 0;
+static int64_t          clock_offset_ms  = 0;
+
+
+/*
+ * Arms a single one shot timer for the next due alarm (or the end of the day, whichever comes first)
+ * and notifies the view with VIEW_EVENT_TAG_ALARM_DUE when it fires
+ */
+void alarm_scheduler_init(model_t *pmodel) {
+    static StaticTimer_t timer_buffer;
+    timer = xTimerCreateStatic(TAG, 1, pdFALSE, NULL, timer_cb, &timer_buffer);
+
+    int64_t now_ms  = clock_now_millis();
+    checked_until   = now_ms / 1000;
+    clock_offset_ms = now_ms - (int64_t)get_millis();
+    arm(pmodel, now_ms);
+}
+
+
+void alarm_scheduler_manage(model_t *pmodel) {
+    int64_t now_ms = clock_now_millis();
+    uint8_t rearm  = 0;
+
+    int64_t offset_ms = now_ms - (int64_t)get_millis();
+    if (llabs(offset_ms - clock_offset_ms) > CLOCK_STEP_MS) {
+        // Alarms skipped by a jump forward are not rung; the model already moved to the new day if needed
+        ESP_LOGI(TAG, "Clock step of %lli ms", (long long)(offset_ms - clock_offset_ms));
+        clock_offset_ms = offset_ms;
+        checked_until   = now_ms / 1000;
+        rearm           = 1;
+    }
+
+    if (fired) {
+        fired = 0;
+
+        // Alarms due in the same second are told apart by their number, all of them ring
+        size_t   alarm_num  = SIZE_MAX;
+        uint64_t occurrence = checked_until;
+        while (model_get_following_alarm(pmodel, &alarm_num, &occurrence) && occurrence * 1000 <= (uint64_t)now_ms) {
+            ESP_LOGI(TAG, "Alarm %zu due, notified %lli ms late", alarm_num,
+                     (long long)(now_ms - (int64_t)occurrence * 1000));
+            view_event((view_event_t){.tag = VIEW_EVENT_TAG_ALARM_DUE, .as.alarm_due.num = alarm_num});
+            // Lights the display up, even if it went dark
+            standby_poke();
+            checked_until = occurrence;
+        }
+        rearm = 1;
+    }
+
+    if (model_get_field_generation(pmodel, MODEL_FIELD_ALARMS) != armed_generation) {
+        rearm = 1;
+    }
+
+    if (rearm) {
+        arm(pmodel, now_ms);
+    }
+}
+
+
+static void arm(model_t *pmodel, int64_t now_ms) {
+    int64_t  deadline_ms = now_ms + MAX_SLEEP_MS;
+    size_t   alarm_num   = 0;
+    uint64_t occurrence  = 0;
+
+    if (model_get_next_alarm_after(pmodel, checked_until, &alarm_num, &occurrence) &&
+        (int64_t)occurrence * 1000 < deadline_ms) {
+        deadline_ms = occurrence * 1000;
+    }
+    // Recurring alarms move on to their next occurrence when the day changes
+    if (model_get_today_end(pmodel) > 0 && (int64_t)model_get_today_end(pmodel) * 1000 < deadline_ms) {
+        deadline_ms = model_get_today_end(pmodel) * 1000;
+    }
+
+    // The clock may run faster than the ticks in the simulator
+    TickType_t ticks = deadline_ms > now_ms ? pdMS_TO_TICKS(clock_to_real_millis(deadline_ms - now_ms)) : 0;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    armed_generation = model_get_field_generation(pmodel, MODEL_FIELD_ALARMS);
+    xTimerChangePeriod(timer, ticks, 0);
+}
+
+
+static void timer_cb(TimerHandle_t timer) {
+    (void)timer;
+    // Runs in the timer task: the model is only touched by the controller
+    fired = 1;
+    wakeup_notify();
+}
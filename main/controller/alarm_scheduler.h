@@ -0,0 +1,12 @@
+#ifndef ALARM_SCHEDULER_H_INCLUDED
+#define ALARM_SCHEDULER_H_INCLUDED
+
+
+#include "model/model.h"
+
+
+void alarm_scheduler_init(model_t *pmodel);
+void alarm_scheduler_manage(model_t *pmodel);
+
+
+#endif
@@ -1,30 +1,68 @@
 #include "controller.h"
 #include "model/model.h"
+#include "snapshot.h"
 #include "view/view.h"
 #include "gui.h"
 #include "observer.h"
 #include "standby.h"
+#include "alarm_scheduler.h"
+#include "alarm_import.h"
 #include "persistance.h"
+#include "wakeup.h"
+#include "timer_wheel.h"
+#include "service_task.h"
+#include "loop_profiler.h"
 #include "services/network.h"
 #include "services/server.h"
 #include "services/google_calendar.h"
 #include "services/system_time.h"
-#include "services/github.h"
 #include "peripherals/system.h"
 #include <esp_log.h>
 
 
+// Longest sleep of the main loop, so that a step of the wall clock is noticed within a second
+#define MAX_TIMEOUT_MS 1000UL
+
+#define CALENDAR_PERIOD_MS         10000UL
+#define RELEASE_CHECK_PERIOD_MS    (12UL * 3600UL * 1000UL)
+#define RELEASE_CHECK_RETRY_MS     (1UL * 3600UL * 1000UL)
+#define RELEASE_CHECK_JITTER_MS    (10UL * 60UL * 1000UL)
+
+
+static timer_wheel_outcome_t calendar_job_cb(void *arg);
+static timer_wheel_outcome_t release_check_job_cb(void *arg);
+static void                  manage_service_events(mut_model_t *pmodel);
+static unsigned long         earliest(unsigned long wait, unsigned long clock_timeout);
+static size_t                import_alarms(model_updater_t updater, const alarm_record_t *records, size_t count);
+
+
 static const char *TAG = "Controller";
 
+// Periodic jobs of the main loop; they run from controller_manage only
+static timer_wheel_t     wheel;
+static timer_wheel_job_t calendar_job;
+static timer_wheel_job_t release_check_job;
+
 
 void controller_init(model_updater_t updater) {
-    (void)updater;
+    mut_model_t *pmodel = model_updater_read(updater);
 
     network_init();
     server_init();
     google_calendar_init();
 
-    observer_init(model_updater_read(updater));
+    wakeup_init();
+    service_task_init();
+    timer_wheel_init(&wheel, get_millis());
+    // Both are started when the network connects and stop by themselves when it goes away
+    timer_wheel_job_init(&calendar_job, calendar_job_cb, pmodel, CALENDAR_PERIOD_MS, 0, 0, 0);
+    timer_wheel_job_init(&release_check_job, release_check_job_cb, pmodel, RELEASE_CHECK_PERIOD_MS,
+                         RELEASE_CHECK_JITTER_MS, RELEASE_CHECK_RETRY_MS, RELEASE_CHECK_PERIOD_MS);
+    standby_init(&wheel, pmodel);
+
+    observer_init(pmodel);
+    snapshot_publish(pmodel);
+    alarm_scheduler_init(pmodel);
     network_start_sta();
 
     view_change_page(&page_main);
@@ -52,7 +90,7 @@ void controller_process_message(pman_handle_t handle, void *msg) {
                 break;
 
             case VIEW_CONTROLLER_MESSAGE_TAG_SAVE_ALARM:
-                persistance_save_alarm(cmsg->as.save_alarm.num, model_get_alarm(pmodel, cmsg->as.save_alarm.num));
+                persistance_save_alarm(pmodel, cmsg->as.save_alarm.num);
                 break;
 
             case VIEW_CONTROLLER_MESSAGE_TAG_RESET:
@@ -60,52 +98,176 @@ void controller_process_message(pman_handle_t handle, void *msg) {
                 break;
 
             case VIEW_CONTROLLER_MESSAGE_TAG_OTA:
-                github_ota(pmodel);
+                service_task_start_ota();
                 break;
         }
-        lv_mem_free(cmsg);
+        view_controller_msg_release(cmsg);
     }
 }
 
 
-void controller_manage(model_updater_t updater) {
-    static unsigned long timestamp          = 0;
-    static unsigned long update_ts          = 0;
-    static uint8_t       first_update_check = 1;
-    mut_model_t         *pmodel             = model_updater_read(updater);
+/*
+ * Returns how long the main loop can sleep, in milliseconds of real time. Other tasks cut the sleep short with
+ * wakeup_notify
+ */
+unsigned long controller_manage(model_updater_t updater) {
+    mut_model_t  *pmodel = model_updater_read(updater);
+    unsigned long wait   = MAX_TIMEOUT_MS;
+    LOOP_PROFILER_BEGIN();
 
     if (model_get_wifi_state(pmodel) == WIFI_STATE_CONNECTED) {
-        if (is_expired(timestamp, get_millis(), 10000UL)) {
-            // ESP_LOGI(TAG, "Attempting http request");
-            // google_calendar_example();
-            timestamp = get_millis();
+        if (!timer_wheel_is_armed(&calendar_job)) {
+            timer_wheel_start(&wheel, &calendar_job, 0, get_millis());
         }
-
-        unsigned long timeout = pmodel->run.latest_release_request_state == HTTP_REQUEST_STATE_ERROR
-                                    ? 1UL * 3600UL * 1000UL
-                                    : 12UL * 3600UL * 1000UL;
-        if (is_expired(update_ts, get_millis(), timeout) || first_update_check) {
-            github_request_latest_release(pmodel);
-            first_update_check = 0;
-            update_ts          = get_millis();
+        if (!timer_wheel_is_armed(&release_check_job)) {
+            timer_wheel_start(&wheel, &release_check_job, 0, get_millis());
         }
     }
+    timer_wheel_dispatch(&wheel, get_millis());
+    manage_service_events(pmodel);
+    LOOP_PROFILER_MARK(TIMERS);
+
+    model_updater_refresh_today(updater);
+    model_updater_refresh_night_mode(updater);
+    model_updater_refresh_world_clock(updater);
+    model_updater_refresh_solar_schedule(updater);
+    alarm_scheduler_manage(pmodel);
+    LOOP_PROFILER_MARK(MODEL);
 
     network_get_state(updater);
     if (network_get_scan_result(updater)) {
         view_event((view_event_t){.tag = VIEW_EVENT_TAG_WIFI_SCAN_DONE});
     }
 
-    pmodel->run.server_firmware_update_state = server_firmware_update_state();
+    alarm_import_t import = {0};
+    if (server_take_alarm_import(&import)) {
+        import_alarms(updater, import.records, import.count);
+        alarm_import_release(&import);
+    }
+
+    model_updater_set_server_firmware_update_state(updater, server_firmware_update_state());
     if ((pmodel->run.server_firmware_update_state.tag != FIRMWARE_UPDATE_STATE_TAG_NONE ||
          pmodel->run.client_firmware_update_state.tag != FIRMWARE_UPDATE_STATE_TAG_NONE) &&
         !view_is_current_page_id(VIEW_PAGE_ID_OTA)) {
         view_change_page(&page_ota);
     }
+    LOOP_PROFILER_MARK(NETWORK);
 
-    controller_gui_manage();
+    uint32_t gui_timeout = controller_gui_manage();
+    LOOP_PROFILER_MARK(GUI);
     observer_manage();
+    LOOP_PROFILER_MARK(OBSERVER);
     standby_manage(pmodel);
+    LOOP_PROFILER_MARK(STANDBY);
     view_manage();
-    github_manage(pmodel);
+    LOOP_PROFILER_MARK(VIEW);
+
+    // Last, so that other tasks see everything that changed in this iteration
+    snapshot_publish(pmodel);
+
+    if (gui_timeout < wait) {
+        wait = gui_timeout;
+    }
+    wait = earliest(wait, observer_get_timeout());
+    wait = earliest(wait, timer_wheel_get_timeout(&wheel, get_millis()));
+
+    int64_t  now_ms  = clock_now_millis();
+    uint64_t refresh = model_get_next_refresh(pmodel);
+    wait             = earliest(wait, (int64_t)refresh * 1000 > now_ms ? refresh * 1000 - now_ms : 0);
+    LOOP_PROFILER_MARK(SNAPSHOT);
+    LOOP_PROFILER_END();
+
+    return wait;
+}
+
+
+/*
+ * Adds many alarms at once: they are indexed once and saved in a single storage transaction.
+ * Returns how many were imported; invalid records are skipped
+ */
+static size_t import_alarms(model_updater_t updater, const alarm_record_t *records, size_t count) {
+    model_updater_begin_alarm_batch(updater);
+    for (size_t i = 0; i < count; i++) {
+        if (model_updater_batch_add_alarm(updater, &records[i]) < 0) {
+            ESP_LOGW(TAG, "Skipping alarm %zu of the import", i);
+        }
+    }
+
+    const uint16_t *alarms   = NULL;
+    size_t          imported = model_updater_commit_alarm_batch(updater, &alarms);
+    model_t        *pmodel   = model_updater_read(updater);
+
+    persistance_begin_transaction();
+    for (size_t i = 0; i < imported; i++) {
+        persistance_save_alarm(pmodel, alarms[i]);
+    }
+    // The number of alarms is saved right away by the observer, so it becomes part of the same transaction
+    observer_manage();
+    persistance_commit_transaction();
+
+    ESP_LOGI(TAG, "Imported %zu out of %zu alarms", imported, count);
+    return imported;
+}
+
+
+static timer_wheel_outcome_t calendar_job_cb(void *arg) {
+    model_t *pmodel = arg;
+    if (model_get_wifi_state(pmodel) != WIFI_STATE_CONNECTED) {
+        return TIMER_WHEEL_JOB_STOP;
+    }
+
+    // ESP_LOGI(TAG, "Attempting http request");
+    // google_calendar_example();
+    return TIMER_WHEEL_JOB_DONE;
+}
+
+
+/*
+ * The outcome is known when the service task reports the end of the request
+ */
+static timer_wheel_outcome_t release_check_job_cb(void *arg) {
+    model_t *pmodel = arg;
+    if (model_get_wifi_state(pmodel) != WIFI_STATE_CONNECTED) {
+        return TIMER_WHEEL_JOB_STOP;
+    }
+
+    service_task_request_latest_release();
+    return TIMER_WHEEL_JOB_PENDING;
+}
+
+
+/*
+ * Applies what the service task did since the last iteration
+ */
+static void manage_service_events(mut_model_t *pmodel) {
+    github_event_t event;
+
+    while (service_task_get_event(&event)) {
+        switch (event.tag) {
+            case GITHUB_EVENT_TAG_LATEST_RELEASE:
+                model_set_latest_release_state(pmodel, event.as.latest_release.state, event.as.latest_release.major,
+                                               event.as.latest_release.minor, event.as.latest_release.patch);
+                if (event.as.latest_release.state != HTTP_REQUEST_STATE_WAITING) {
+                    timer_wheel_complete(&wheel, &release_check_job,
+                                         event.as.latest_release.state == HTTP_REQUEST_STATE_ERROR
+                                             ? TIMER_WHEEL_JOB_FAILED
+                                             : TIMER_WHEEL_JOB_DONE,
+                                         get_millis());
+                }
+                break;
+
+            case GITHUB_EVENT_TAG_FIRMWARE_UPDATE:
+                model_set_client_firmware_update_state(pmodel, event.as.firmware_update);
+                break;
+        }
+    }
+}
+
+
+/*
+ * `clock_timeout` is in clock time, which runs faster than real time in the simulator
+ */
+static unsigned long earliest(unsigned long wait, unsigned long clock_timeout) {
+    unsigned long real_timeout = clock_to_real_millis(clock_timeout);
+    return real_timeout < wait ? real_timeout : wait;
 }
@@ -6,9 +6,9 @@
 #include "view/view.h"
 
 
-void controller_init(model_updater_t updater);
-void controller_manage(model_updater_t updater);
-void controller_process_message(pman_handle_t handle, void *msg);
+void          controller_init(model_updater_t updater);
+unsigned long controller_manage(model_updater_t updater);
+void          controller_process_message(pman_handle_t handle, void *msg);
 
 
 #endif
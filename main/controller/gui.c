@@ -1,24 +1,104 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "model/model.h"
 #include "view/view.h"
 #include "controller.h"
+#include "gui.h"
 #include "esp_log.h"
 #include "services/system_time.h"
+#include "peripherals/tft.h"
 #include "lvgl.h"
 
 
-static const char *TAG = "Gui";
+static uint32_t read_touch(unsigned long now);
+static void     enable_invalidation(lv_disp_t *disp, uint8_t enable);
 
 
-void controller_gui_manage(void) {
-    (void)TAG;
+static const char *TAG  = "Gui";
+static uint8_t     dark = 0;
+
+
+/*
+ * Returns the milliseconds until LVGL needs to run again
+ */
+uint32_t controller_gui_manage(void) {
     static unsigned long last_invoked = 0;
+    // LVGL follows the real time even when the simulated clock is sped up
+    unsigned long now = xTaskGetTickCount() * portTICK_PERIOD_MS;
 
-    if (last_invoked != get_millis()) {
+    if (last_invoked != now) {
         if (last_invoked > 0) {
-            lv_tick_inc(time_interval(last_invoked, get_millis()));
+            lv_tick_inc(time_interval(last_invoked, now));
         }
-        last_invoked = get_millis();
+        last_invoked = now;
+    }
+
+    if (dark) {
+        return read_touch(now);
+    } else {
+        return lv_timer_handler();
+    }
+}
+
+
+/*
+ * While dark LVGL neither runs its timers nor invalidates, draws or flushes anything, and the panel sleeps; only the
+ * touch is read, so that it can wake the display. Leaving redraws the whole screen once
+ */
+void controller_gui_set_dark(uint8_t enable) {
+    if (enable == dark) {
+        return;
+    }
+    dark = enable;
+
+    lv_disp_t *disp = lv_disp_get_default();
+    if (dark) {
+        ESP_LOGI(TAG, "Display dark");
+        enable_invalidation(disp, 0);
+        tft_display_sleep(1);
+    } else {
+        ESP_LOGI(TAG, "Display lit");
+        tft_display_sleep(0);
+        enable_invalidation(disp, 1);
+        // Overdue timers, like the clock of the page, run before the refresh timer, which is older
+        lv_obj_invalidate(lv_scr_act());
     }
+}
+
 
-    lv_timer_handler();
+uint8_t controller_gui_is_dark(void) {
+    return dark;
+}
+
+
+static uint32_t read_touch(unsigned long now) {
+    static unsigned long last_read = 0;
+
+    if (now - last_read >= LV_INDEV_DEF_READ_PERIOD) {
+        last_read = now;
+        // The same read LVGL runs from its timer, so presses reach the driver callback as usual
+        for (lv_indev_t *indev = lv_indev_get_next(NULL); indev != NULL; indev = lv_indev_get_next(indev)) {
+            lv_indev_read_timer_cb(indev->driver->read_timer);
+        }
+    }
+
+    unsigned long elapsed = now - last_read;
+    return elapsed < LV_INDEV_DEF_READ_PERIOD ? LV_INDEV_DEF_READ_PERIOD - elapsed : 0;
+}
+
+
+/*
+ * lv_disp_enable_invalidation was added in LVGL 8.3; before that, pausing the refresh timer keeps the display from
+ * being drawn and flushed, while invalidated areas pile up until the next full redraw
+ */
+static void enable_invalidation(lv_disp_t *disp, uint8_t enable) {
+#if LVGL_VERSION_MAJOR > 8 || (LVGL_VERSION_MAJOR == 8 && LVGL_VERSION_MINOR >= 3)
+    lv_disp_enable_invalidation(disp, enable);
+#else
+    if (enable) {
+        lv_timer_resume(_lv_disp_get_refr_timer(disp));
+    } else {
+        lv_timer_pause(_lv_disp_get_refr_timer(disp));
+    }
+#endif
 }
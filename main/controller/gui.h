@@ -1,6 +1,10 @@
 #ifndef GUI_H_INCLUDED
 #define GUI_H_INCLUDED
 
-void controller_gui_manage(void);
+#include <stdint.h>
+
+uint32_t controller_gui_manage(void);
+void     controller_gui_set_dark(uint8_t enable);
+uint8_t  controller_gui_is_dark(void);
 
 #endif
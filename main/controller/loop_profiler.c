@@ -0,0 +1,201 @@
+#include "loop_profiler.h"
+
+#if APP_CONFIG_LOOP_PROFILER
+
+#include <assert.h>
+#include <string.h>
+#include <esp_log.h>
+#ifdef SIMULATED_APPLICATION
+#include <time.h>
+#else
+#include <esp_timer.h>
+#endif
+
+
+#define LOOP_PROFILER_REPORT_PERIOD_MS 10000ULL
+
+// Log-linear buckets: every power of two is split into 1 << SUB_BITS buckets, values below are counted exactly
+#define SUB_BITS    2
+#define SUB_BUCKETS (1 << SUB_BITS)
+// Durations are capped at about a second
+#define MAX_EXPONENT 29
+#define NUM_BUCKETS  ((MAX_EXPONENT - SUB_BITS + 2) * SUB_BUCKETS)
+
+
+typedef struct {
+    uint32_t buckets[NUM_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+} histogram_t;
+
+
+static uint64_t now_nanos(void);
+static void     record(loop_profiler_phase_t phase, uint64_t duration);
+static size_t   bucket_of(uint32_t value);
+static uint32_t bucket_upper_bound(size_t bucket);
+static uint32_t percentile(const histogram_t *histogram, uint32_t permille);
+static void     close_window(uint64_t now);
+
+
+static const char *TAG = "LoopProfiler";
+
+static histogram_t            histograms[LOOP_PROFILER_PHASE_NUM] = {0};
+static uint64_t               window_start                        = 0;
+static uint64_t               iteration_start                     = 0;
+static uint64_t               last_mark                           = 0;
+static loop_profiler_report_t last_report                         = {0};
+static uint8_t                has_report                          = 0;
+
+
+void loop_profiler_begin(void) {
+    iteration_start = now_nanos();
+    last_mark       = iteration_start;
+    if (window_start == 0) {
+        window_start = iteration_start;
+    }
+}
+
+
+/*
+ * Closes `phase`, which started at the previous mark (or at the beginning of the iteration)
+ */
+void loop_profiler_mark(loop_profiler_phase_t phase) {
+    assert(phase < LOOP_PROFILER_PHASE_NUM);
+    uint64_t now = now_nanos();
+    record(phase, now - last_mark);
+    last_mark = now;
+}
+
+
+void loop_profiler_end(void) {
+    uint64_t now = now_nanos();
+    record(LOOP_PROFILER_PHASE_LOOP, now - iteration_start);
+
+    if (now - window_start >= LOOP_PROFILER_REPORT_PERIOD_MS * 1000000ULL) {
+        close_window(now);
+    }
+}
+
+
+/*
+ * Copies the summary of the last complete period; returns 0 if none is available yet
+ */
+uint8_t loop_profiler_get_report(loop_profiler_report_t *report) {
+    assert(report != NULL);
+    if (has_report) {
+        *report = last_report;
+    }
+    return has_report;
+}
+
+
+const char *loop_profiler_phase_name(loop_profiler_phase_t phase) {
+    static const char *names[LOOP_PROFILER_PHASE_NUM] = {
+        [LOOP_PROFILER_PHASE_TIMERS] = "timers",     [LOOP_PROFILER_PHASE_MODEL] = "model",
+        [LOOP_PROFILER_PHASE_NETWORK] = "network",   [LOOP_PROFILER_PHASE_GUI] = "gui",
+        [LOOP_PROFILER_PHASE_OBSERVER] = "observer", [LOOP_PROFILER_PHASE_STANDBY] = "standby",
+        [LOOP_PROFILER_PHASE_VIEW] = "view",         [LOOP_PROFILER_PHASE_SNAPSHOT] = "snapshot",
+        [LOOP_PROFILER_PHASE_LOOP] = "loop",
+    };
+    assert(phase < LOOP_PROFILER_PHASE_NUM);
+    return names[phase];
+}
+
+
+static uint64_t now_nanos(void) {
+#ifdef SIMULATED_APPLICATION
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+    // Microsecond resolution on the board
+    return (uint64_t)esp_timer_get_time() * 1000ULL;
+#endif
+}
+
+
+static void record(loop_profiler_phase_t phase, uint64_t duration) {
+    histogram_t *histogram = &histograms[phase];
+    uint32_t     value     = duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+
+    histogram->buckets[bucket_of(value)]++;
+    histogram->count++;
+    histogram->total += duration;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+
+static size_t bucket_of(uint32_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+
+    uint32_t exponent = 31 - __builtin_clz(value);
+    if (exponent > MAX_EXPONENT) {
+        return NUM_BUCKETS - 1;
+    }
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + ((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+
+static uint32_t bucket_upper_bound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    if (bucket == NUM_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+
+    // Lower bound of the next bucket, minus one
+    size_t   next     = bucket + 1;
+    uint32_t exponent = next / SUB_BUCKETS + SUB_BITS - 1;
+    return ((uint32_t)(SUB_BUCKETS | (next % SUB_BUCKETS)) << (exponent - SUB_BITS)) - 1;
+}
+
+
+static uint32_t percentile(const histogram_t *histogram, uint32_t permille) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    // Rank of the sample, rounding up
+    uint64_t rank       = ((uint64_t)histogram->count * permille + 999) / 1000;
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        cumulative += histogram->buckets[i];
+        if (cumulative >= rank) {
+            uint32_t bound = bucket_upper_bound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+
+static void close_window(uint64_t now) {
+    last_report.period = now - window_start;
+
+    for (size_t i = 0; i < LOOP_PROFILER_PHASE_NUM; i++) {
+        const histogram_t     *histogram = &histograms[i];
+        loop_profiler_stats_t *stats     = &last_report.phases[i];
+
+        stats->count = histogram->count;
+        stats->p50   = percentile(histogram, 500);
+        stats->p99   = percentile(histogram, 990);
+        stats->max   = histogram->max;
+        stats->total = histogram->total;
+
+        ESP_LOGI(TAG, "%-8s %7u runs, p50 %9.1f us, p99 %9.1f us, max %9.1f us, %5.1f%% of the time",
+                 loop_profiler_phase_name(i), (unsigned)stats->count, stats->p50 / 1000.0, stats->p99 / 1000.0,
+                 stats->max / 1000.0, (double)stats->total * 100.0 / (double)last_report.period);
+    }
+
+    has_report = 1;
+    memset(histograms, 0, sizeof(histograms));
+    window_start = now;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef LOOP_PROFILER_H_INCLUDED
+#define LOOP_PROFILER_H_INCLUDED
+
+
+#include <stdint.h>
+#include "config/app_config.h"
+
+
+typedef enum {
+    LOOP_PROFILER_PHASE_TIMERS = 0,     // Timer wheel and events from the service task
+    LOOP_PROFILER_PHASE_MODEL,          // Refreshes of the model and alarm scheduler
+    LOOP_PROFILER_PHASE_NETWORK,
+    LOOP_PROFILER_PHASE_GUI,            // lv_timer_handler, i.e. rendering
+    LOOP_PROFILER_PHASE_OBSERVER,
+    LOOP_PROFILER_PHASE_STANDBY,
+    LOOP_PROFILER_PHASE_VIEW,
+    LOOP_PROFILER_PHASE_SNAPSHOT,       // Snapshot for the other tasks and the sleep computation
+    LOOP_PROFILER_PHASE_LOOP,           // The whole iteration
+#define LOOP_PROFILER_PHASE_NUM 9
+} loop_profiler_phase_t;
+
+
+typedef struct {
+    uint32_t count;
+    // Nanoseconds; percentiles are the upper bound of their bucket, within 25% of the actual value
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t max;
+    uint64_t total;
+} loop_profiler_stats_t;
+
+
+typedef struct {
+    uint64_t              period;     // Nanoseconds covered by the report
+    loop_profiler_stats_t phases[LOOP_PROFILER_PHASE_NUM];
+} loop_profiler_report_t;
+
+
+/*
+ * Times the phases of controller_manage into histograms, logging a summary every LOOP_PROFILER_REPORT_PERIOD_MS.
+ * Only built with APP_CONFIG_LOOP_PROFILER; otherwise the macros expand to nothing
+ */
+#if APP_CONFIG_LOOP_PROFILER
+
+#define LOOP_PROFILER_BEGIN()     loop_profiler_begin()
+#define LOOP_PROFILER_MARK(phase) loop_profiler_mark(LOOP_PROFILER_PHASE_##phase)
+#define LOOP_PROFILER_END()       loop_profiler_end()
+
+void        loop_profiler_begin(void);
+void        loop_profiler_mark(loop_profiler_phase_t phase);
+void        loop_profiler_end(void);
+uint8_t     loop_profiler_get_report(loop_profiler_report_t *report);
+const char *loop_profiler_phase_name(loop_profiler_phase_t phase);
+
+#else
+
+#define LOOP_PROFILER_BEGIN()
+#define LOOP_PROFILER_MARK(phase)
+#define LOOP_PROFILER_END()
+
+#endif
+
+
+#endif
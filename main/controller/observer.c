@@ -1,47 +1,104 @@
-#include "watcher.h"
-#include "peripherals/tft.h"
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
 #include "model/model.h"
 #include "services/system_time.h"
 #include "persistance.h"
 
 
-static void backlight_update(void *old_value, const void *memory, uint16_t size, void *user_ptr, void *arg);
+#define PERSISTED_FIELD(field_id, variable, persistance_key, save_delay)                                               \
+    {                                                                                                                  \
+        .field = field_id, .memory = &(variable), .size = sizeof(variable), .key = persistance_key,                    \
+        .delay = save_delay,                                                                                           \
+    }
 
 
-static watcher_t watcher;
+typedef struct {
+    model_field_t field;
+    const void   *memory;
+    uint16_t      size;
+    const char   *key;
+    unsigned long delay;
+    unsigned long timestamp;
+} persisted_field_t;
+
+
+static model_t          *observed_model = NULL;
+static uint32_t          generation     = 0;
+// Fields changed but not saved yet
+static uint32_t          pending        = 0;
+static persisted_field_t persisted_fields[12];
+static size_t            num_persisted_fields = 0;
 
 
 void observer_init(model_t *pmodel) {
-    watcher_init(&watcher, NULL);
-    WATCHER_ADD_ENTRY(&watcher, &pmodel->config.normal_brightness, backlight_update, NULL);
-    WATCHER_ADD_ENTRY_DELAYED(&watcher, &pmodel->config.normal_brightness, persistance_save_variable,
-                              (void *)PERSISTANCE_NORMAL_BRIGHTNESS_KEY, 4000UL);
-    WATCHER_ADD_ENTRY_DELAYED(&watcher, &pmodel->config.standby_brightness, persistance_save_variable,
-                              (void *)PERSISTANCE_STANDBY_BRIGHTNESS_KEY, 4000UL);
-    WATCHER_ADD_ENTRY_DELAYED(&watcher, &pmodel->config.standby_delay_seconds, persistance_save_variable,
-                              (void *)PERSISTANCE_STANDBY_DELAY_KEY, 4000UL);
-    WATCHER_ADD_ENTRY_DELAYED(&watcher, &pmodel->config.night_mode, persistance_save_variable,
-                              (void *)PERSISTANCE_NIGHT_MODE_KEY, 4000UL);
-    WATCHER_ADD_ENTRY_DELAYED(&watcher, &pmodel->config.night_mode_start, persistance_save_variable,
-                              (void *)PERSISTANCE_NIGHT_MODE_START_KEY, 4000UL);
-    WATCHER_ADD_ENTRY_DELAYED(&watcher, &pmodel->config.night_mode_end, persistance_save_variable,
-                              (void *)PERSISTANCE_NIGHT_MODE_END_KEY, 4000UL);
-    WATCHER_ADD_ENTRY(&watcher, &pmodel->config.num_alarms, persistance_save_variable,
-                      (void *)PERSISTANCE_ALARM_NUM_KEY);
+    observed_model = pmodel;
+    generation     = model_get_generation(pmodel);
+
+    const persisted_field_t fields[] = {
+        PERSISTED_FIELD(MODEL_FIELD_NORMAL_BRIGHTNESS, pmodel->config.normal_brightness,
+                        PERSISTANCE_NORMAL_BRIGHTNESS_KEY, 4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_STANDBY_BRIGHTNESS, pmodel->config.standby_brightness,
+                        PERSISTANCE_STANDBY_BRIGHTNESS_KEY, 4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_STANDBY_DELAY, pmodel->config.standby_delay_seconds, PERSISTANCE_STANDBY_DELAY_KEY,
+                        4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_NIGHT_MODE, pmodel->config.night_mode, PERSISTANCE_NIGHT_MODE_KEY, 4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_NIGHT_MODE_START, pmodel->config.night_mode_start,
+                        PERSISTANCE_NIGHT_MODE_START_KEY, 4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_NIGHT_MODE_END, pmodel->config.night_mode_end, PERSISTANCE_NIGHT_MODE_END_KEY,
+                        4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_NUM_ALARMS, pmodel->config.num_alarms, PERSISTANCE_ALARM_NUM_KEY, 0),
+        PERSISTED_FIELD(MODEL_FIELD_WORLD_CLOCK, pmodel->config.world_clock, PERSISTANCE_WORLD_CLOCK_KEY, 4000UL),
+        PERSISTED_FIELD(MODEL_FIELD_SOLAR_SCHEDULE, pmodel->config.solar_schedule, PERSISTANCE_SOLAR_SCHEDULE_KEY,
+                        4000UL),
+    };
+
+    assert(sizeof(fields) <= sizeof(persisted_fields));
+    memcpy(persisted_fields, fields, sizeof(fields));
+    num_persisted_fields = sizeof(fields) / sizeof(fields[0]);
 }
 
 
 void observer_manage(void) {
-    watcher_watch(&watcher, get_millis());
+    uint32_t changes = model_get_changes(observed_model, &generation);
+
+    if (changes == 0 && pending == 0) {
+        return;
+    }
+
+    // Changes restart the delay, so that a slider being dragged is saved only once
+    for (size_t i = 0; i < num_persisted_fields; i++) {
+        persisted_field_t *persisted = &persisted_fields[i];
+        uint32_t           mask      = MODEL_FIELD_MASK(persisted->field);
+
+        if (changes & mask) {
+            persisted->timestamp = get_millis();
+            pending |= mask;
+        }
+        if ((pending & mask) && is_expired(persisted->timestamp, get_millis(), persisted->delay)) {
+            persistance_save_variable(persisted->memory, persisted->size, persisted->key);
+            pending &= ~mask;
+        }
+    }
 }
 
 
-static void backlight_update(void *old_value, const void *memory, uint16_t size, void *user_ptr, void *arg) {
-    (void)old_value;
-    (void)size;
-    (void)user_ptr;
-    (void)arg;
-    uint8_t *backlight = (uint8_t *)memory;
+/*
+ * Milliseconds until the next delayed save, ULONG_MAX if nothing is pending
+ */
+unsigned long observer_get_timeout(void) {
+    unsigned long timeout = ULONG_MAX;
+
+    for (size_t i = 0; i < num_persisted_fields; i++) {
+        persisted_field_t *persisted = &persisted_fields[i];
+        if (pending & MODEL_FIELD_MASK(persisted->field)) {
+            unsigned long elapsed   = time_interval(persisted->timestamp, get_millis());
+            unsigned long remaining = elapsed < persisted->delay ? persisted->delay - elapsed : 0;
+            if (remaining < timeout) {
+                timeout = remaining;
+            }
+        }
+    }
 
-    tft_backlight_set(*backlight);
+    return timeout;
 }
@@ -5,8 +5,9 @@
 #include "model/model.h"
 
 
-void observer_init(model_t *pmodel);
-void observer_manage(void);
+void          observer_init(model_t *pmodel);
+void          observer_manage(void);
+unsigned long observer_get_timeout(void);
 
 
 #endif
@@ -5,8 +5,12 @@
 #include <unistd.h>
 #include <errno.h>
 #include <dirent.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "peripherals/storage.h"
 #include "persistance.h"
+#include "model/world_clock.h"
 #include <esp_log.h>
 
 
@@ -17,57 +21,448 @@ const char *PERSISTANCE_ALARM_NUM_KEY          = "ALARMNUM";
 const char *PERSISTANCE_NIGHT_MODE_KEY         = "NIGHTMODE";
 const char *PERSISTANCE_NIGHT_MODE_START_KEY   = "NIGHTSTART";
 const char *PERSISTANCE_NIGHT_MODE_END_KEY     = "NIGHTEND";
+const char *PERSISTANCE_WORLD_CLOCK_KEY        = "WORLDCLOCK";
+const char *PERSISTANCE_SOLAR_SCHEDULE_KEY     = "SOLAR";
 
-static const char *ALARM_KEY_FMT = "ALARM%i";
+static const char *ALARM_KEY_FMT         = "ALARM%i";
+static const char *CHECKPOINT_HEADER_KEY = "CKPTHEAD";
+static const char *CHECKPOINT_BODY_KEY   = "CKPTBODY";
+static const char *JOURNAL_KEY           = "JOURNAL";
+
+
+#define CHECKPOINT_VERSION 1
+// Larger checkpoints are not saved, the next boot then loads every key
+#define CHECKPOINT_MAX_SIZE (16 * 1024)
+#define JOURNAL_SIZE        2048
+// Past this many bytes of commands, the journal is replaced by a new checkpoint
+#define JOURNAL_CHECKPOINT_THRESHOLD (JOURNAL_SIZE * 3 / 4)
+
+
+// Alarms are saved with their description inline, truncated after the terminator and followed by the duration.
+// Alarms saved before durations existed end with the terminator, so they load with no duration
+typedef struct __attribute__((packed)) {
+    uint64_t timestamp;
+    uint8_t  recurrence;
+    uint8_t  weekdays;
+    char     description[MAX_DESCRIPTION_LEN + 1 + sizeof(uint16_t)];
+} persisted_alarm_t;
+
+
+// What the keys hold besides the alarms, at the start of the body of a checkpoint
+typedef struct {
+    uint8_t                 normal_brightness;
+    uint8_t                 standby_brightness;
+    uint16_t                standby_delay_seconds;
+    uint8_t                 night_mode;
+    uint32_t                night_mode_start;
+    uint32_t                night_mode_end;
+    world_clock_config_t    world_clock;
+    solar_schedule_config_t solar_schedule;
+} persisted_config_t;
+
+
+// The body follows in its own blob: the configuration, then every alarm as a length byte and the bytes it has under
+// its own key. Both are saved, along with an empty journal, in a single commit
+typedef struct __attribute__((packed)) {
+    uint16_t version;
+    uint16_t num_alarms;
+    uint32_t sequence;     // The journal names the checkpoint it follows
+    uint32_t size;         // Of the body
+    uint32_t checksum;     // FNV-1a of the body
+} checkpoint_header_t;
+
+
+// Followed by `len` bytes of commands, as command_log_copy gives them
+typedef struct __attribute__((packed)) {
+    uint32_t sequence;
+    uint16_t len;
+} journal_header_t;
+
+
+static void               load_keys(mut_model_t *pmodel);
+static int                load_checkpoint(mut_model_t *pmodel);
+static int                replay_journal(model_updater_t updater);
+static void               save_checkpoint(model_t *pmodel);
+static void               save_journal(void);
+static void               flush_journal(void);
+static persisted_config_t read_config(model_t *pmodel);
+static void               apply_config(mut_model_t *pmodel, const persisted_config_t *config);
+static size_t             encode_alarm(model_t *pmodel, size_t alarm_num, persisted_alarm_t *persisted);
+static void               decode_alarm(mut_model_t *pmodel, size_t alarm_num, persisted_alarm_t *persisted);
+static void               clear_alarms(mut_model_t *pmodel);
+static uint32_t           checksum(const uint8_t *bytes, size_t len);
 
 
 static const char *TAG = "Persistance";
 
+// Commands logged by the updater since the last checkpoint
+static command_log_t journal = {0};
+static uint8_t       journal_buffer[JOURNAL_SIZE];
+// The journal as it is saved, header first
+static uint8_t  journal_blob[sizeof(journal_header_t) + JOURNAL_SIZE];
+static size_t   flushed_size        = 0;
+static uint32_t checkpoint_sequence = 0;
+static model_t *journaled_model     = NULL;
+static uint8_t  transaction_open    = 0;
 
-void persistance_load(mut_model_t *pmodel) {
-    storage_load_uint8(&pmodel->config.normal_brightness, (char *)PERSISTANCE_NORMAL_BRIGHTNESS_KEY);
-    storage_load_uint8(&pmodel->config.standby_brightness, (char *)PERSISTANCE_STANDBY_BRIGHTNESS_KEY);
-    storage_load_uint16(&pmodel->config.standby_delay_seconds, (char *)PERSISTANCE_STANDBY_DELAY_KEY);
-    storage_load_uint16(&pmodel->config.num_alarms, (char *)PERSISTANCE_ALARM_NUM_KEY);
-    storage_load_uint8(&pmodel->config.night_mode, (char *)PERSISTANCE_NIGHT_MODE_KEY);
-    storage_load_uint32(&pmodel->config.night_mode_start, (char *)PERSISTANCE_NIGHT_MODE_START_KEY);
-    storage_load_uint32(&pmodel->config.night_mode_end, (char *)PERSISTANCE_NIGHT_MODE_END_KEY);
 
-    for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
-        char string[32] = {0};
-        snprintf(string, sizeof(string), ALARM_KEY_FMT, (int)i);
-        storage_load_blob(&pmodel->config.alarms[i], sizeof(alarm_t), string);
+/*
+ * From the last checkpoint and the journal of the commands logged since, in three reads. From every key when there is
+ * no usable checkpoint: on the first boot, after an interrupted write, or when the journal does not replay as it was
+ * recorded. The keys are saved as before, so both ways lead to the same configuration
+ */
+void persistance_load(model_updater_t updater) {
+    mut_model_t       *pmodel        = model_updater_read(updater);
+    persisted_config_t defaults      = read_config(pmodel);
+    uint8_t            military_time = pmodel->config.military_time;
+
+    command_log_init(&journal, journal_buffer, sizeof(journal_buffer));
+    if (load_checkpoint(pmodel) || replay_journal(updater)) {
+        ESP_LOGI(TAG, "No usable checkpoint, loading every key");
+        clear_alarms(pmodel);
+        apply_config(pmodel, &defaults);
+        load_keys(pmodel);
+        save_checkpoint(pmodel);
     }
+    // It has no key, so it is not taken from the journal either
+    pmodel->config.military_time = military_time;
+    model_log_alarm_store_usage(pmodel);
+
+    journaled_model = pmodel;
+    model_updater_set_journal(updater, &journal);
 }
 
 
-void persistance_save_variable(void *old_value, const void *memory, uint16_t size, void *user_ptr, void *arg) {
-    (void)old_value;
-    (void)user_ptr;
+/*
+ * Every save commits the journal along with it, so that it is never older than the keys
+ */
+void persistance_save_variable(const void *memory, uint16_t size, const char *key) {
+    uint8_t own_transaction = !transaction_open;
+    if (own_transaction) {
+        persistance_begin_transaction();
+    }
 
-    ESP_LOGI(TAG, "Saving variable %s of size %zu", (char *)arg, (size_t)size);
+    ESP_LOGI(TAG, "Saving variable %s of size %zu", key, (size_t)size);
     switch (size) {
         case sizeof(uint8_t):
-            storage_save_uint8((uint8_t *)memory, arg);
+            storage_save_uint8((uint8_t *)memory, (char *)key);
             break;
         case sizeof(uint16_t):
-            storage_save_uint16((uint16_t *)memory, arg);
+            storage_save_uint16((uint16_t *)memory, (char *)key);
             break;
         case sizeof(uint32_t):
-            storage_save_uint32((uint32_t *)memory, arg);
+            storage_save_uint32((uint32_t *)memory, (char *)key);
             break;
         case sizeof(uint64_t):
-            storage_save_uint64((uint64_t *)memory, arg);
+            storage_save_uint64((uint64_t *)memory, (char *)key);
             break;
         default:
-            storage_save_blob((void *)memory, size, arg);
+            storage_save_blob((void *)memory, size, (char *)key);
             break;
     }
+
+    if (own_transaction) {
+        persistance_commit_transaction();
+    }
 }
 
 
-void persistance_save_alarm(size_t alarm_num, alarm_t alarm) {
-    char string[32] = {0};
+void persistance_save_alarm(model_t *pmodel, size_t alarm_num) {
+    uint8_t own_transaction = !transaction_open;
+    if (own_transaction) {
+        persistance_begin_transaction();
+    }
+
+    char              string[32] = {0};
+    persisted_alarm_t persisted  = {0};
+    size_t            len        = encode_alarm(pmodel, alarm_num, &persisted);
     snprintf(string, sizeof(string), ALARM_KEY_FMT, (int)alarm_num);
-    storage_save_blob(&alarm, sizeof(alarm), string);
+    storage_save_blob(&persisted, len, string);
+
+    if (own_transaction) {
+        persistance_commit_transaction();
+    }
+}
+
+
+/*
+ * Everything saved until the commit is written at once, e.g. a batch of imported alarms
+ */
+void persistance_begin_transaction(void) {
+    storage_begin_transaction();
+    transaction_open = 1;
+}
+
+
+void persistance_commit_transaction(void) {
+    flush_journal();
+    transaction_open = 0;
+    storage_commit_transaction();
+}
+
+
+static void load_keys(mut_model_t *pmodel) {
+    persisted_config_t config = read_config(pmodel);
+    storage_load_uint8(&config.normal_brightness, (char *)PERSISTANCE_NORMAL_BRIGHTNESS_KEY);
+    storage_load_uint8(&config.standby_brightness, (char *)PERSISTANCE_STANDBY_BRIGHTNESS_KEY);
+    storage_load_uint16(&config.standby_delay_seconds, (char *)PERSISTANCE_STANDBY_DELAY_KEY);
+    storage_load_uint8(&config.night_mode, (char *)PERSISTANCE_NIGHT_MODE_KEY);
+    storage_load_uint32(&config.night_mode_start, (char *)PERSISTANCE_NIGHT_MODE_START_KEY);
+    storage_load_uint32(&config.night_mode_end, (char *)PERSISTANCE_NIGHT_MODE_END_KEY);
+    storage_load_blob(&config.world_clock, sizeof(config.world_clock), (char *)PERSISTANCE_WORLD_CLOCK_KEY);
+    storage_load_blob(&config.solar_schedule, sizeof(config.solar_schedule), (char *)PERSISTANCE_SOLAR_SCHEDULE_KEY);
+    apply_config(pmodel, &config);
+
+    uint16_t num_alarms = 0;
+    storage_load_uint16(&num_alarms, (char *)PERSISTANCE_ALARM_NUM_KEY);
+    if (model_reserve_alarms(pmodel, num_alarms)) {
+        ESP_LOGE(TAG, "Only %i out of %i alarms fit in the RAM budget", pmodel->config.alarms_capacity, num_alarms);
+        num_alarms = pmodel->config.alarms_capacity;
+    }
+    pmodel->config.num_alarms = num_alarms;
+
+    for (size_t i = 0; i < num_alarms; i++) {
+        char              string[32] = {0};
+        persisted_alarm_t persisted  = {0};
+        snprintf(string, sizeof(string), ALARM_KEY_FMT, (int)i);
+        storage_load_blob(&persisted, sizeof(persisted), string);
+        decode_alarm(pmodel, i, &persisted);
+    }
+
+    model_rebuild_alarm_index(pmodel);
+}
+
+
+static int load_checkpoint(mut_model_t *pmodel) {
+    checkpoint_header_t header = {0};
+    storage_load_blob(&header, sizeof(header), (char *)CHECKPOINT_HEADER_KEY);
+    // The next checkpoint follows this one, usable or not
+    checkpoint_sequence = header.sequence;
+    if (header.version != CHECKPOINT_VERSION || header.size < sizeof(persisted_config_t) ||
+        header.size > CHECKPOINT_MAX_SIZE) {
+        return -1;
+    }
+
+    uint8_t *body = calloc(1, header.size);
+    if (body == NULL) {
+        return -1;
+    }
+    storage_load_blob(body, header.size, (char *)CHECKPOINT_BODY_KEY);
+
+    // The whole body is checked before the model is touched
+    size_t offset = sizeof(persisted_config_t);
+    for (size_t i = 0; i < header.num_alarms && offset < header.size; i++) {
+        offset += 1 + body[offset];
+    }
+    if (checksum(body, header.size) != header.checksum || offset != header.size ||
+        model_reserve_alarms(pmodel, header.num_alarms)) {
+        free(body);
+        return -1;
+    }
+
+    persisted_config_t config = {0};
+    memcpy(&config, body, sizeof(config));
+    apply_config(pmodel, &config);
+
+    pmodel->config.num_alarms = header.num_alarms;
+    offset                    = sizeof(persisted_config_t);
+    for (size_t i = 0; i < header.num_alarms; i++) {
+        persisted_alarm_t persisted = {0};
+        size_t            len       = body[offset];
+        memcpy(&persisted, &body[offset + 1], len < sizeof(persisted) ? len : sizeof(persisted));
+        decode_alarm(pmodel, i, &persisted);
+        offset += 1 + len;
+    }
+    free(body);
+
+    model_rebuild_alarm_index(pmodel);
+    return 0;
+}
+
+
+static int replay_journal(model_updater_t updater) {
+    journal_header_t header = {0};
+    memset(journal_blob, 0, sizeof(header));
+    storage_load_blob(journal_blob, sizeof(journal_blob), (char *)JOURNAL_KEY);
+    memcpy(&header, journal_blob, sizeof(header));
+    if (header.sequence != checkpoint_sequence || header.len > JOURNAL_SIZE) {
+        return -1;
+    }
+
+    command_log_restore(&journal, &journal_blob[sizeof(header)], header.len);
+    flushed_size    = header.len;
+    size_t diverged = 0;
+    size_t replayed = model_updater_replay(updater, &journal, &diverged);
+    ESP_LOGI(TAG, "Replayed %zu commands after checkpoint %u, %zu diverged", replayed, (unsigned)checkpoint_sequence,
+             diverged);
+    return diverged > 0 ? -1 : 0;
+}
+
+
+/*
+ * Replaces the checkpoint with the current configuration and empties the journal
+ */
+static void save_checkpoint(model_t *pmodel) {
+    checkpoint_header_t header = {
+        .version    = CHECKPOINT_VERSION,
+        .num_alarms = pmodel->config.num_alarms,
+        .sequence   = checkpoint_sequence + 1,
+        .size       = sizeof(persisted_config_t),
+    };
+    persisted_alarm_t persisted = {0};
+    for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
+        header.size += 1 + encode_alarm(pmodel, i, &persisted);
+    }
+
+    uint8_t *body = header.size <= CHECKPOINT_MAX_SIZE ? malloc(header.size) : NULL;
+    if (body != NULL) {
+        persisted_config_t config = read_config(pmodel);
+        memcpy(body, &config, sizeof(config));
+        size_t offset = sizeof(config);
+        for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
+            size_t len   = encode_alarm(pmodel, i, &persisted);
+            body[offset] = len;
+            memcpy(&body[offset + 1], &persisted, len);
+            offset += 1 + len;
+        }
+        header.checksum = checksum(body, header.size);
+    } else {
+        // The previous checkpoint would not match the keys anymore
+        ESP_LOGW(TAG, "No checkpoint of %u bytes, the next boot loads every key", (unsigned)header.size);
+        header.version = 0;
+    }
+
+    uint8_t own_transaction = !transaction_open;
+    if (own_transaction) {
+        storage_begin_transaction();
+    }
+    storage_save_blob(&header, sizeof(header), (char *)CHECKPOINT_HEADER_KEY);
+    if (body != NULL) {
+        storage_save_blob(body, header.size, (char *)CHECKPOINT_BODY_KEY);
+    }
+    checkpoint_sequence = header.sequence;
+    command_log_clear(&journal);
+    save_journal();
+    if (own_transaction) {
+        storage_commit_transaction();
+    }
+    free(body);
+}
+
+
+static void save_journal(void) {
+    journal_header_t header = {.sequence = checkpoint_sequence, .len = command_log_get_size(&journal)};
+    memcpy(journal_blob, &header, sizeof(header));
+    command_log_copy(&journal, &journal_blob[sizeof(header)], JOURNAL_SIZE);
+    storage_save_blob(journal_blob, sizeof(header) + header.len, (char *)JOURNAL_KEY);
+    flushed_size = header.len;
+}
+
+
+/*
+ * Saves the commands logged since the last save, or a new checkpoint once the journal fills up. Records dropped from
+ * the full log are not lost, the checkpoint is taken from the model
+ */
+static void flush_journal(void) {
+    if (journaled_model == NULL) {
+        return;
+    }
+
+    size_t size = command_log_get_size(&journal);
+    if (command_log_get_dropped(&journal) > 0 || size > JOURNAL_CHECKPOINT_THRESHOLD) {
+        save_checkpoint(journaled_model);
+    } else if (size != flushed_size) {
+        save_journal();
+    }
+}
+
+
+static persisted_config_t read_config(model_t *pmodel) {
+    return (persisted_config_t){
+        .normal_brightness     = pmodel->config.normal_brightness,
+        .standby_brightness    = pmodel->config.standby_brightness,
+        .standby_delay_seconds = pmodel->config.standby_delay_seconds,
+        .night_mode            = pmodel->config.night_mode,
+        .night_mode_start      = pmodel->config.night_mode_start,
+        .night_mode_end        = pmodel->config.night_mode_end,
+        .world_clock           = pmodel->config.world_clock,
+        .solar_schedule        = pmodel->config.solar_schedule,
+    };
+}
+
+
+static void apply_config(mut_model_t *pmodel, const persisted_config_t *config) {
+    pmodel->config.normal_brightness     = config->normal_brightness;
+    pmodel->config.standby_brightness    = config->standby_brightness;
+    pmodel->config.standby_delay_seconds = config->standby_delay_seconds;
+    pmodel->config.night_mode            = config->night_mode;
+    pmodel->config.night_mode_start      = config->night_mode_start;
+    pmodel->config.night_mode_end        = config->night_mode_end;
+
+    pmodel->config.world_clock = config->world_clock;
+    for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+        // e.g. a city saved by a newer firmware
+        if (pmodel->config.world_clock.cities[i] >= world_clock_get_city_count()) {
+            pmodel->config.world_clock.cities[i] = WORLD_CLOCK_NO_CITY;
+        }
+    }
+
+    if (abs(config->solar_schedule.latitude) <= 9000 && abs(config->solar_schedule.longitude) <= 18000) {
+        pmodel->config.solar_schedule = config->solar_schedule;
+    }
+}
+
+
+/*
+ * Returns how many bytes of `persisted` are saved
+ */
+static size_t encode_alarm(model_t *pmodel, size_t alarm_num, persisted_alarm_t *persisted) {
+    alarm_t alarm = model_get_alarm(pmodel, alarm_num);
+    *persisted    = (persisted_alarm_t){
+        .timestamp  = alarm.timestamp,
+        .recurrence = alarm.recurrence,
+        .weekdays   = alarm.weekdays,
+    };
+    snprintf(persisted->description, MAX_DESCRIPTION_LEN + 1, "%s", model_get_alarm_description(pmodel, alarm_num));
+    size_t len = strlen(persisted->description);
+    memcpy(&persisted->description[len + 1], &alarm.duration, sizeof(alarm.duration));
+    return offsetof(persisted_alarm_t, description) + len + 1 + sizeof(alarm.duration);
+}
+
+
+static void decode_alarm(mut_model_t *pmodel, size_t alarm_num, persisted_alarm_t *persisted) {
+    persisted->description[MAX_DESCRIPTION_LEN] = '\0';
+    size_t   len                                = strlen(persisted->description);
+    uint16_t duration                           = 0;
+    memcpy(&duration, &persisted->description[len + 1], sizeof(duration));
+
+    alarm_t *alarm     = &pmodel->config.alarms[alarm_num];
+    alarm->timestamp   = persisted->timestamp;
+    alarm->description = STRING_ARENA_NONE;
+    alarm->recurrence  = persisted->recurrence;
+    alarm->weekdays    = persisted->weekdays;
+    alarm->duration    = duration;
+    if (model_set_alarm_description(pmodel, alarm_num, persisted->description)) {
+        ESP_LOGW(TAG, "No room left for the description of alarm %zu", alarm_num);
+    }
+}
+
+
+/*
+ * Gives the descriptions of a checkpoint or of a replay back to the arena before loading the keys
+ */
+static void clear_alarms(mut_model_t *pmodel) {
+    for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
+        model_set_alarm_description(pmodel, i, "");
+    }
+    pmodel->config.num_alarms = 0;
+}
+
+
+static uint32_t checksum(const uint8_t *bytes, size_t len) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
 }
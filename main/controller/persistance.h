@@ -3,11 +3,14 @@
 
 
 #include "model/model.h"
+#include "model/updater.h"
 
 
-void persistance_load(mut_model_t *model);
-void persistance_save_variable(void *old_value, const void *memory, uint16_t size, void *user_ptr, void *arg);
-void persistance_save_alarm(size_t alarm_num, alarm_t alarm);
+void persistance_load(model_updater_t updater);
+void persistance_save_variable(const void *memory, uint16_t size, const char *key);
+void persistance_save_alarm(model_t *pmodel, size_t alarm_num);
+void persistance_begin_transaction(void);
+void persistance_commit_transaction(void);
 
 
 extern const char *PERSISTANCE_NORMAL_BRIGHTNESS_KEY;
@@ -17,6 +20,8 @@ extern const char *PERSISTANCE_ALARM_NUM_KEY;
 extern const char *PERSISTANCE_NIGHT_MODE_KEY;
 extern const char *PERSISTANCE_NIGHT_MODE_START_KEY;
 extern const char *PERSISTANCE_NIGHT_MODE_END_KEY;
+extern const char *PERSISTANCE_WORLD_CLOCK_KEY;
+extern const char *PERSISTANCE_SOLAR_SCHEDULE_KEY;
 
 
 #endif
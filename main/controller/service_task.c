@@ -0,0 +1,143 @@
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "config/app_config.h"
+#include "services/github.h"
+#include "model/message_ring.h"
+#include "wakeup.h"
+#include "service_task.h"
+
+
+// Polling period of an HTTP request in progress
+#define HTTP_POLL_MS 10UL
+#define RING_SIZE    8
+
+
+typedef enum {
+    SERVICE_REQUEST_LATEST_RELEASE = 0,
+    SERVICE_REQUEST_OTA,
+} service_request_t;
+
+
+static void task(void *args);
+static void send(service_request_t request);
+static void report(const github_event_t *event);
+
+
+static const char *TAG = "ServiceTask";
+
+static TaskHandle_t   handle   = NULL;
+// From the controller to the service task
+static message_ring_t requests = {0};
+// From the service task to the controller
+static message_ring_t events   = {0};
+
+
+/*
+ * The GitHub client blocks for TLS handshakes and flash writes, so it runs on the networking core instead of the
+ * main loop. Only the controller task may send requests and read events
+ */
+void service_task_init(void) {
+    assert(handle == NULL);
+
+    static service_request_t request_buffer[RING_SIZE];
+    static github_event_t    event_buffer[RING_SIZE];
+    message_ring_init(&requests, request_buffer, sizeof(request_buffer[0]), RING_SIZE);
+    message_ring_init(&events, event_buffer, sizeof(event_buffer[0]), RING_SIZE);
+
+#ifdef SIMULATED_APPLICATION
+    xTaskCreate(task, TAG, configMINIMAL_STACK_SIZE * 8, NULL, 1, &handle);
+#else
+    static uint8_t      stack_buffer[4096 * 2];
+    static StaticTask_t task_buffer;
+    handle = xTaskCreateStaticPinnedToCore(task, TAG, sizeof(stack_buffer), NULL, 1, stack_buffer, &task_buffer,
+                                           APP_CONFIG_NETWORK_CORE);
+#endif
+
+    ESP_LOGI(TAG, "Initialized");
+}
+
+
+void service_task_request_latest_release(void) {
+    send(SERVICE_REQUEST_LATEST_RELEASE);
+}
+
+
+void service_task_start_ota(void) {
+    send(SERVICE_REQUEST_OTA);
+}
+
+
+/*
+ * Returns 0 once there are no more events
+ */
+uint8_t service_task_get_event(github_event_t *event) {
+    return message_ring_pop(&events, event);
+}
+
+
+static void task(void *args) {
+    (void)args;
+
+    for (;;) {
+        service_request_t request;
+        github_event_t    event;
+
+        while (message_ring_pop(&requests, &request)) {
+            switch (request) {
+                case SERVICE_REQUEST_LATEST_RELEASE:
+                    if (github_request_latest_release(&event)) {
+                        report(&event);
+                    }
+                    break;
+
+                case SERVICE_REQUEST_OTA:
+                    if (github_ota(&event)) {
+                        report(&event);
+                    }
+                    break;
+            }
+        }
+
+        if (github_is_busy()) {
+            if (github_manage(&event)) {
+                report(&event);
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HTTP_POLL_MS));
+        } else {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+
+static void send(service_request_t request) {
+    if (message_ring_push(&requests, &request)) {
+        xTaskNotifyGive(handle);
+    } else {
+        ESP_LOGW(TAG, "Too many requests, dropping %i", request);
+    }
+}
+
+
+static void report(const github_event_t *event) {
+    static firmware_update_state_t last_update = {.tag = FIRMWARE_UPDATE_STATE_TAG_NONE};
+
+    // Every chunk of an update reports its state, which rarely changes
+    if (event->tag == GITHUB_EVENT_TAG_FIRMWARE_UPDATE) {
+        if (model_firmware_update_state_equal(last_update, event->as.firmware_update)) {
+            return;
+        }
+        last_update = event->as.firmware_update;
+    }
+
+    // Waits for the controller rather than losing the event
+    while (!message_ring_push(&events, event)) {
+        wakeup_notify();
+        vTaskDelay(pdMS_TO_TICKS(HTTP_POLL_MS));
+    }
+    wakeup_notify();
+}
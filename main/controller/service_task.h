@@ -0,0 +1,14 @@
+#ifndef SERVICE_TASK_H_INCLUDED
+#define SERVICE_TASK_H_INCLUDED
+
+
+#include "services/github.h"
+
+
+void    service_task_init(void);
+void    service_task_request_latest_release(void);
+void    service_task_start_ota(void);
+uint8_t service_task_get_event(github_event_t *event);
+
+
+#endif
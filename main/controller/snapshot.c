@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "snapshot.h"
+
+
+// Attempts before a reader lets a preempted writer finish
+#define SPINS_BEFORE_YIELD 8
+
+#define SNAPSHOT_WORDS ((sizeof(model_snapshot_t) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+
+// The snapshot seen as words, so that it can be copied through atomics
+typedef union {
+    model_snapshot_t snapshot;
+    uint32_t         words[SNAPSHOT_WORDS];
+} snapshot_words_t;
+
+
+static void copy_to_published(const snapshot_words_t *source);
+static void copy_from_published(snapshot_words_t *destination);
+
+
+/*
+ * Seqlock: the sequence is odd while the writer is copying, and readers retry when it is odd or when it changed
+ * during their copy.
+ * The payload is copied word by word with relaxed atomic accesses, so a reader racing with the writer may see a mix
+ * of old and new words but never a torn or undefined one; the fences order those accesses against the sequence,
+ * and the check of the sequence after the copy throws the mix away.
+ */
+static atomic_uint sequence                  = 0;
+static atomic_uint published[SNAPSHOT_WORDS] = {0};
+static atomic_uint retries                   = 0;
+
+
+/*
+ * Must only be called by the controller task. Does nothing if the model did not change since the last call
+ */
+void snapshot_publish(model_t *pmodel) {
+    assert(pmodel != NULL);
+    static uint8_t  first           = 1;
+    static uint32_t last_generation = 0;
+
+    if (!first && last_generation == model_get_generation(pmodel)) {
+        return;
+    }
+    first           = 0;
+    last_generation = model_get_generation(pmodel);
+
+    snapshot_words_t words = {0};
+    words.snapshot         = (model_snapshot_t){
+        .generation                   = model_get_generation(pmodel),
+        .military_time                = pmodel->config.military_time,
+        .normal_brightness            = pmodel->config.normal_brightness,
+        .standby_brightness           = pmodel->config.standby_brightness,
+        .standby_delay_seconds        = pmodel->config.standby_delay_seconds,
+        .night_mode                   = pmodel->config.night_mode,
+        .night_mode_start             = pmodel->config.night_mode_start,
+        .night_mode_end               = pmodel->config.night_mode_end,
+        .num_alarms                   = pmodel->config.num_alarms,
+        .wifi_state                   = pmodel->run.wifi_state,
+        .ip_addr                      = pmodel->run.ip_addr,
+        .server_firmware_update_state = pmodel->run.server_firmware_update_state,
+        .client_firmware_update_state = pmodel->run.client_firmware_update_state,
+        .latest_release_request_state = pmodel->run.latest_release_request_state,
+        .latest_release_major         = pmodel->run.latest_release_major,
+        .latest_release_minor         = pmodel->run.latest_release_minor,
+        .latest_release_patch         = pmodel->run.latest_release_patch,
+    };
+    memcpy(words.snapshot.ssid, pmodel->run.ssid, sizeof(words.snapshot.ssid));
+
+    unsigned int current = atomic_load_explicit(&sequence, memory_order_relaxed);
+    atomic_store_explicit(&sequence, current + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    copy_to_published(&words);
+    atomic_store_explicit(&sequence, current + 2, memory_order_release);
+}
+
+
+/*
+ * Never blocks the writer; may be called by any task
+ */
+void snapshot_read(model_snapshot_t *snapshot) {
+    assert(snapshot != NULL);
+    size_t spins = 0;
+
+    for (;;) {
+        unsigned int before = atomic_load_explicit(&sequence, memory_order_acquire);
+
+        if ((before & 1) == 0) {
+            snapshot_words_t words = {0};
+            copy_from_published(&words);
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&sequence, memory_order_relaxed) == before) {
+                *snapshot = words.snapshot;
+                return;
+            }
+        }
+
+        atomic_fetch_add_explicit(&retries, 1, memory_order_relaxed);
+        // A higher priority reader on the same core would otherwise spin until the writer is scheduled again
+        if (++spins >= SPINS_BEFORE_YIELD) {
+            vTaskDelay(1);
+            spins = 0;
+        }
+    }
+}
+
+
+/*
+ * How many times readers had to retry because of a concurrent write
+ */
+uint32_t snapshot_get_retries(void) {
+    return atomic_load_explicit(&retries, memory_order_relaxed);
+}
+
+
+static void copy_to_published(const snapshot_words_t *source) {
+    for (size_t i = 0; i < SNAPSHOT_WORDS; i++) {
+        atomic_store_explicit(&published[i], source->words[i], memory_order_relaxed);
+    }
+}
+
+
+static void copy_from_published(snapshot_words_t *destination) {
+    for (size_t i = 0; i < SNAPSHOT_WORDS; i++) {
+        destination->words[i] = atomic_load_explicit(&published[i], memory_order_relaxed);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+
+#include "model/model.h"
+
+
+/*
+ * Copy of the plain state of the model, published by the controller task for the other tasks.
+ * Alarms are not included: they live in heap memory owned by the controller task.
+ */
+typedef struct {
+    uint32_t generation;
+
+    uint8_t  military_time;
+    uint8_t  normal_brightness;
+    uint8_t  standby_brightness;
+    uint16_t standby_delay_seconds;
+    uint8_t  night_mode;
+    uint32_t night_mode_start;
+    uint32_t night_mode_end;
+    uint16_t num_alarms;
+
+    wifi_state_t            wifi_state;
+    uint32_t                ip_addr;
+    char                    ssid[MAX_SSID_SIZE];
+    firmware_update_state_t server_firmware_update_state;
+    firmware_update_state_t client_firmware_update_state;
+    http_request_state_t    latest_release_request_state;
+    uint16_t                latest_release_major;
+    uint16_t                latest_release_minor;
+    uint16_t                latest_release_patch;
+} model_snapshot_t;
+
+
+void     snapshot_publish(model_t *pmodel);
+void     snapshot_read(model_snapshot_t *snapshot);
+uint32_t snapshot_get_retries(void);
+
+
+#endif
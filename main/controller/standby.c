@@ -1,45 +1,185 @@
 #include "services/system_time.h"
+#include "services/clock.h"
 #include "peripherals/tft.h"
 #include "view/view.h"
 #include "config/app_config.h"
 #include "standby.h"
+#include "gui.h"
 
 
 typedef enum {
     STANDBY_STATE_OFF = 0,
     STANDBY_STATE_ON,
-    STANDBY_STATE_POKED,
 } standby_state_t;
 
 
-static standby_state_t standby_state    = STANDBY_STATE_OFF;
-static unsigned long   last_activity_ts = 0;
+// Duration of the hardware fade towards the standby brightness
+#define STANDBY_FADE_MS 1000UL
+// Duration of the hardware fade back to the normal brightness; short, as the user is looking at the screen
+#define STANDBY_WAKE_FADE_MS 200UL
+// How often the solar brightness curve is sampled while in standby
+#define STANDBY_CURVE_PERIOD_MS 1000UL
 
+// Fields that move the standby brightness
+#define STANDBY_BRIGHTNESS_FIELDS                                                                                      \
+    (MODEL_FIELD_MASK(MODEL_FIELD_STANDBY_BRIGHTNESS) | MODEL_FIELD_MASK(MODEL_FIELD_NIGHT_MODE) |                     \
+     MODEL_FIELD_MASK(MODEL_FIELD_NIGHT_MODE_ACTIVE) | MODEL_FIELD_MASK(MODEL_FIELD_SOLAR_SCHEDULE) |                  \
+     MODEL_FIELD_MASK(MODEL_FIELD_FIRMWARE_UPDATE_STATE))
 
+
+static void                  enter_standby(void);
+static void                  leave_standby(void);
+static void                  fade_to_standby_brightness(void);
+static void                  follow_solar_curve(void);
+static timer_wheel_outcome_t standby_job_cb(void *arg);
+static timer_wheel_outcome_t curve_job_cb(void *arg);
+static timer_wheel_outcome_t dark_job_cb(void *arg);
+
+
+static standby_state_t   standby_state    = STANDBY_STATE_OFF;
+static model_t          *standby_model    = NULL;
+static timer_wheel_t    *standby_wheel    = NULL;
+// Armed while the screen is in use, restarted by every touch
+static timer_wheel_job_t standby_job;
+// Samples the brightness while it follows the sun
+static timer_wheel_job_t curve_job;
+// Turns the display dark once the backlight has faded out
+static timer_wheel_job_t dark_job;
+static unsigned long     standby_delay_ms = 0;
+static uint32_t          generation       = 0;
+// Target of the last fade, so that it is started only when the brightness curve moves
+static int16_t           standby_target   = -1;
+
+
+/*
+ * The backlight only changes on transitions: a touch, the standby delay expiring, a sample of the solar curve or a
+ * change to the settings. In between the LEDC hardware holds the duty and the loop does no backlight work
+ */
+void standby_init(timer_wheel_t *wheel, model_t *pmodel) {
+    standby_wheel    = wheel;
+    standby_model    = pmodel;
+    standby_delay_ms = model_get_standby_delay_seconds(pmodel) * 1000UL;
+    generation       = model_get_generation(pmodel);
+
+    timer_wheel_job_init(&standby_job, standby_job_cb, NULL, 0, 0, 0, 0);
+    timer_wheel_job_init(&curve_job, curve_job_cb, NULL, STANDBY_CURVE_PERIOD_MS, 0, 0, 0);
+    timer_wheel_job_init(&dark_job, dark_job_cb, NULL, 0, 0, 0, 0);
+    timer_wheel_start(standby_wheel, &standby_job, standby_delay_ms, get_millis());
+
+    // From the full brightness of tft_init to the saved one
+    tft_backlight_fade(model_get_normal_brightness(pmodel), STANDBY_WAKE_FADE_MS);
+}
+
+
+/*
+ * Only reacts to changes of the settings, which cost a single comparison otherwise
+ */
 void standby_manage(model_t *pmodel) {
+    uint32_t changes = model_get_changes(pmodel, &generation);
+    if (changes == 0) {
+        return;
+    }
+
+    if (changes & MODEL_FIELD_MASK(MODEL_FIELD_STANDBY_DELAY)) {
+        standby_delay_ms = model_get_standby_delay_seconds(pmodel) * 1000UL;
+        if (standby_state == STANDBY_STATE_OFF) {
+            timer_wheel_start(standby_wheel, &standby_job, standby_delay_ms, get_millis());
+        }
+    }
+
     switch (standby_state) {
         case STANDBY_STATE_OFF:
-            if (is_expired(last_activity_ts, get_millis(), model_get_standby_delay_seconds(pmodel) * 1000UL)) {
-                last_activity_ts = get_millis();
-                standby_state    = STANDBY_STATE_ON;
+            if (changes & MODEL_FIELD_MASK(MODEL_FIELD_NORMAL_BRIGHTNESS)) {
+                // Follows a slider being dragged
+                tft_backlight_set(model_get_normal_brightness(pmodel));
             }
             break;
 
-        case STANDBY_STATE_POKED:
-            tft_backlight_set(model_get_normal_brightness(pmodel));
-            standby_state = STANDBY_STATE_OFF;
-            break;
-
         case STANDBY_STATE_ON:
-            tft_backlight_set(model_get_standby_brightness(pmodel));
+            if (changes & STANDBY_BRIGHTNESS_FIELDS) {
+                fade_to_standby_brightness();
+                follow_solar_curve();
+            }
             break;
     }
 }
 
 
+/*
+ * Called from within the main loop by the touch driver and when an alarm is due, so it can move the job directly
+ */
 void standby_poke(void) {
+    if (standby_wheel == NULL) {
+        return;
+    }
+
     if (standby_state == STANDBY_STATE_ON) {
-        standby_state = STANDBY_STATE_POKED;
+        leave_standby();
+    }
+    timer_wheel_start(standby_wheel, &standby_job, standby_delay_ms, get_millis());
+}
+
+
+static void enter_standby(void) {
+    standby_state  = STANDBY_STATE_ON;
+    standby_target = -1;
+    fade_to_standby_brightness();
+    follow_solar_curve();
+}
+
+
+static void leave_standby(void) {
+    standby_state = STANDBY_STATE_OFF;
+    timer_wheel_stop(standby_wheel, &curve_job);
+    timer_wheel_stop(standby_wheel, &dark_job);
+    controller_gui_set_dark(0);
+    tft_backlight_fade(model_get_normal_brightness(standby_model), STANDBY_WAKE_FADE_MS);
+}
+
+
+static void fade_to_standby_brightness(void) {
+    uint8_t brightness = model_get_standby_brightness(standby_model, clock_now());
+    if (brightness != standby_target) {
+        if (brightness == 0) {
+            timer_wheel_start(standby_wheel, &dark_job, STANDBY_FADE_MS, get_millis());
+        } else {
+            // The screen must be drawn before it lights up again, e.g. at dawn
+            timer_wheel_stop(standby_wheel, &dark_job);
+            controller_gui_set_dark(0);
+        }
+        tft_backlight_fade(brightness, STANDBY_FADE_MS);
+        standby_target = brightness;
     }
-    last_activity_ts = get_millis();
+}
+
+
+static void follow_solar_curve(void) {
+    if (standby_model->config.solar_schedule.enabled) {
+        if (!timer_wheel_is_armed(&curve_job)) {
+            timer_wheel_start(standby_wheel, &curve_job, STANDBY_CURVE_PERIOD_MS, get_millis());
+        }
+    } else {
+        timer_wheel_stop(standby_wheel, &curve_job);
+    }
+}
+
+
+static timer_wheel_outcome_t standby_job_cb(void *arg) {
+    (void)arg;
+    enter_standby();
+    return TIMER_WHEEL_JOB_STOP;
+}
+
+
+static timer_wheel_outcome_t curve_job_cb(void *arg) {
+    (void)arg;
+    fade_to_standby_brightness();
+    return TIMER_WHEEL_JOB_DONE;
+}
+
+
+static timer_wheel_outcome_t dark_job_cb(void *arg) {
+    (void)arg;
+    controller_gui_set_dark(1);
+    return TIMER_WHEEL_JOB_STOP;
 }
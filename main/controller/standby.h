@@ -2,6 +2,11 @@
 #define STANDBY_H_INCLUDED
 
 
+#include "model/model.h"
+#include "timer_wheel.h"
+
+
+void standby_init(timer_wheel_t *wheel, model_t *pmodel);
 void standby_manage(model_t *pmodel);
 void standby_poke(void);
 
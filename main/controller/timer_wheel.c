@@ -0,0 +1,339 @@
+#include <assert.h>
+#include <limits.h>
+#include "timer_wheel.h"
+
+
+#define SLOT_MASK          (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_BITS)
+// Ticks covered by the whole wheel; jobs due later are parked in the last slot they can reach and moved again
+#define WHEEL_RANGE ((uint32_t)1 << LEVEL_SHIFT(TIMER_WHEEL_LEVELS))
+
+
+static void     insert(timer_wheel_t *wheel, timer_wheel_job_t *job);
+static void     unlink_job(timer_wheel_t *wheel, timer_wheel_job_t *job);
+static void     set_tick(timer_wheel_t *wheel, uint32_t tick);
+static void     cascade(timer_wheel_t *wheel, size_t level, size_t slot);
+static size_t   expire(timer_wheel_t *wheel, size_t slot);
+static void     run(timer_wheel_t *wheel, timer_wheel_job_t *job);
+static void     apply(timer_wheel_t *wheel, timer_wheel_job_t *job, timer_wheel_outcome_t outcome, unsigned long delay);
+static void     schedule(timer_wheel_t *wheel, timer_wheel_job_t *job, unsigned long delay);
+static uint32_t next_random(timer_wheel_t *wheel);
+
+
+void timer_wheel_init(timer_wheel_t *wheel, unsigned long now) {
+    assert(wheel != NULL);
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (size_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot] = NULL;
+        }
+        wheel->occupied[level] = 0;
+    }
+    wheel->tick    = 0;
+    wheel->tick_ms = now;
+    wheel->seed    = 0x9E3779B9;
+}
+
+
+/*
+ * `jitter` spreads jobs with the same period over time. After a failure the job runs again after `retry`
+ * milliseconds, doubling up to `retry_max` until it succeeds; with no `retry` failures count as successes
+ */
+void timer_wheel_job_init(timer_wheel_job_t *job, timer_wheel_cb_t cb, void *arg, unsigned long period,
+                          unsigned long jitter, unsigned long retry, unsigned long retry_max) {
+    assert(job != NULL && cb != NULL);
+    job->next        = NULL;
+    job->pprev       = NULL;
+    job->deadline    = 0;
+    job->level       = 0;
+    job->slot        = 0;
+    job->cb          = cb;
+    job->arg         = arg;
+    job->period      = period;
+    job->jitter      = jitter;
+    job->retry       = retry;
+    job->retry_max   = retry_max > retry ? retry_max : retry;
+    job->retry_delay = retry;
+}
+
+
+/*
+ * Arms the job `delay` milliseconds after `now`, moving it if it was already armed
+ */
+void timer_wheel_start(timer_wheel_t *wheel, timer_wheel_job_t *job, unsigned long delay, unsigned long now) {
+    assert(wheel != NULL && job != NULL);
+    long offset = (long)(now - wheel->tick_ms);
+    schedule(wheel, job, (offset > 0 ? (unsigned long)offset : 0) + delay);
+}
+
+
+void timer_wheel_stop(timer_wheel_t *wheel, timer_wheel_job_t *job) {
+    assert(wheel != NULL && job != NULL);
+    if (timer_wheel_is_armed(job)) {
+        unlink_job(wheel, job);
+    }
+}
+
+
+/*
+ * For jobs that returned TIMER_WHEEL_JOB_PENDING and learn how they went later on, e.g. when an asynchronous request
+ * completes. The next run counts from `now`
+ */
+void timer_wheel_complete(timer_wheel_t *wheel, timer_wheel_job_t *job, timer_wheel_outcome_t outcome,
+                          unsigned long now) {
+    assert(wheel != NULL && job != NULL);
+    long offset = (long)(now - wheel->tick_ms);
+    apply(wheel, job, outcome, offset > 0 ? (unsigned long)offset : 0);
+}
+
+
+uint8_t timer_wheel_is_armed(const timer_wheel_job_t *job) {
+    assert(job != NULL);
+    return job->pprev != NULL;
+}
+
+
+/*
+ * Runs the jobs due up to `now` and returns how many ran. Empty slots are skipped through the bitmaps, so the cost
+ * does not depend on how long the loop slept
+ */
+size_t timer_wheel_dispatch(timer_wheel_t *wheel, unsigned long now) {
+    assert(wheel != NULL);
+    uint32_t target = wheel->tick + (uint32_t)((now - wheel->tick_ms) / TIMER_WHEEL_TICK_MS);
+    size_t   count  = 0;
+
+    while (wheel->tick != target) {
+        uint32_t index = wheel->tick & SLOT_MASK;
+        // The next occupied slot of the first level in this turn, or the start of the next turn
+        uint32_t next  = (wheel->tick | SLOT_MASK) + 1;
+        uint64_t ahead = index == SLOT_MASK ? 0 : wheel->occupied[0] & (~0ULL << (index + 1));
+        if (ahead != 0) {
+            next = wheel->tick - index + __builtin_ctzll(ahead);
+        }
+
+        if ((int32_t)(next - target) > 0) {
+            set_tick(wheel, target);
+            break;
+        }
+        set_tick(wheel, next);
+
+        if ((next & SLOT_MASK) == 0) {
+            // From the highest level that reached a new slot, so that jobs end up in the right slot below
+            size_t top = 1;
+            while (top < TIMER_WHEEL_LEVELS - 1 && ((next >> LEVEL_SHIFT(top)) & SLOT_MASK) == 0) {
+                top++;
+            }
+            for (size_t level = top; level > 0; level--) {
+                cascade(wheel, level, (next >> LEVEL_SHIFT(level)) & SLOT_MASK);
+            }
+        }
+
+        count += expire(wheel, next & SLOT_MASK);
+    }
+
+    return count;
+}
+
+
+/*
+ * Milliseconds from `now` to the earliest deadline, ULONG_MAX if no job is armed
+ */
+unsigned long timer_wheel_get_timeout(const timer_wheel_t *wheel, unsigned long now) {
+    assert(wheel != NULL);
+    uint8_t  found    = 0;
+    uint32_t earliest = 0;
+
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t occupied = wheel->occupied[level];
+        if (occupied == 0) {
+            continue;
+        }
+
+        // The slots of a level are in time order starting after the current one, which holds the farthest jobs
+        uint32_t turn    = wheel->tick >> LEVEL_SHIFT(level);
+        uint32_t start   = (turn + 1) & SLOT_MASK;
+        uint64_t rotated = start == 0 ? occupied : (occupied >> start) | (occupied << (TIMER_WHEEL_SLOTS - start));
+
+        while (rotated != 0) {
+            uint32_t offset = __builtin_ctzll(rotated);
+            rotated &= rotated - 1;
+
+            // No job is due before the slot begins; parked jobs are due later still, so the first slot is not
+            // necessarily the earliest
+            uint32_t begins = ((turn + 1 + offset) << LEVEL_SHIFT(level)) - wheel->tick;
+            if (found && begins >= earliest) {
+                break;
+            }
+
+            const timer_wheel_job_t *job = wheel->slots[level][(start + offset) & SLOT_MASK];
+            for (; job != NULL; job = job->next) {
+                uint32_t delta = job->deadline - wheel->tick;
+                if (!found || delta < earliest) {
+                    earliest = delta;
+                    found    = 1;
+                }
+            }
+        }
+    }
+
+    if (!found) {
+        return ULONG_MAX;
+    }
+
+    unsigned long timeout = (unsigned long)earliest * TIMER_WHEEL_TICK_MS;
+    unsigned long elapsed = now - wheel->tick_ms;
+    return timeout > elapsed ? timeout - elapsed : 0;
+}
+
+
+static void insert(timer_wheel_t *wheel, timer_wheel_job_t *job) {
+    uint32_t delta = job->deadline - wheel->tick;
+    uint32_t at    = job->deadline;
+    if (delta >= WHEEL_RANGE) {
+        delta = WHEEL_RANGE - 1;
+        at    = wheel->tick + delta;
+    }
+
+    size_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= ((uint32_t)1 << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+    size_t slot = (at >> LEVEL_SHIFT(level)) & SLOT_MASK;
+
+    timer_wheel_job_t **head = &wheel->slots[level][slot];
+    job->next                = *head;
+    job->pprev               = head;
+    if (*head != NULL) {
+        (*head)->pprev = &job->next;
+    }
+    *head      = job;
+    job->level = level;
+    job->slot  = slot;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+
+static void unlink_job(timer_wheel_t *wheel, timer_wheel_job_t *job) {
+    *job->pprev = job->next;
+    if (job->next != NULL) {
+        job->next->pprev = job->pprev;
+    }
+    job->next  = NULL;
+    job->pprev = NULL;
+
+    if (wheel->slots[job->level][job->slot] == NULL) {
+        wheel->occupied[job->level] &= ~(1ULL << job->slot);
+    }
+}
+
+
+static void set_tick(timer_wheel_t *wheel, uint32_t tick) {
+    wheel->tick_ms += (unsigned long)(tick - wheel->tick) * TIMER_WHEEL_TICK_MS;
+    wheel->tick = tick;
+}
+
+
+static void cascade(timer_wheel_t *wheel, size_t level, size_t slot) {
+    timer_wheel_job_t *job = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(1ULL << slot);
+
+    while (job != NULL) {
+        timer_wheel_job_t *next = job->next;
+        insert(wheel, job);
+        job = next;
+    }
+}
+
+
+static size_t expire(timer_wheel_t *wheel, size_t slot) {
+    size_t count = 0;
+
+    // One at a time, as callbacks may stop the other jobs of the slot
+    while (wheel->slots[0][slot] != NULL) {
+        timer_wheel_job_t *job = wheel->slots[0][slot];
+        unlink_job(wheel, job);
+        run(wheel, job);
+        count++;
+    }
+
+    return count;
+}
+
+
+static void run(timer_wheel_t *wheel, timer_wheel_job_t *job) {
+    timer_wheel_outcome_t outcome = job->cb(job->arg);
+    if (timer_wheel_is_armed(job)) {
+        // The callback started it again
+        return;
+    }
+
+    // Periods count from the deadline rather than from when the job ran, so they do not drift
+    apply(wheel, job, outcome, 0);
+}
+
+
+/*
+ * `delay` is added to the period or to the retry delay
+ */
+static void apply(timer_wheel_t *wheel, timer_wheel_job_t *job, timer_wheel_outcome_t outcome, unsigned long delay) {
+    if (outcome == TIMER_WHEEL_JOB_FAILED && job->retry == 0) {
+        outcome = TIMER_WHEEL_JOB_DONE;
+    }
+
+    switch (outcome) {
+        case TIMER_WHEEL_JOB_DONE:
+            job->retry_delay = job->retry;
+            // fallthrough
+        case TIMER_WHEEL_JOB_PENDING:
+            if (job->period > 0) {
+                unsigned long jitter = job->jitter > 0 ? next_random(wheel) % (job->jitter + 1) : 0;
+                schedule(wheel, job, delay + job->period + jitter);
+            } else if (timer_wheel_is_armed(job)) {
+                unlink_job(wheel, job);
+            }
+            break;
+
+        case TIMER_WHEEL_JOB_FAILED:
+            schedule(wheel, job, delay + job->retry_delay);
+            job->retry_delay = job->retry_delay > job->retry_max / 2 ? job->retry_max : job->retry_delay * 2;
+            break;
+
+        case TIMER_WHEEL_JOB_STOP:
+            if (timer_wheel_is_armed(job)) {
+                unlink_job(wheel, job);
+            }
+            break;
+    }
+}
+
+
+/*
+ * `delay` counts from the current tick of the wheel
+ */
+static void schedule(timer_wheel_t *wheel, timer_wheel_job_t *job, unsigned long delay) {
+    if (timer_wheel_is_armed(job)) {
+        unlink_job(wheel, job);
+    }
+
+    unsigned long ticks = (delay + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    if (ticks == 0) {
+        // The current tick was already dispatched
+        ticks = 1;
+    } else if (ticks > UINT32_MAX / 2) {
+        ticks = UINT32_MAX / 2;
+    }
+
+    job->deadline = wheel->tick + (uint32_t)ticks;
+    insert(wheel, job);
+}
+
+
+static uint32_t next_random(timer_wheel_t *wheel) {
+    // xorshift32
+    uint32_t x = wheel->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    wheel->seed = x;
+    return x;
+}
@@ -0,0 +1,69 @@
+#ifndef TIMER_WHEEL_H_INCLUDED
+#define TIMER_WHEEL_H_INCLUDED
+
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define TIMER_WHEEL_TICK_MS 10UL
+#define TIMER_WHEEL_LEVELS  4
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+
+
+typedef enum {
+    TIMER_WHEEL_JOB_DONE = 0,     // Runs again after its period
+    TIMER_WHEEL_JOB_PENDING,      // Runs again after its period unless timer_wheel_complete settles it first
+    TIMER_WHEEL_JOB_FAILED,       // Runs again after the retry delay, which doubles at every failure
+    TIMER_WHEEL_JOB_STOP,         // Stays idle until started again
+} timer_wheel_outcome_t;
+
+
+typedef timer_wheel_outcome_t (*timer_wheel_cb_t)(void *arg);
+
+
+typedef struct timer_wheel_job {
+    struct timer_wheel_job  *next;
+    struct timer_wheel_job **pprev;        // NULL while the job is not armed
+    uint32_t                 deadline;     // In ticks
+    uint8_t                  level;
+    uint8_t                  slot;
+
+    timer_wheel_cb_t cb;
+    void            *arg;
+    unsigned long    period;          // Milliseconds, 0 for a job that runs once
+    unsigned long    jitter;          // Up to this many milliseconds are added to every period
+    unsigned long    retry;           // Delay after the first failure
+    unsigned long    retry_max;       // Longest delay after consecutive failures
+    unsigned long    retry_delay;     // Delay after the next failure
+} timer_wheel_job_t;
+
+
+/*
+ * Hashed and hierarchical timing wheel: every level has TIMER_WHEEL_SLOTS lists of jobs, each slot of a level spanning
+ * a whole turn of the level below. Jobs move down a level when the level below wraps around, so starting, stopping
+ * and expiring are O(1) regardless of how many jobs are armed
+ */
+typedef struct {
+    timer_wheel_job_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t           occupied[TIMER_WHEEL_LEVELS];     // Bitmap of the non empty slots
+    uint32_t           tick;
+    unsigned long      tick_ms;                          // Milliseconds of `tick`
+    uint32_t           seed;                             // For the jitter
+} timer_wheel_t;
+
+
+void          timer_wheel_init(timer_wheel_t *wheel, unsigned long now);
+void          timer_wheel_job_init(timer_wheel_job_t *job, timer_wheel_cb_t cb, void *arg, unsigned long period,
+                                   unsigned long jitter, unsigned long retry, unsigned long retry_max);
+void          timer_wheel_start(timer_wheel_t *wheel, timer_wheel_job_t *job, unsigned long delay, unsigned long now);
+void          timer_wheel_stop(timer_wheel_t *wheel, timer_wheel_job_t *job);
+void          timer_wheel_complete(timer_wheel_t *wheel, timer_wheel_job_t *job, timer_wheel_outcome_t outcome,
+                                   unsigned long now);
+uint8_t       timer_wheel_is_armed(const timer_wheel_job_t *job);
+size_t        timer_wheel_dispatch(timer_wheel_t *wheel, unsigned long now);
+unsigned long timer_wheel_get_timeout(const timer_wheel_t *wheel, unsigned long now);
+
+
+#endif
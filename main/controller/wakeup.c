@@ -0,0 +1,33 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "wakeup.h"
+
+
+static TaskHandle_t main_task = NULL;
+
+
+/*
+ * Must be called by the task running the main loop
+ */
+void wakeup_init(void) {
+    main_task = xTaskGetCurrentTaskHandle();
+}
+
+
+/*
+ * May be called by any task. A notification sent while the main loop is busy is not lost: the next wait returns
+ * right away
+ */
+void wakeup_notify(void) {
+    if (main_task != NULL) {
+        xTaskNotifyGive(main_task);
+    }
+}
+
+
+/*
+ * Blocks the main loop for at most `timeout` milliseconds of real time, or until another task calls wakeup_notify
+ */
+void wakeup_wait(unsigned long timeout) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout));
+}
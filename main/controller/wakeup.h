@@ -0,0 +1,10 @@
+#ifndef WAKEUP_H_INCLUDED
+#define WAKEUP_H_INCLUDED
+
+
+void wakeup_init(void);
+void wakeup_notify(void);
+void wakeup_wait(unsigned long timeout);
+
+
+#endif
@@ -8,11 +8,14 @@
 #include "lvgl_helpers.h"
 #include "lvgl_i2c/i2c_manager.h"
 #include "model/model.h"
+#include "model/civil_time.h"
+#include "config/app_config.h"
 #include "view/view.h"
 #include "peripherals/storage.h"
 #include "controller/controller.h"
 #include "controller/standby.h"
 #include "controller/gui.h"
+#include "controller/wakeup.h"
 #include "controller/persistance.h"
 
 static const char *TAG   = "Main";
@@ -23,17 +26,18 @@ void app_main(void) {
     tft_init(standby_poke);
     storage_init();
 
-    setenv("TZ", "UTC-1CEST,M3.5.0,M10.5.0/3", 1);
+    setenv("TZ", APP_CONFIG_TIMEZONE, 1);
     tzset();
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
 
     model_updater_t updater = model_updater_init(&model);
-    persistance_load(&model);
+    persistance_load(updater);
     view_init(updater, controller_process_message, disp_driver_flush, tft_touch_read_cb);
     controller_init(updater);
 
     ESP_LOGI(TAG, "Begin main loop");
     for (;;) {
-        controller_manage(updater);
-        vTaskDelay(pdMS_TO_TICKS(1));
+        // Sleeps until the next deadline of the controller or until another task has news for it
+        wakeup_wait(controller_manage(updater));
     }
 }
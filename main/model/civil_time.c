@@ -0,0 +1,367 @@
+#include <assert.h>
+#include <ctype.h>
+#include "civil_time.h"
+
+
+#define SECONDS_IN_DAY  86400L
+#define SECONDS_IN_HOUR 3600L
+
+
+static const char *parse_name(const char *string);
+static const char *parse_number(const char *string, int32_t *value);
+static const char *parse_offset(const char *string, int32_t *seconds);
+static const char *parse_rule(const char *string, civil_time_rule_t *rule);
+static void        get_transitions(const civil_time_zone_t *zone, int32_t year, int64_t *start, int64_t *end);
+static int64_t     rule_epoch(const civil_time_rule_t *rule, int32_t year, int32_t offset);
+static void        civil_from_days(int64_t days, int32_t *year, uint32_t *month, uint32_t *day);
+static int64_t     floor_div(int64_t a, int64_t b);
+static uint8_t     weekday_from_days(int64_t days);
+
+
+static civil_time_zone_t local_zone = {0};
+
+
+/*
+ * Parses a POSIX TZ string such as "UTC-1CEST,M3.5.0,M10.5.0/3".
+ * Only the Mm.w.d form is supported for DST rules.
+ * Returns 0 on success, -1 on a malformed or unsupported string (the zone is left untouched)
+ */
+int civil_time_zone_parse(civil_time_zone_t *zone, const char *posix_tz) {
+    assert(zone != NULL);
+    civil_time_zone_t result = {0};
+    int32_t           offset = 0;
+
+    if (posix_tz == NULL || (posix_tz = parse_name(posix_tz)) == NULL ||
+        (posix_tz = parse_offset(posix_tz, &offset)) == NULL) {
+        return -1;
+    }
+    // POSIX offsets are west of UTC
+    result.std_offset = -offset;
+    result.dst_offset = result.std_offset;
+
+    if (*posix_tz != '\0') {
+        if ((posix_tz = parse_name(posix_tz)) == NULL) {
+            return -1;
+        }
+
+        result.has_dst    = 1;
+        result.dst_offset = result.std_offset + SECONDS_IN_HOUR;
+        if (*posix_tz != ',' && *posix_tz != '\0') {
+            if ((posix_tz = parse_offset(posix_tz, &offset)) == NULL) {
+                return -1;
+            }
+            result.dst_offset = -offset;
+        }
+
+        if (*posix_tz == '\0') {
+            // Same default as glibc
+            posix_tz = ",M3.2.0,M11.1.0";
+        }
+
+        if (*posix_tz != ',' || (posix_tz = parse_rule(posix_tz + 1, &result.dst_start)) == NULL ||
+            *posix_tz != ',' || (posix_tz = parse_rule(posix_tz + 1, &result.dst_end)) == NULL ||
+            *posix_tz != '\0') {
+            return -1;
+        }
+    }
+
+    *zone = result;
+    civil_time_zone_prepare(zone, 0);
+    return 0;
+}
+
+
+/*
+ * Precomputes the DST transitions for the year of `now` and the following one
+ */
+void civil_time_zone_prepare(civil_time_zone_t *zone, int64_t now) {
+    assert(zone != NULL);
+    int32_t  year  = 0;
+    uint32_t month = 0, day = 0;
+    civil_from_days(floor_div(now + zone->std_offset, SECONDS_IN_DAY), &year, &month, &day);
+
+    zone->cached_year = year;
+    for (int32_t i = 0; i < 2; i++) {
+        zone->transitions[i][0] = rule_epoch(&zone->dst_start, year + i, zone->std_offset);
+        zone->transitions[i][1] = rule_epoch(&zone->dst_end, year + i, zone->dst_offset);
+    }
+}
+
+
+int32_t civil_time_zone_offset(const civil_time_zone_t *zone, int64_t timestamp, uint8_t *is_dst) {
+    assert(zone != NULL);
+    uint8_t dst = 0;
+
+    if (zone->has_dst) {
+        int32_t  year  = 0;
+        uint32_t month = 0, day = 0;
+        int64_t  start = 0, end = 0;
+        civil_from_days(floor_div(timestamp + zone->std_offset, SECONDS_IN_DAY), &year, &month, &day);
+        get_transitions(zone, year, &start, &end);
+
+        if (start < end) {
+            dst = timestamp >= start && timestamp < end;
+        } else {
+            // Southern hemisphere: DST spans the new year
+            dst = timestamp < end || timestamp >= start;
+        }
+    }
+
+    if (is_dst != NULL) {
+        *is_dst = dst;
+    }
+    return dst ? zone->dst_offset : zone->std_offset;
+}
+
+
+/*
+ * The first DST transition after `timestamp` among the prepared ones, INT64_MAX if the zone has no DST.
+ * If the zone was prepared for an earlier year there may be none left: the following day is returned, to check again
+ */
+int64_t civil_time_zone_next_transition(const civil_time_zone_t *zone, int64_t timestamp) {
+    assert(zone != NULL);
+    if (!zone->has_dst) {
+        return INT64_MAX;
+    }
+
+    int64_t next = INT64_MAX;
+    for (size_t i = 0; i < 2; i++) {
+        for (size_t j = 0; j < 2; j++) {
+            if (zone->transitions[i][j] > timestamp && zone->transitions[i][j] < next) {
+                next = zone->transitions[i][j];
+            }
+        }
+    }
+    return next != INT64_MAX ? next : timestamp + SECONDS_IN_DAY;
+}
+
+
+struct tm civil_time_from_epoch(const civil_time_zone_t *zone, int64_t timestamp) {
+    assert(zone != NULL);
+    uint8_t  dst   = 0;
+    int64_t  local = timestamp + civil_time_zone_offset(zone, timestamp, &dst);
+    int64_t  days  = floor_div(local, SECONDS_IN_DAY);
+    int64_t  secs  = local - days * SECONDS_IN_DAY;
+    int32_t  year  = 0;
+    uint32_t month = 0, day = 0;
+    civil_from_days(days, &year, &month, &day);
+
+    struct tm result = {
+        .tm_year  = year - 1900,
+        .tm_mon   = month - 1,
+        .tm_mday  = day,
+        .tm_hour  = secs / SECONDS_IN_HOUR,
+        .tm_min   = (secs % SECONDS_IN_HOUR) / 60,
+        .tm_sec   = secs % 60,
+        .tm_wday  = weekday_from_days(days),
+        .tm_yday  = days - civil_time_days_from_civil(year, 1, 1),
+        .tm_isdst = dst,
+    };
+    return result;
+}
+
+
+/*
+ * Same contract as mktime: out of range fields are normalized and `tm` is rewritten with the resulting time.
+ * Local times skipped by a DST transition are read as standard time; repeated ones are read as daylight saving time
+ * unless `tm_isdst` is zero, like glibc does.
+ */
+int64_t civil_time_to_epoch(const civil_time_zone_t *zone, struct tm *tm) {
+    assert(zone != NULL && tm != NULL);
+    int64_t year  = tm->tm_year + 1900LL;
+    int64_t month = tm->tm_mon;
+    year += floor_div(month, 12);
+    month -= floor_div(month, 12) * 12;
+
+    int64_t days  = civil_time_days_from_civil(year, month + 1, 1) + tm->tm_mday - 1;
+    int64_t local = days * SECONDS_IN_DAY + tm->tm_hour * SECONDS_IN_HOUR + tm->tm_min * 60LL + tm->tm_sec;
+
+    int64_t std_timestamp = local - zone->std_offset;
+    int64_t dst_timestamp = local - zone->dst_offset;
+    uint8_t std_is_dst = 0, dst_is_dst = 0;
+    civil_time_zone_offset(zone, std_timestamp, &std_is_dst);
+    civil_time_zone_offset(zone, dst_timestamp, &dst_is_dst);
+
+    int64_t timestamp = std_timestamp;
+    if (dst_is_dst && (std_is_dst || tm->tm_isdst != 0)) {
+        timestamp = dst_timestamp;
+    }
+
+    *tm = civil_time_from_epoch(zone, timestamp);
+    return timestamp;
+}
+
+
+int64_t civil_time_days_from_civil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    int64_t  era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yoe = (uint32_t)(year - era * 400);
+    uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+
+uint8_t civil_time_days_in_month(int32_t year, uint32_t month) {
+    static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+        return 29;
+    } else {
+        return days[(month - 1) % 12];
+    }
+}
+
+
+int civil_time_set_local(const char *posix_tz) {
+    return civil_time_zone_parse(&local_zone, posix_tz);
+}
+
+
+const civil_time_zone_t *civil_time_get_local(void) {
+    return &local_zone;
+}
+
+
+void civil_time_prepare_local(time_t now) {
+    civil_time_zone_prepare(&local_zone, now);
+}
+
+
+struct tm civil_time_localtime(time_t timestamp) {
+    return civil_time_from_epoch(&local_zone, timestamp);
+}
+
+
+time_t civil_time_mktime(struct tm *tm) {
+    return (time_t)civil_time_to_epoch(&local_zone, tm);
+}
+
+
+static void get_transitions(const civil_time_zone_t *zone, int32_t year, int64_t *start, int64_t *end) {
+    if (year == zone->cached_year || year == zone->cached_year + 1) {
+        *start = zone->transitions[year - zone->cached_year][0];
+        *end   = zone->transitions[year - zone->cached_year][1];
+    } else {
+        *start = rule_epoch(&zone->dst_start, year, zone->std_offset);
+        *end   = rule_epoch(&zone->dst_end, year, zone->dst_offset);
+    }
+}
+
+
+static int64_t rule_epoch(const civil_time_rule_t *rule, int32_t year, int32_t offset) {
+    if (rule->month == 0) {
+        return 0;
+    }
+
+    int64_t first = civil_time_days_from_civil(year, rule->month, 1);
+    int32_t day   = 1 + (rule->weekday - weekday_from_days(first) + 7) % 7 + (rule->week - 1) * 7;
+    while (day > civil_time_days_in_month(year, rule->month)) {
+        day -= 7;
+    }
+
+    return (first + day - 1) * SECONDS_IN_DAY + rule->time - offset;
+}
+
+
+static void civil_from_days(int64_t days, int32_t *year, uint32_t *month, uint32_t *day) {
+    days += 719468;
+    int64_t  era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t doe = (uint32_t)(days - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp  = (5 * doy + 2) / 153;
+
+    *day   = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year  = (int32_t)(yoe + era * 400) + (*month <= 2);
+}
+
+
+static uint8_t weekday_from_days(int64_t days) {
+    // 1970-01-01 was a Thursday
+    int64_t weekday = (days + 4) % 7;
+    return weekday < 0 ? weekday + 7 : weekday;
+}
+
+
+static int64_t floor_div(int64_t a, int64_t b) {
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+
+static const char *parse_name(const char *string) {
+    const char *start = string;
+
+    if (*string == '<') {
+        while (*string != '\0' && *string != '>') {
+            string++;
+        }
+        return *string == '>' ? string + 1 : NULL;
+    }
+
+    while (isalpha((unsigned char)*string)) {
+        string++;
+    }
+    return string - start >= 3 ? string : NULL;
+}
+
+
+static const char *parse_number(const char *string, int32_t *value) {
+    if (!isdigit((unsigned char)*string)) {
+        return NULL;
+    }
+
+    *value = 0;
+    while (isdigit((unsigned char)*string)) {
+        *value = *value * 10 + (*string - '0');
+        string++;
+    }
+    return string;
+}
+
+
+static const char *parse_offset(const char *string, int32_t *seconds) {
+    int32_t sign = 1, hours = 0, minutes = 0, secs = 0;
+
+    if (*string == '+' || *string == '-') {
+        sign = *string == '-' ? -1 : 1;
+        string++;
+    }
+
+    if ((string = parse_number(string, &hours)) == NULL) {
+        return NULL;
+    }
+    if (*string == ':' && (string = parse_number(string + 1, &minutes)) != NULL && *string == ':') {
+        string = parse_number(string + 1, &secs);
+    }
+    if (string == NULL) {
+        return NULL;
+    }
+
+    *seconds = sign * (hours * SECONDS_IN_HOUR + minutes * 60 + secs);
+    return string;
+}
+
+
+static const char *parse_rule(const char *string, civil_time_rule_t *rule) {
+    int32_t month = 0, week = 0, weekday = 0;
+
+    if (*string != 'M' || (string = parse_number(string + 1, &month)) == NULL || *string != '.' ||
+        (string = parse_number(string + 1, &week)) == NULL || *string != '.' ||
+        (string = parse_number(string + 1, &weekday)) == NULL) {
+        return NULL;
+    }
+    if (month < 1 || month > 12 || week < 1 || week > 5 || weekday > 6) {
+        return NULL;
+    }
+
+    rule->month   = month;
+    rule->week    = week;
+    rule->weekday = weekday;
+    rule->time    = 2 * SECONDS_IN_HOUR;
+
+    if (*string == '/') {
+        string = parse_offset(string + 1, &rule->time);
+    }
+    return string;
+}
@@ -0,0 +1,46 @@
+#ifndef CIVIL_TIME_H_INCLUDED
+#define CIVIL_TIME_H_INCLUDED
+
+
+#include <stdint.h>
+#include <time.h>
+
+
+typedef struct {
+    uint8_t month;       // 1 - 12
+    uint8_t week;        // 1 - 5, where 5 is the last week of the month
+    uint8_t weekday;     // 0 - 6, starting from Sunday
+    int32_t time;        // Local seconds after midnight
+} civil_time_rule_t;
+
+
+typedef struct {
+    int32_t           std_offset;     // Seconds east of UTC during standard time
+    int32_t           dst_offset;     // Seconds east of UTC during daylight saving time
+    uint8_t           has_dst;
+    civil_time_rule_t dst_start;
+    civil_time_rule_t dst_end;
+
+    // UTC epochs of the DST transitions for `cached_year` and the following one
+    int32_t cached_year;
+    int64_t transitions[2][2];
+} civil_time_zone_t;
+
+
+int        civil_time_zone_parse(civil_time_zone_t *zone, const char *posix_tz);
+void       civil_time_zone_prepare(civil_time_zone_t *zone, int64_t now);
+int32_t    civil_time_zone_offset(const civil_time_zone_t *zone, int64_t timestamp, uint8_t *is_dst);
+int64_t    civil_time_zone_next_transition(const civil_time_zone_t *zone, int64_t timestamp);
+struct tm  civil_time_from_epoch(const civil_time_zone_t *zone, int64_t timestamp);
+int64_t    civil_time_to_epoch(const civil_time_zone_t *zone, struct tm *tm);
+int64_t    civil_time_days_from_civil(int32_t year, uint32_t month, uint32_t day);
+uint8_t    civil_time_days_in_month(int32_t year, uint32_t month);
+
+int                      civil_time_set_local(const char *posix_tz);
+const civil_time_zone_t *civil_time_get_local(void);
+void                     civil_time_prepare_local(time_t now);
+struct tm                civil_time_localtime(time_t timestamp);
+time_t                   civil_time_mktime(struct tm *tm);
+
+
+#endif
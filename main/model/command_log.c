@@ -0,0 +1,128 @@
+#include <assert.h>
+#include <string.h>
+#include "command_log.h"
+
+
+static void write_bytes(command_log_t *log, size_t offset, const void *bytes, size_t len);
+static void read_bytes(const command_log_t *log, size_t offset, void *bytes, size_t len);
+static void drop_oldest(command_log_t *log);
+
+
+void command_log_init(command_log_t *log, uint8_t *buffer, size_t capacity) {
+    assert(log != NULL && buffer != NULL && capacity > 0);
+    log->buffer   = buffer;
+    log->capacity = capacity;
+    command_log_clear(log);
+}
+
+
+/*
+ * Replaces the content of the log with `len` bytes previously obtained from command_log_copy
+ */
+void command_log_restore(command_log_t *log, const uint8_t *bytes, size_t len) {
+    assert(log != NULL && bytes != NULL && len <= log->capacity);
+    command_log_clear(log);
+    memcpy(log->buffer, bytes, len);
+    log->size = len;
+}
+
+
+void command_log_clear(command_log_t *log) {
+    assert(log != NULL);
+    log->start   = 0;
+    log->size    = 0;
+    log->dropped = 0;
+}
+
+
+/*
+ * Returns -1 if the record is larger than the whole log
+ */
+int command_log_append(command_log_t *log, const model_command_t *command, const void *payload) {
+    assert(log != NULL && command != NULL && (payload != NULL || command->len == 0));
+    size_t needed = sizeof(*command) + command->len;
+
+    if (needed > log->capacity) {
+        return -1;
+    }
+    while (log->size + needed > log->capacity) {
+        drop_oldest(log);
+    }
+
+    write_bytes(log, log->size, command, sizeof(*command));
+    if (command->len > 0) {
+        write_bytes(log, log->size + sizeof(*command), payload, command->len);
+    }
+    log->size += needed;
+    return 0;
+}
+
+
+/*
+ * Reads the record at `cursor` (0 for the oldest) and returns the cursor of the next one, or 0 at the end.
+ * `payload` must have room for 255 bytes
+ */
+size_t command_log_read(const command_log_t *log, size_t cursor, model_command_t *command, void *payload) {
+    assert(log != NULL && command != NULL && payload != NULL);
+    if (cursor + sizeof(*command) > log->size) {
+        return 0;
+    }
+
+    read_bytes(log, cursor, command, sizeof(*command));
+    read_bytes(log, cursor + sizeof(*command), payload, command->len);
+    return cursor + sizeof(*command) + command->len;
+}
+
+
+/*
+ * Copies the records in order, oldest first; returns the number of bytes copied
+ */
+size_t command_log_copy(const command_log_t *log, uint8_t *bytes, size_t max) {
+    assert(log != NULL && bytes != NULL);
+    size_t len = log->size < max ? log->size : max;
+    read_bytes(log, 0, bytes, len);
+    return len;
+}
+
+
+size_t command_log_get_size(const command_log_t *log) {
+    assert(log != NULL);
+    return log->size;
+}
+
+
+/*
+ * Records dropped to make room since the log was last cleared
+ */
+uint32_t command_log_get_dropped(const command_log_t *log) {
+    assert(log != NULL);
+    return log->dropped;
+}
+
+
+static void drop_oldest(command_log_t *log) {
+    model_command_t command = {0};
+    read_bytes(log, 0, &command, sizeof(command));
+
+    size_t len = sizeof(command) + command.len;
+    log->start = (log->start + len) % log->capacity;
+    log->size -= len;
+    log->dropped++;
+}
+
+
+// Offsets are relative to the oldest record and wrap around the end of the buffer
+static void write_bytes(command_log_t *log, size_t offset, const void *bytes, size_t len) {
+    size_t position = (log->start + offset) % log->capacity;
+    size_t first    = len < log->capacity - position ? len : log->capacity - position;
+    memcpy(&log->buffer[position], bytes, first);
+    memcpy(log->buffer, (const uint8_t *)bytes + first, len - first);
+}
+
+
+static void read_bytes(const command_log_t *log, size_t offset, void *bytes, size_t len) {
+    size_t position = (log->start + offset) % log->capacity;
+    size_t first    = len < log->capacity - position ? len : log->capacity - position;
+    memcpy(bytes, &log->buffer[position], first);
+    memcpy((uint8_t *)bytes + first, log->buffer, len - first);
+}
@@ -0,0 +1,63 @@
+#ifndef COMMAND_LOG_H_INCLUDED
+#define COMMAND_LOG_H_INCLUDED
+
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/*
+ * The payload of a batched alarm is the rest of its alarm_record_t: recurrence, weekdays, duration (two bytes, little
+ * endian) and the description
+ */
+typedef enum {
+    MODEL_COMMAND_SET_FIELD = 0,                  // target: model_field_t, value: the new value
+    MODEL_COMMAND_ADD_ALARM,                      // target: alarm number, value: day | month << 8 | year << 16
+    MODEL_COMMAND_SET_ALARM_TIME,                 // target: alarm number, value: timestamp
+    MODEL_COMMAND_SET_ALARM_RECURRENCE,           // target: alarm number, value: recurrence | weekdays << 8
+    MODEL_COMMAND_SET_ALARM_DESCRIPTION,          // target: alarm number, payload: the description
+    MODEL_COMMAND_DELETE_ALARM,                   // target: alarm number
+    MODEL_COMMAND_BEGIN_ALARM_BATCH,              //
+    MODEL_COMMAND_BATCH_ADD_ALARM,                // value: timestamp, payload: rest of the record
+    MODEL_COMMAND_BATCH_REPLACE_ALARM,            // Same as above, target: alarm number
+    MODEL_COMMAND_COMMIT_ALARM_BATCH,             //
+    MODEL_COMMAND_SET_ALARM_DURATION,             // target: alarm number, value: minutes
+    MODEL_COMMAND_SET_WORLD_CLOCK_CITY,           // target: zone, value: city
+    MODEL_COMMAND_SET_SOLAR_LOCATION,             // value: latitude | longitude << 16, hundredths of a degree
+} model_command_tag_t;
+
+
+/*
+ * Header of a record; `len` bytes of payload follow it in the log
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  tag;
+    uint8_t  len;
+    uint16_t target;
+    uint32_t value;
+} model_command_t;
+
+
+/*
+ * Ring of variable length records over a caller provided buffer. When full, the oldest records are dropped.
+ */
+typedef struct {
+    uint8_t *buffer;
+    size_t   capacity;
+    size_t   start;       // Offset of the oldest record
+    size_t   size;        // Bytes in use
+    uint32_t dropped;     // Records dropped to make room
+} command_log_t;
+
+
+void     command_log_init(command_log_t *log, uint8_t *buffer, size_t capacity);
+void     command_log_restore(command_log_t *log, const uint8_t *bytes, size_t len);
+void     command_log_clear(command_log_t *log);
+int      command_log_append(command_log_t *log, const model_command_t *command, const void *payload);
+size_t   command_log_read(const command_log_t *log, size_t cursor, model_command_t *command, void *payload);
+size_t   command_log_copy(const command_log_t *log, uint8_t *bytes, size_t max);
+size_t   command_log_get_size(const command_log_t *log);
+uint32_t command_log_get_dropped(const command_log_t *log);
+
+
+#endif
@@ -0,0 +1,80 @@
+#include <assert.h>
+#include <string.h>
+#include "message_ring.h"
+
+
+/*
+ * `buffer` holds `capacity` messages of `item_size` bytes
+ */
+void message_ring_init(message_ring_t *ring, void *buffer, size_t item_size, size_t capacity) {
+    assert(ring != NULL && buffer != NULL);
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    ring->buffer    = buffer;
+    ring->item_size = item_size;
+    ring->capacity  = capacity;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+
+/*
+ * Producer side. Returns 0 if the ring is full
+ */
+uint8_t message_ring_push(message_ring_t *ring, const void *item) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    // Acquire, so that the consumer is done with the slot before it is overwritten
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == ring->capacity) {
+        return 0;
+    }
+
+    memcpy(&ring->buffer[(head & (ring->capacity - 1)) * ring->item_size], item, ring->item_size);
+    // Release, so that the message is complete when the consumer sees it
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 1;
+}
+
+
+/*
+ * Consumer side. Returns 0 if the ring is empty
+ */
+uint8_t message_ring_pop(message_ring_t *ring, void *item) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return 0;
+    }
+
+    memcpy(item, &ring->buffer[(tail & (ring->capacity - 1)) * ring->item_size], ring->item_size);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+
+/*
+ * Consumer side. Copies up to `max` messages to `items` with a single exchange with the producer and returns how
+ * many there were
+ */
+size_t message_ring_pop_batch(message_ring_t *ring, void *items, size_t max) {
+    size_t tail  = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head  = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = head - tail < max ? head - tail : max;
+
+    uint8_t *destination = items;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&destination[i * ring->item_size], &ring->buffer[((tail + i) & (ring->capacity - 1)) * ring->item_size],
+               ring->item_size);
+    }
+
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+
+/*
+ * Consumer side. Discards every message written so far
+ */
+void message_ring_clear(message_ring_t *ring) {
+    atomic_store_explicit(&ring->tail, atomic_load_explicit(&ring->head, memory_order_acquire), memory_order_release);
+}
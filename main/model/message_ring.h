@@ -0,0 +1,30 @@
+#ifndef MESSAGE_RING_H_INCLUDED
+#define MESSAGE_RING_H_INCLUDED
+
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/*
+ * Lock free queue of fixed size messages between exactly one producer task and one consumer task. Neither side ever
+ * blocks: a full ring rejects the message and an empty one returns nothing, waking the other side is up to the caller
+ */
+typedef struct {
+    uint8_t      *buffer;
+    size_t        item_size;
+    size_t        capacity;     // Power of two
+    atomic_size_t head;         // Messages written, only moved by the producer
+    atomic_size_t tail;         // Messages read, only moved by the consumer
+} message_ring_t;
+
+
+void    message_ring_init(message_ring_t *ring, void *buffer, size_t item_size, size_t capacity);
+uint8_t message_ring_push(message_ring_t *ring, const void *item);
+uint8_t message_ring_pop(message_ring_t *ring, void *item);
+size_t  message_ring_pop_batch(message_ring_t *ring, void *items, size_t max);
+void    message_ring_clear(message_ring_t *ring);
+
+
+#endif
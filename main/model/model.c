@@ -3,12 +3,58 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "model.h"
+#include "civil_time.h"
+#include "world_clock.h"
+#include "solar.h"
 #include <esp_log.h>
 #include "config/app_config.h"
+#include "services/clock.h"
 
 
 #define SECONDS_IN_DAY (24UL * 60UL * 60UL)
 
+// RAM taken by every slot of the alarm table, descriptions excluded
+#define ALARM_SLOT_SIZE                                                                                                \
+    (sizeof(alarm_t) + sizeof(*((model_t *)0)->run.alarm_index) + sizeof(*((model_t *)0)->run.occurrences) +           \
+     sizeof(*((model_t *)0)->run.recurring) + sizeof(*((model_t *)0)->run.max_ends))
+#define MIN_ALARMS_CAPACITY 16
+// Alarm numbers double as arena owner tags
+#define MAX_ALARMS_CAPACITY (UINT16_MAX - 1)
+
+// The old fixed table: 64 alarms with a 64 bit timestamp and a 65 bytes description, padded to 80 bytes
+#define LEGACY_ALARMS     64
+#define LEGACY_SLOT_SIZE  80
+#define LEGACY_STORE_SIZE (LEGACY_ALARMS * LEGACY_SLOT_SIZE)
+
+// Occurrences of recurring alarms on a day merged at a time with the index
+#define DAY_RULES_BATCH 16
+
+
+typedef struct {
+    uint64_t occurrence;
+    uint16_t num;
+} day_rule_t;
+
+
+static time_t   today_start(model_t *pmodel, time_t now);
+static void     update_today_bounds(mut_model_t *pmodel, time_t now);
+static void     sort_alarm_index(mut_model_t *pmodel);
+static uint8_t  index_precedes(model_t *pmodel, uint16_t first, uint16_t second);
+static size_t   index_upper_bound(model_t *pmodel, size_t low, size_t high, uint16_t alarm_num);
+static void     update_max_ends(mut_model_t *pmodel);
+static uint32_t clamped_end(model_t *pmodel, uint16_t alarm_num);
+static size_t   max_ends_lower_bound(model_t *pmodel, uint64_t timestamp);
+static uint64_t occurrence_on(const alarm_t *alarm, const struct tm *day_tm);
+static uint8_t  rule_matches(const alarm_t *alarm, const struct tm *alarm_tm, const struct tm *day_tm);
+static size_t   collect_day_rules(model_t *pmodel, const struct tm *day_tm, time_t from, const day_rule_t *after,
+                                  day_rule_t *rules);
+static uint8_t  day_rule_precedes(const day_rule_t *first, const day_rule_t *second);
+static uint32_t night_mode_config_generation(model_t *pmodel);
+static uint8_t  ramp(uint8_t level, int64_t elapsed, int64_t length);
+static uint64_t seconds_of_day_after(const struct tm *day_tm, uint32_t seconds, int days);
+static int      grow_array(void **array, size_t capacity, size_t item_size);
+static void     relocate_description(void *arg, uint16_t owner, uint16_t offset);
+
 
 static const char *TAG = "Model";
 
@@ -17,7 +63,9 @@ void model_init(mut_model_t *pmodel) {
     assert(pmodel != NULL);
     (void)TAG;
 
-    memset(pmodel->config.alarms, 0, sizeof(pmodel->config.alarms));
+    pmodel->config.alarms                = NULL;
+    pmodel->config.alarms_capacity       = 0;
+    string_arena_init(&pmodel->config.descriptions);
     pmodel->config.military_time         = 1;
     pmodel->config.num_alarms            = 0;
     pmodel->config.normal_brightness     = 80;
@@ -26,6 +74,15 @@ void model_init(mut_model_t *pmodel) {
     pmodel->config.night_mode            = 0;
     pmodel->config.night_mode_start      = 0;
     pmodel->config.night_mode_end        = 0;
+    pmodel->config.world_clock.enabled   = 0;
+    pmodel->config.solar_schedule.enabled   = 0;
+    pmodel->config.solar_schedule.latitude  = APP_CONFIG_LATITUDE;
+    pmodel->config.solar_schedule.longitude = APP_CONFIG_LONGITUDE;
+    for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+        pmodel->config.world_clock.cities[i]    = i < world_clock_get_city_count() ? i : WORLD_CLOCK_NO_CITY;
+        pmodel->run.world_clock.zones[i].city   = WORLD_CLOCK_NO_CITY;
+        pmodel->run.world_clock.zones[i].offset = 0;
+    }
 
     pmodel->run.ap_list_size                     = 0;
     pmodel->run.ip_addr                          = 0;
@@ -39,6 +96,24 @@ void model_init(mut_model_t *pmodel) {
     pmodel->run.latest_release_minor             = 0;
     pmodel->run.latest_release_patch             = 0;
     strcpy(pmodel->run.ssid, "");
+    pmodel->run.alarm_index   = NULL;
+    pmodel->run.occurrences   = NULL;
+    pmodel->run.recurring     = NULL;
+    pmodel->run.num_recurring = 0;
+    pmodel->run.max_ends      = NULL;
+    pmodel->run.today.start   = 0;
+    pmodel->run.today.end     = 0;
+    pmodel->run.generation    = 0;
+    memset(pmodel->run.generations, 0, sizeof(pmodel->run.generations));
+    pmodel->run.night.active            = 0;
+    pmodel->run.night.from              = 0;
+    pmodel->run.night.until             = 0;
+    pmodel->run.night.config_generation = 0;
+    pmodel->run.world_clock.from        = 0;
+    pmodel->run.world_clock.until       = 0;
+    pmodel->run.solar.from              = 0;
+    pmodel->run.solar.until             = 0;
+    model_rebuild_alarm_index(pmodel);
 }
 
 
@@ -68,49 +143,274 @@ firmware_update_state_t model_get_firmware_update_state(model_t *pmodel) {
 }
 
 
-uint8_t model_get_standby_brightness(model_t *pmodel) {
+/*
+ * The solar schedule replaces the night mode window when enabled: dark at night, ramping up to the standby brightness
+ * from dawn to sunrise and back down from sunset to dusk
+ */
+uint8_t model_get_standby_brightness(model_t *pmodel, uint64_t now) {
     assert(pmodel != NULL);
     // During FUP keep the brightness up to make sure the user can interact with the display
     if (model_get_firmware_update_state(pmodel).tag != FIRMWARE_UPDATE_STATE_TAG_NONE) {
         return pmodel->config.normal_brightness;
-    } else if (pmodel->config.night_mode) {
-        time_t    now    = time(NULL);
-        struct tm now_tm = *localtime(&now);
+    } else if (pmodel->config.solar_schedule.enabled) {
+        // Kept up to date by the controller, see model_update_solar_schedule
+        int64_t time = (int64_t)now;
+        uint8_t day  = pmodel->config.standby_brightness;
+        if (time < pmodel->run.solar.dawn || time >= pmodel->run.solar.dusk) {
+            return 0;
+        } else if (time < pmodel->run.solar.sunrise) {
+            return ramp(day, time - pmodel->run.solar.dawn, pmodel->run.solar.sunrise - pmodel->run.solar.dawn);
+        } else if (time < pmodel->run.solar.sunset) {
+            return day;
+        } else {
+            return ramp(day, pmodel->run.solar.dusk - time, pmodel->run.solar.dusk - pmodel->run.solar.sunset);
+        }
+    } else if (pmodel->config.night_mode && pmodel->run.night.active) {
+        // Kept up to date by the controller, see model_update_night_mode
+        return 0;
+    } else {
+        return pmodel->config.standby_brightness;
+    }
+}
 
-        uint32_t seconds_now = now_tm.tm_hour * 60 * 60 + now_tm.tm_min * 60 + now_tm.tm_sec;
 
-        if (pmodel->config.night_mode_start > pmodel->config.night_mode_end) {
-            if (seconds_now > pmodel->config.night_mode_start || seconds_now < pmodel->config.night_mode_end) {
-                return 0;
-            } else {
-                return pmodel->config.standby_brightness;
-            }
+uint8_t model_is_night_mode_stale(model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    return now < pmodel->run.night.from || now >= pmodel->run.night.until ||
+           pmodel->run.night.config_generation != night_mode_config_generation(pmodel);
+}
+
+
+/*
+ * Computes whether `now` falls in the night mode window and when that changes next.
+ * The window goes from `night_mode_start` to `night_mode_end` (local seconds after midnight) and may span midnight
+ */
+void model_update_night_mode(mut_model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    uint32_t  start  = pmodel->config.night_mode_start;
+    uint32_t  end    = pmodel->config.night_mode_end;
+    struct tm now_tm = civil_time_localtime(now);
+    uint32_t  second = now_tm.tm_hour * 60 * 60 + now_tm.tm_min * 60 + now_tm.tm_sec;
+
+    uint8_t  active = 0;
+    uint64_t until  = 0;
+    if (start == end) {
+        // Empty window; check again tomorrow anyway
+        until = seconds_of_day_after(&now_tm, 0, 1);
+    } else if (start < end) {
+        // The window opens the second after `start`, as it always did
+        active = second > start && second < end;
+        if (second <= start) {
+            until = seconds_of_day_after(&now_tm, start + 1, 0);
+        } else if (second < end) {
+            until = seconds_of_day_after(&now_tm, end, 0);
         } else {
-            if (seconds_now > pmodel->config.night_mode_start && seconds_now < pmodel->config.night_mode_end) {
-                return 0;
-            } else {
-                return pmodel->config.standby_brightness;
-            }
+            until = seconds_of_day_after(&now_tm, start + 1, 1);
         }
     } else {
-        return pmodel->config.standby_brightness;
+        active = second > start || second < end;
+        if (second < end) {
+            until = seconds_of_day_after(&now_tm, end, 0);
+        } else if (second <= start) {
+            until = seconds_of_day_after(&now_tm, start + 1, 0);
+        } else {
+            until = seconds_of_day_after(&now_tm, end, 1);
+        }
+    }
+
+    pmodel->run.night.from              = now;
+    pmodel->run.night.until             = until > now ? until : now + 1;
+    pmodel->run.night.config_generation = night_mode_config_generation(pmodel);
+    if (pmodel->run.night.active != active) {
+        pmodel->run.night.active = active;
+        model_touch(pmodel, MODEL_FIELD_NIGHT_MODE_ACTIVE);
+    }
+}
+
+
+uint8_t model_is_world_clock_stale(model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    return now < pmodel->run.world_clock.from || now >= pmodel->run.world_clock.until ||
+           pmodel->run.world_clock.config_generation != pmodel->run.generations[MODEL_FIELD_WORLD_CLOCK];
+}
+
+
+/*
+ * Parses the zones whose city changed and caches their UTC offset until the next DST transition of any of them,
+ * so the world clock face only adds the offset to the current time
+ */
+void model_update_world_clock(mut_model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    uint64_t until = UINT64_MAX;
+
+    for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+        uint8_t city = pmodel->config.world_clock.cities[i];
+        if (city >= world_clock_get_city_count()) {
+            pmodel->run.world_clock.zones[i].city = WORLD_CLOCK_NO_CITY;
+            continue;
+        }
+
+        civil_time_zone_t *zone = &pmodel->run.world_clock.zones[i].zone;
+        if (pmodel->run.world_clock.zones[i].city != city) {
+            if (civil_time_zone_parse(zone, world_clock_get_city(city)->posix_tz)) {
+                ESP_LOGW(TAG, "Invalid time zone for %s", world_clock_get_city(city)->name);
+                pmodel->run.world_clock.zones[i].city = WORLD_CLOCK_NO_CITY;
+                continue;
+            }
+            pmodel->run.world_clock.zones[i].city = city;
+        }
+
+        // Transitions are computed for one year at a time
+        civil_time_zone_prepare(zone, now);
+        pmodel->run.world_clock.zones[i].offset = civil_time_zone_offset(zone, now, NULL);
+
+        int64_t next = civil_time_zone_next_transition(zone, now);
+        if ((uint64_t)next < until) {
+            until = next;
+        }
     }
+
+    pmodel->run.world_clock.from              = now;
+    pmodel->run.world_clock.until             = until;
+    pmodel->run.world_clock.config_generation = pmodel->run.generations[MODEL_FIELD_WORLD_CLOCK];
+}
+
+
+/*
+ * NULL if the zone is not shown
+ */
+const char *model_get_world_clock_name(model_t *pmodel, size_t zone) {
+    assert(pmodel != NULL && zone < WORLD_CLOCK_ZONES);
+    uint8_t city = pmodel->run.world_clock.zones[zone].city;
+    return city != WORLD_CLOCK_NO_CITY ? world_clock_get_city(city)->name : NULL;
+}
+
+
+int32_t model_get_world_clock_offset(model_t *pmodel, size_t zone) {
+    assert(pmodel != NULL && zone < WORLD_CLOCK_ZONES);
+    return pmodel->run.world_clock.zones[zone].offset;
+}
+
+
+uint8_t model_is_solar_schedule_stale(model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    return now < pmodel->run.solar.from || now >= pmodel->run.solar.until ||
+           pmodel->run.solar.config_generation != pmodel->run.generations[MODEL_FIELD_SOLAR_SCHEDULE];
+}
+
+
+/*
+ * Evaluates the ephemeris for the local day of `now`; the brightness curve is then sampled from the cached events
+ */
+void model_update_solar_schedule(mut_model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    struct tm   now_tm = civil_time_localtime(now);
+    solar_day_t day    = {0};
+    solar_compute_day(&day, now_tm.tm_year + 1900, now_tm.tm_mon + 1, now_tm.tm_mday,
+                      pmodel->config.solar_schedule.latitude / 100., pmodel->config.solar_schedule.longitude / 100.);
+
+    uint64_t until = seconds_of_day_after(&now_tm, 0, 1);
+
+    pmodel->run.solar.from              = seconds_of_day_after(&now_tm, 0, 0);
+    pmodel->run.solar.until             = until > now ? until : now + 1;
+    pmodel->run.solar.config_generation = pmodel->run.generations[MODEL_FIELD_SOLAR_SCHEDULE];
+    pmodel->run.solar.dawn              = day.dawn;
+    pmodel->run.solar.sunrise           = day.sunrise;
+    pmodel->run.solar.sunset            = day.sunset;
+    pmodel->run.solar.dusk              = day.dusk;
+}
+
+
+/*
+ * Earliest instant at which one of the cached ranges (today, night mode, world clock, solar schedule) expires.
+ * Configuration changes happen in the controller loop, which refreshes the caches before sleeping
+ */
+uint64_t model_get_next_refresh(model_t *pmodel) {
+    assert(pmodel != NULL);
+    uint64_t until = pmodel->run.today.end;
+    if (pmodel->run.night.until < until) {
+        until = pmodel->run.night.until;
+    }
+    if (pmodel->run.world_clock.until < until) {
+        until = pmodel->run.world_clock.until;
+    }
+    if (pmodel->run.solar.until < until) {
+        until = pmodel->run.solar.until;
+    }
+    return until;
 }
 
 
 void model_set_latest_release_state(mut_model_t *pmodel, http_request_state_t request_state, uint16_t major,
                                     uint16_t minor, uint16_t patch) {
     assert(pmodel != NULL);
-    pmodel->run.latest_release_request_state = request_state;
-    pmodel->run.latest_release_major         = major;
-    pmodel->run.latest_release_minor         = minor;
-    pmodel->run.latest_release_patch         = patch;
+    if (pmodel->run.latest_release_request_state != request_state || pmodel->run.latest_release_major != major ||
+        pmodel->run.latest_release_minor != minor || pmodel->run.latest_release_patch != patch) {
+        pmodel->run.latest_release_request_state = request_state;
+        pmodel->run.latest_release_major         = major;
+        pmodel->run.latest_release_minor         = minor;
+        pmodel->run.latest_release_patch         = patch;
+        model_touch(pmodel, MODEL_FIELD_LATEST_RELEASE);
+    }
 }
 
 
-void model_set_night_mode(mut_model_t *pmodel, uint8_t night_mode) {
+void model_set_client_firmware_update_state(mut_model_t *pmodel, firmware_update_state_t state) {
     assert(pmodel != NULL);
-    pmodel->config.night_mode = night_mode;
+    if (!model_firmware_update_state_equal(pmodel->run.client_firmware_update_state, state)) {
+        pmodel->run.client_firmware_update_state = state;
+        model_touch(pmodel, MODEL_FIELD_FIRMWARE_UPDATE_STATE);
+    }
+}
+
+
+uint8_t model_firmware_update_state_equal(firmware_update_state_t first, firmware_update_state_t second) {
+    return first.tag == second.tag && first.failure_code == second.failure_code && first.error == second.error;
+}
+
+
+/*
+ * Marks a field as changed. Every function that modifies a tracked field must call this
+ */
+void model_touch(mut_model_t *pmodel, model_field_t field) {
+    assert(pmodel != NULL && field < MODEL_FIELD_NUM);
+    pmodel->run.generations[field] = ++pmodel->run.generation;
+}
+
+
+uint32_t model_get_generation(model_t *pmodel) {
+    assert(pmodel != NULL);
+    return pmodel->run.generation;
+}
+
+
+uint32_t model_get_field_generation(model_t *pmodel, model_field_t field) {
+    assert(pmodel != NULL && field < MODEL_FIELD_NUM);
+    return pmodel->run.generations[field];
+}
+
+
+/*
+ * Returns the mask of the fields changed after `*generation` and brings it up to date.
+ * Costs a single comparison when nothing changed
+ */
+uint32_t model_get_changes(model_t *pmodel, uint32_t *generation) {
+    assert(pmodel != NULL && generation != NULL);
+    uint32_t changes = 0;
+
+    if (*generation == pmodel->run.generation) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < MODEL_FIELD_NUM; i++) {
+        // Wraparound safe
+        if ((int32_t)(pmodel->run.generations[i] - *generation) > 0) {
+            changes |= MODEL_FIELD_MASK(i);
+        }
+    }
+
+    *generation = pmodel->run.generation;
+    return changes;
 }
 
 
@@ -121,82 +421,777 @@ const char *model_get_ssid(model_t *pmodel) {
 
 
 alarm_t model_get_alarm(model_t *pmodel, size_t num) {
-    assert(pmodel != NULL);
+    assert(pmodel != NULL && num < pmodel->config.num_alarms);
     return pmodel->config.alarms[num];
 }
 
 
-uint8_t model_get_nth_alarm(model_t *pmodel, size_t *alarm_num, size_t nth) {
+const char *model_get_alarm_description(model_t *pmodel, size_t num) {
+    assert(pmodel != NULL && num < pmodel->config.num_alarms);
+    return string_arena_get(&pmodel->config.descriptions, pmodel->config.alarms[num].description);
+}
+
+
+/*
+ * Replaces the description of an alarm, truncated to MAX_DESCRIPTION_LEN characters.
+ * Returns -1 (and leaves the description empty) when it does not fit in the RAM budget
+ */
+int model_set_alarm_description(mut_model_t *pmodel, size_t num, const char *description) {
+    assert(pmodel != NULL && num < pmodel->config.num_alarms);
+    alarm_t *alarm = &pmodel->config.alarms[num];
+    size_t   len   = strnlen(description, MAX_DESCRIPTION_LEN);
+
+    // Also keeps `description` from pointing to a string that compaction is about to move
+    const char *current = string_arena_get(&pmodel->config.descriptions, alarm->description);
+    if (strlen(current) == len && strncmp(current, description, len) == 0) {
+        return 0;
+    }
+
+    string_arena_release(&pmodel->config.descriptions, alarm->description);
+    alarm->description = STRING_ARENA_NONE;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    size_t limit = APP_CONFIG_ALARM_STORE_BUDGET - pmodel->config.alarms_capacity * ALARM_SLOT_SIZE;
+    alarm->description =
+        string_arena_add(&pmodel->config.descriptions, num, description, len, limit, relocate_description, pmodel);
+    return alarm->description == STRING_ARENA_NONE ? -1 : 0;
+}
+
+
+/*
+ * Makes room for at least `count` alarms, doubling the table as long as it stays within the RAM budget.
+ * Returns -1 if the budget (or the heap) does not allow it
+ */
+int model_reserve_alarms(mut_model_t *pmodel, size_t count) {
     assert(pmodel != NULL);
-    size_t count = 0;
 
-    for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
-        if (model_is_alarm_expired(pmodel, i)) {
-            continue;
+    if (count <= pmodel->config.alarms_capacity) {
+        return 0;
+    }
+
+    size_t capacity = pmodel->config.alarms_capacity > 0 ? pmodel->config.alarms_capacity : MIN_ALARMS_CAPACITY;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    size_t max_capacity = (APP_CONFIG_ALARM_STORE_BUDGET - pmodel->config.descriptions.capacity) / ALARM_SLOT_SIZE;
+    if (max_capacity > MAX_ALARMS_CAPACITY) {
+        max_capacity = MAX_ALARMS_CAPACITY;
+    }
+    if (capacity > max_capacity) {
+        capacity = max_capacity;
+    }
+    if (capacity < count) {
+        return -1;
+    }
+
+    // The capacity is updated only when all arrays have grown; a larger array is harmless in the meantime
+    if (grow_array((void **)&pmodel->config.alarms, capacity, sizeof(*pmodel->config.alarms)) ||
+        grow_array((void **)&pmodel->run.alarm_index, capacity, sizeof(*pmodel->run.alarm_index)) ||
+        grow_array((void **)&pmodel->run.occurrences, capacity, sizeof(*pmodel->run.occurrences)) ||
+        grow_array((void **)&pmodel->run.recurring, capacity, sizeof(*pmodel->run.recurring)) ||
+        grow_array((void **)&pmodel->run.max_ends, capacity, sizeof(*pmodel->run.max_ends))) {
+        ESP_LOGW(TAG, "Out of memory growing the alarm table to %zu", capacity);
+        return -1;
+    }
+
+    pmodel->config.alarms_capacity = capacity;
+    return 0;
+}
+
+
+/*
+ * No alarm slot is expired and the table cannot grow any further
+ */
+uint8_t model_is_alarm_store_full(model_t *pmodel) {
+    assert(pmodel != NULL);
+    size_t free_slot = 0;
+    if (model_get_free_alarm_slot(pmodel, &free_slot) || pmodel->config.num_alarms < pmodel->config.alarms_capacity) {
+        return 0;
+    } else {
+        return pmodel->config.alarms_capacity >= MAX_ALARMS_CAPACITY ||
+               model_get_alarm_store_usage(pmodel) + ALARM_SLOT_SIZE > APP_CONFIG_ALARM_STORE_BUDGET;
+    }
+}
+
+
+size_t model_get_alarm_store_usage(model_t *pmodel) {
+    assert(pmodel != NULL);
+    return pmodel->config.alarms_capacity * ALARM_SLOT_SIZE + pmodel->config.descriptions.capacity;
+}
+
+
+void model_log_alarm_store_usage(model_t *pmodel) {
+    assert(pmodel != NULL);
+    size_t used  = pmodel->config.num_alarms * ALARM_SLOT_SIZE + pmodel->config.descriptions.size -
+                  pmodel->config.descriptions.garbage;
+    size_t total = model_get_alarm_store_usage(pmodel);
+
+    ESP_LOGI(TAG, "Alarm store: %i alarms (%i slots), %zu bytes in use, %zu allocated out of a %i bytes budget",
+             pmodel->config.num_alarms, pmodel->config.alarms_capacity, used, total, APP_CONFIG_ALARM_STORE_BUDGET);
+    ESP_LOGI(TAG, "Alarm store: %zu bytes per alarm plus its description; the fixed table took %zu bytes for %i alarms",
+             (size_t)ALARM_SLOT_SIZE, (size_t)LEGACY_STORE_SIZE, LEGACY_ALARMS);
+}
+
+
+/*
+ * Collects, in order of start, up to `max` alarms that take place on the day: the ones starting on it and the events
+ * still in progress from the days before, like model_is_alarm_expired counts them.
+ * A recurring alarm can be listed twice, when an occurrence lasts into the day and another one starts on it, so
+ * `num_alarms + num_recurring` entries always suffice.
+ * The index is scanned once from the earliest event that could still be running, and merged with the occurrences of
+ * the recurring rules on the day, computed once each
+ */
+size_t model_get_day_alarms(model_t *pmodel, uint16_t day, uint16_t month, uint16_t year, size_t *alarms,
+                            size_t max) {
+    assert(pmodel != NULL && (alarms != NULL || max == 0));
+
+    struct tm day_tm = {
+        .tm_mday  = day,
+        .tm_mon   = month,
+        .tm_year  = year,
+        .tm_isdst = -1,
+    };
+    time_t day_start = civil_time_mktime(&day_tm);
+    struct tm end_tm = day_tm;
+    end_tm.tm_mday++;
+    end_tm.tm_isdst = -1;
+    time_t day_end   = civil_time_mktime(&end_tm);
+
+    // Alarms of past days are expired anyway
+    time_t from = today_start(pmodel, clock_now());
+    if (day_start > from) {
+        from = day_start;
+    }
+    if (from >= day_end) {
+        return 0;
+    }
+
+    day_rule_t rules[DAY_RULES_BATCH];
+    size_t     num_rules = collect_day_rules(pmodel, &day_tm, from, NULL, rules);
+    size_t     next_rule = 0;
+    size_t     position  = max_ends_lower_bound(pmodel, from);
+    size_t     count     = 0;
+
+    while (count < max) {
+        // A full batch may leave later occurrences behind
+        if (next_rule == num_rules && num_rules == DAY_RULES_BATCH) {
+            day_rule_t after = rules[num_rules - 1];
+            num_rules        = collect_day_rules(pmodel, &day_tm, from, &after, rules);
+            next_rule        = 0;
         }
 
-        if (count == nth) {
-            *alarm_num = i;
-            return 1;
+        // Skips what ended before the day among the alarms that started before it
+        while (position < pmodel->config.num_alarms &&
+               model_get_alarm_end(pmodel, pmodel->run.alarm_index[position]) < (uint64_t)from) {
+            position++;
+        }
+
+        uint8_t indexed = position < pmodel->config.num_alarms &&
+                          pmodel->run.occurrences[pmodel->run.alarm_index[position]] < (uint64_t)day_end;
+
+        if (indexed && (next_rule == num_rules ||
+                        pmodel->run.occurrences[pmodel->run.alarm_index[position]] <= rules[next_rule].occurrence)) {
+            alarms[count++] = pmodel->run.alarm_index[position++];
+        } else if (next_rule < num_rules) {
+            alarms[count++] = rules[next_rule++].num;
         } else {
-            count++;
+            break;
         }
     }
 
-    return 0;
+    return count;
 }
 
 
-uint8_t model_get_nth_alarm_for_day(model_t *pmodel, size_t *alarm_num, size_t nth, uint16_t day, uint16_t month,
-                                    uint16_t year) {
+/*
+ * Returns a mask with bit `day - 1` set for every day of the month that has an alarm, past days excluded.
+ * The index is searched once per day, and recurring rules are matched against the days without computing occurrences.
+ */
+uint32_t model_get_month_alarm_days(model_t *pmodel, uint16_t month, uint16_t year) {
     assert(pmodel != NULL);
-    size_t count = 0;
 
+    struct tm first_tm = {
+        .tm_mday  = 1,
+        .tm_mon   = month,
+        .tm_year  = year,
+        .tm_isdst = -1,
+    };
+    time_t  month_start = civil_time_mktime(&first_tm);
+    time_t  from        = today_start(pmodel, clock_now());
+    uint8_t days        = civil_time_days_in_month(first_tm.tm_year + 1900, first_tm.tm_mon + 1);
+    uint8_t first_day   = 1;
+
+    if (month_start < from) {
+        struct tm from_tm = civil_time_localtime(from);
+        if (from_tm.tm_year != first_tm.tm_year || from_tm.tm_mon != first_tm.tm_mon) {
+            return 0;
+        }
+        first_day = from_tm.tm_mday;
+    } else {
+        from = month_start;
+    }
+
+    uint32_t mask     = 0;
+    size_t   position = model_alarm_index_lower_bound(pmodel, from);
+    for (uint8_t day = first_day; day <= days && position < pmodel->config.num_alarms; day++) {
+        struct tm end_tm = first_tm;
+        end_tm.tm_mday   = day + 1;
+        end_tm.tm_isdst  = -1;
+        time_t day_end   = civil_time_mktime(&end_tm);
+
+        if (pmodel->run.occurrences[pmodel->run.alarm_index[position]] < (uint64_t)day_end) {
+            mask |= 1UL << (day - 1);
+            position = model_alarm_index_lower_bound(pmodel, day_end);
+        }
+    }
+
+    for (size_t i = 0; i < pmodel->run.num_recurring; i++) {
+        const alarm_t *alarm    = &pmodel->config.alarms[pmodel->run.recurring[i]];
+        struct tm      alarm_tm = civil_time_localtime(alarm->timestamp);
+
+        // No field overflows within the month, so the days are enumerated without normalizing
+        struct tm day_tm = first_tm;
+        day_tm.tm_mday   = first_day;
+        day_tm.tm_wday   = (first_tm.tm_wday + first_day - 1) % 7;
+        day_tm.tm_yday   = first_tm.tm_yday + first_day - 1;
+        for (; day_tm.tm_mday <= days; day_tm.tm_mday++, day_tm.tm_wday = (day_tm.tm_wday + 1) % 7, day_tm.tm_yday++) {
+            if (rule_matches(alarm, &alarm_tm, &day_tm)) {
+                mask |= 1UL << (day_tm.tm_mday - 1);
+            }
+        }
+    }
+
+    return mask;
+}
+
+
+/*
+ * Expired (and deleted) alarms sort first in the index, so they double as the list of free slots, oldest first.
+ * The prefix stops at the first event still in progress today, even if some expired ones follow it
+ */
+size_t model_get_expired_alarms(model_t *pmodel) {
+    assert(pmodel != NULL);
+    return max_ends_lower_bound(pmodel, today_start(pmodel, clock_now()));
+}
+
+
+uint8_t model_get_free_alarm_slot(model_t *pmodel, size_t *alarm_num) {
+    assert(pmodel != NULL && alarm_num != NULL);
+    if (pmodel->config.num_alarms > 0 && pmodel->run.max_ends[0] < (uint64_t)today_start(pmodel, clock_now())) {
+        *alarm_num = pmodel->run.alarm_index[0];
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+uint8_t model_is_alarm_expired(model_t *pmodel, size_t alarm_num) {
+    assert(pmodel != NULL);
+
+    if (alarm_num >= pmodel->config.num_alarms) {
+        return 1;
+    } else {
+        // An alarm stays active for the whole day it is set in (or ends in). This is the definition every query
+        // follows: the expired prefix through max_ends, the alarms of a day and the events in progress
+        return model_get_alarm_end(pmodel, alarm_num) < (uint64_t)today_start(pmodel, clock_now());
+    }
+}
+
+
+/*
+ * Returns the position of the first alarm in the index whose (next) occurrence is not before `timestamp`
+ */
+size_t model_alarm_index_lower_bound(model_t *pmodel, uint64_t timestamp) {
+    assert(pmodel != NULL);
+    size_t low  = 0;
+    size_t high = pmodel->config.num_alarms;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (pmodel->run.occurrences[pmodel->run.alarm_index[middle]] < timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+void model_rebuild_alarm_index(mut_model_t *pmodel) {
+    assert(pmodel != NULL);
+    time_t now = clock_now();
+
+    if (model_is_today_stale(pmodel, now)) {
+        update_today_bounds(pmodel, now);
+    }
+
+    pmodel->run.num_recurring = 0;
     for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
-        if (model_is_alarm_expired(pmodel, i)) {
-            continue;
+        pmodel->run.alarm_index[i] = i;
+        if (pmodel->config.alarms[i].recurrence != ALARM_RECURRENCE_NONE) {
+            pmodel->run.recurring[pmodel->run.num_recurring++] = i;
         }
+        model_update_alarm_occurrence(pmodel, i);
+    }
+
+    sort_alarm_index(pmodel);
+    model_rebuild_today_alarms(pmodel, now);
+}
+
 
-        time_t    alarm_time = pmodel->config.alarms[i].timestamp;
-        struct tm alarm_tm   = *localtime(&alarm_time);
-        if (alarm_tm.tm_mday == day && alarm_tm.tm_mon == month && alarm_tm.tm_year == year) {
-            if (count == nth) {
-                *alarm_num = i;
-                return 1;
-            } else {
-                count++;
+void model_rebuild_today_alarms(mut_model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+
+    if (model_is_today_stale(pmodel, now)) {
+        update_today_bounds(pmodel, now);
+
+        // Recurring alarms that happened before today move on to their next occurrence
+        uint8_t moved = 0;
+        for (size_t i = 0; i < pmodel->run.num_recurring; i++) {
+            uint16_t num = pmodel->run.recurring[i];
+            if (pmodel->run.occurrences[num] < pmodel->run.today.start) {
+                model_update_alarm_occurrence(pmodel, num);
+                moved = 1;
             }
         }
+        if (moved) {
+            sort_alarm_index(pmodel);
+        }
     }
 
-    return 0;
+    update_max_ends(pmodel);
+    pmodel->run.today.first = model_alarm_index_lower_bound(pmodel, pmodel->run.today.start);
+    pmodel->run.today.count = model_alarm_index_lower_bound(pmodel, pmodel->run.today.end) - pmodel->run.today.first;
+}
+
+
+/*
+ * Moves an alarm whose time or duration changed to its place in the index. Ties are ordered by alarm number, so its
+ * current position is found with a binary search; only the entries between the old and the new position move, and
+ * the running maximum of the ends is recomputed from there until it matches the previous one again.
+ * Not for alarms written by an open batch, which leaves the index out of order until its commit
+ */
+void model_reposition_alarm(mut_model_t *pmodel, size_t alarm_num) {
+    assert(pmodel != NULL && alarm_num < pmodel->config.num_alarms);
+    uint16_t *index = pmodel->run.alarm_index;
+    size_t    count = pmodel->config.num_alarms;
+
+    // Brings the rest of the index to the current day first
+    time_t now = clock_now();
+    if (model_is_today_stale(pmodel, now)) {
+        model_rebuild_today_alarms(pmodel, now);
+    }
+
+    size_t from = index_upper_bound(pmodel, 0, count, alarm_num);
+    assert(from < count && index[from] == alarm_num);
+    model_update_alarm_occurrence(pmodel, alarm_num);
+
+    size_t to = from;
+    if (from > 0 && index_precedes(pmodel, alarm_num, index[from - 1])) {
+        to = index_upper_bound(pmodel, 0, from, alarm_num);
+        memmove(&index[to + 1], &index[to], (from - to) * sizeof(*index));
+    } else if (from + 1 < count && index_precedes(pmodel, index[from + 1], alarm_num)) {
+        to = index_upper_bound(pmodel, from + 1, count, alarm_num) - 1;
+        memmove(&index[from], &index[from + 1], (to - from) * sizeof(*index));
+    }
+    index[to] = alarm_num;
+
+    size_t   first   = from < to ? from : to;
+    size_t   last    = from < to ? to : from;
+    uint32_t max_end = first > 0 ? pmodel->run.max_ends[first - 1] : 0;
+    for (size_t i = first; i < count; i++) {
+        uint32_t end = clamped_end(pmodel, index[i]);
+        if (end > max_end) {
+            max_end = end;
+        }
+        // Past the moved range the same alarms precede every position, only the end of this one may have changed
+        if (i > last && pmodel->run.max_ends[i] == max_end) {
+            break;
+        }
+        pmodel->run.max_ends[i] = max_end;
+    }
+
+    pmodel->run.today.first = model_alarm_index_lower_bound(pmodel, pmodel->run.today.start);
+    pmodel->run.today.count = model_alarm_index_lower_bound(pmodel, pmodel->run.today.end) - pmodel->run.today.first;
 }
 
 
-size_t model_get_active_alarms(model_t *pmodel) {
+/*
+ * Caches the time the alarm is due: the timestamp itself for single alarms, the first occurrence not before today
+ * for recurring ones.
+ */
+void model_update_alarm_occurrence(mut_model_t *pmodel, size_t alarm_num) {
     assert(pmodel != NULL);
+    const alarm_t *alarm = &pmodel->config.alarms[alarm_num];
+
+    if (alarm->recurrence == ALARM_RECURRENCE_NONE || alarm->timestamp >= pmodel->run.today.start) {
+        pmodel->run.occurrences[alarm_num] = alarm->timestamp;
+        return;
+    }
+
+    struct tm day_tm = civil_time_localtime(pmodel->run.today.start);
+
+    // Monthly alarms on the 31st may skip a couple of months
+    for (size_t i = 0; i < 62; i++) {
+        struct tm occurs_tm = day_tm;
+        occurs_tm.tm_mday += i;
+        occurs_tm.tm_isdst = -1;
+        civil_time_mktime(&occurs_tm);
+
+        if (model_alarm_occurs_on(alarm, &occurs_tm)) {
+            pmodel->run.occurrences[alarm_num] = occurrence_on(alarm, &occurs_tm);
+            return;
+        }
+    }
+
+    pmodel->run.occurrences[alarm_num] = alarm->timestamp;
+}
+
+
+/*
+ * Whether the rule of a recurring alarm matches the (normalized) date in `day_tm`
+ */
+uint8_t model_alarm_occurs_on(const alarm_t *alarm, const struct tm *day_tm) {
+    assert(alarm != NULL && day_tm != NULL);
+    struct tm alarm_tm = civil_time_localtime(alarm->timestamp);
+    return rule_matches(alarm, &alarm_tm, day_tm);
+}
+
+
+uint8_t model_is_today_stale(model_t *pmodel, uint64_t now) {
+    assert(pmodel != NULL);
+    return now < pmodel->run.today.start || now >= pmodel->run.today.end;
+}
+
+
+size_t model_get_today_alarms_count(model_t *pmodel) {
+    assert(pmodel != NULL);
+    return pmodel->run.today.count;
+}
+
+
+uint8_t model_get_nth_today_alarm(model_t *pmodel, size_t *alarm_num, size_t nth) {
+    assert(pmodel != NULL);
+    if (nth < pmodel->run.today.count) {
+        *alarm_num = pmodel->run.alarm_index[pmodel->run.today.first + nth];
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+/*
+ * The first alarm due strictly after `timestamp`
+ */
+uint8_t model_get_next_alarm_after(model_t *pmodel, uint64_t timestamp, size_t *alarm_num, uint64_t *occurrence) {
+    assert(pmodel != NULL);
+    size_t position = model_alarm_index_lower_bound(pmodel, timestamp + 1);
+
+    if (position < pmodel->config.num_alarms) {
+        *alarm_num  = pmodel->run.alarm_index[position];
+        *occurrence = pmodel->run.occurrences[*alarm_num];
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+/*
+ * Moves from `*alarm_num`, due at `*occurrence`, to the alarm after it in the index: due later, or in the same second
+ * with a higher number. SIZE_MAX as the number stands past every alarm due in that second
+ */
+uint8_t model_get_following_alarm(model_t *pmodel, size_t *alarm_num, uint64_t *occurrence) {
+    assert(pmodel != NULL && alarm_num != NULL && occurrence != NULL);
+    size_t position = model_alarm_index_lower_bound(pmodel, *occurrence);
+
+    while (position < pmodel->config.num_alarms &&
+           pmodel->run.occurrences[pmodel->run.alarm_index[position]] == *occurrence &&
+           pmodel->run.alarm_index[position] <= *alarm_num) {
+        position++;
+    }
+
+    if (position < pmodel->config.num_alarms) {
+        *alarm_num  = pmodel->run.alarm_index[position];
+        *occurrence = pmodel->run.occurrences[*alarm_num];
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+uint64_t model_get_alarm_end(model_t *pmodel, size_t alarm_num) {
+    assert(pmodel != NULL && alarm_num < pmodel->config.num_alarms);
+    return (uint64_t)pmodel->run.occurrences[alarm_num] + pmodel->config.alarms[alarm_num].duration * 60UL;
+}
+
+
+/*
+ * Collects, in order of start, up to `max` events that started by `timestamp` and did not end yet.
+ * Only the index range between the earliest event that could still be running and `timestamp` is visited
+ */
+size_t model_get_alarms_in_progress(model_t *pmodel, uint64_t timestamp, size_t *alarms, size_t max) {
+    assert(pmodel != NULL && (alarms != NULL || max == 0));
+    size_t last  = model_alarm_index_lower_bound(pmodel, timestamp + 1);
     size_t count = 0;
+
+    for (size_t i = max_ends_lower_bound(pmodel, timestamp + 1); i < last && count < max; i++) {
+        uint16_t num = pmodel->run.alarm_index[i];
+        if (model_get_alarm_end(pmodel, num) > timestamp) {
+            alarms[count++] = num;
+        }
+    }
+
+    return count;
+}
+
+
+uint64_t model_get_today_start(model_t *pmodel) {
+    assert(pmodel != NULL);
+    return today_start(pmodel, clock_now());
+}
+
+
+uint64_t model_get_today_end(model_t *pmodel) {
+    assert(pmodel != NULL);
+    return pmodel->run.today.end;
+}
+
+
+static void update_today_bounds(mut_model_t *pmodel, time_t now) {
+    struct tm start_tm = civil_time_localtime(now);
+    start_tm.tm_hour   = 0;
+    start_tm.tm_min    = 0;
+    start_tm.tm_sec    = 0;
+    start_tm.tm_isdst  = -1;
+
+    pmodel->run.today.start = civil_time_mktime(&start_tm);
+    start_tm.tm_mday++;
+    start_tm.tm_isdst     = -1;
+    pmodel->run.today.end = civil_time_mktime(&start_tm);
+}
+
+
+static void sort_alarm_index(mut_model_t *pmodel) {
+    uint16_t *index = pmodel->run.alarm_index;
+
+    // The index is usually almost sorted already
+    for (size_t i = 1; i < pmodel->config.num_alarms; i++) {
+        uint16_t alarm_num = index[i];
+        size_t   j         = i;
+        while (j > 0 && index_precedes(pmodel, alarm_num, index[j - 1])) {
+            index[j] = index[j - 1];
+            j--;
+        }
+        index[j] = alarm_num;
+    }
+}
+
+
+/*
+ * Order of the index: by occurrence, then by alarm number
+ */
+static uint8_t index_precedes(model_t *pmodel, uint16_t first, uint16_t second) {
+    uint32_t first_occurrence  = pmodel->run.occurrences[first];
+    uint32_t second_occurrence = pmodel->run.occurrences[second];
+    return first_occurrence < second_occurrence || (first_occurrence == second_occurrence && first < second);
+}
+
+
+/*
+ * Returns the first position in [low, high) whose alarm does not precede `alarm_num`
+ */
+static size_t index_upper_bound(model_t *pmodel, size_t low, size_t high, uint16_t alarm_num) {
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (index_precedes(pmodel, pmodel->run.alarm_index[middle], alarm_num)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+static void update_max_ends(mut_model_t *pmodel) {
+    uint32_t max_end = 0;
     for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
-        if (!model_is_alarm_expired(pmodel, i)) {
-            count++;
+        uint32_t end = clamped_end(pmodel, pmodel->run.alarm_index[i]);
+        if (end > max_end) {
+            max_end = end;
+        }
+        pmodel->run.max_ends[i] = max_end;
+    }
+}
+
+
+static uint32_t clamped_end(model_t *pmodel, uint16_t alarm_num) {
+    uint64_t end = model_get_alarm_end(pmodel, alarm_num);
+    return end > UINT32_MAX ? UINT32_MAX : (uint32_t)end;
+}
+
+
+/*
+ * Returns the first position of the index where some alarm up to it ends at `timestamp` or later
+ */
+static size_t max_ends_lower_bound(model_t *pmodel, uint64_t timestamp) {
+    size_t low  = 0;
+    size_t high = pmodel->config.num_alarms;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (pmodel->run.max_ends[middle] < timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
     }
+
+    return low;
+}
+
+
+static time_t today_start(model_t *pmodel, time_t now) {
+    if (!model_is_today_stale(pmodel, now)) {
+        return pmodel->run.today.start;
+    }
+
+    struct tm now_tm = civil_time_localtime(now);
+    now_tm.tm_hour   = 0;
+    now_tm.tm_min    = 0;
+    now_tm.tm_sec    = 0;
+    now_tm.tm_isdst  = -1;
+    return civil_time_mktime(&now_tm);
+}
+
+
+/*
+ * When the alarm rings on the (normalized) date of `day_tm`
+ */
+static uint64_t occurrence_on(const alarm_t *alarm, const struct tm *day_tm) {
+    struct tm alarm_tm  = civil_time_localtime(alarm->timestamp);
+    struct tm occurs_tm = *day_tm;
+    occurs_tm.tm_hour   = alarm_tm.tm_hour;
+    occurs_tm.tm_min    = alarm_tm.tm_min;
+    occurs_tm.tm_sec    = alarm_tm.tm_sec;
+    occurs_tm.tm_isdst  = -1;
+    return civil_time_mktime(&occurs_tm);
+}
+
+
+static uint8_t rule_matches(const alarm_t *alarm, const struct tm *alarm_tm, const struct tm *day_tm) {
+    if (day_tm->tm_year < alarm_tm->tm_year ||
+        (day_tm->tm_year == alarm_tm->tm_year && day_tm->tm_yday < alarm_tm->tm_yday)) {
+        return 0;
+    }
+
+    switch (alarm->recurrence) {
+        case ALARM_RECURRENCE_DAILY:
+            return 1;
+        case ALARM_RECURRENCE_WEEKDAYS:
+            return day_tm->tm_wday >= 1 && day_tm->tm_wday <= 5;
+        case ALARM_RECURRENCE_WEEKLY:
+            return (alarm->weekdays & (1 << day_tm->tm_wday)) > 0;
+        case ALARM_RECURRENCE_MONTHLY:
+            return day_tm->tm_mday == alarm_tm->tm_mday;
+        default:
+            return day_tm->tm_year == alarm_tm->tm_year && day_tm->tm_yday == alarm_tm->tm_yday;
+    }
+}
+
+
+/*
+ * The earliest DAY_RULES_BATCH occurrences on the day of recurring alarms whose indexed occurrence comes before it,
+ * sorted by time and number and strictly after `after` if given.
+ * Recurring rules are a handful at most, so the batch is usually filled once
+ */
+static size_t collect_day_rules(model_t *pmodel, const struct tm *day_tm, time_t from, const day_rule_t *after,
+                                day_rule_t *rules) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < pmodel->run.num_recurring; i++) {
+        uint16_t       num   = pmodel->run.recurring[i];
+        const alarm_t *alarm = &pmodel->config.alarms[num];
+        if (pmodel->run.occurrences[num] >= (uint64_t)from || !model_alarm_occurs_on(alarm, day_tm)) {
+            continue;
+        }
+
+        day_rule_t rule = {.occurrence = occurrence_on(alarm, day_tm), .num = num};
+        if ((after != NULL && !day_rule_precedes(after, &rule)) ||
+            (count == DAY_RULES_BATCH && !day_rule_precedes(&rule, &rules[count - 1]))) {
+            continue;
+        }
+
+        // Insertion in the sorted batch, dropping the latest one when full
+        size_t position = count < DAY_RULES_BATCH ? count++ : count - 1;
+        while (position > 0 && day_rule_precedes(&rule, &rules[position - 1])) {
+            rules[position] = rules[position - 1];
+            position--;
+        }
+        rules[position] = rule;
+    }
+
     return count;
 }
 
 
-uint8_t model_is_alarm_expired(model_t *pmodel, size_t alarm_num) {
-    time_t    now    = time(NULL);
-    struct tm now_tm = *localtime(&now);
+static uint8_t day_rule_precedes(const day_rule_t *first, const day_rule_t *second) {
+    return first->occurrence < second->occurrence ||
+           (first->occurrence == second->occurrence && first->num < second->num);
+}
 
-    if (alarm_num >= pmodel->config.num_alarms) {
-        return 1;
-    } else {
-        time_t    alarm_time = pmodel->config.alarms[alarm_num].timestamp;
-        struct tm alarm_tm   = *localtime(&alarm_time);
 
-        uint8_t same_day = (alarm_tm.tm_yday == now_tm.tm_yday && alarm_tm.tm_year == now_tm.tm_year);
-        uint8_t passed   = alarm_time < now;
-        return !same_day && passed;
+static int grow_array(void **array, size_t capacity, size_t item_size) {
+    void *grown = realloc(*array, capacity * item_size);
+    if (grown == NULL) {
+        return -1;
+    } else {
+        *array = grown;
+        return 0;
     }
 }
+
+
+static void relocate_description(void *arg, uint16_t owner, uint16_t offset) {
+    mut_model_t *pmodel                       = arg;
+    pmodel->config.alarms[owner].description = offset;
+}
+
+
+static uint32_t night_mode_config_generation(model_t *pmodel) {
+    // Generations only grow, so the sum changes whenever one of them does
+    return pmodel->run.generations[MODEL_FIELD_NIGHT_MODE_START] + pmodel->run.generations[MODEL_FIELD_NIGHT_MODE_END];
+}
+
+
+/*
+ * `level` scaled by how far `elapsed` is into `length`
+ */
+static uint8_t ramp(uint8_t level, int64_t elapsed, int64_t length) {
+    return length > 0 ? (uint8_t)((level * elapsed) / length) : level;
+}
+
+
+/*
+ * Epoch of `seconds` after the local midnight `days` days after `day_tm`
+ */
+static uint64_t seconds_of_day_after(const struct tm *day_tm, uint32_t seconds, int days) {
+    struct tm at_tm = *day_tm;
+    at_tm.tm_mday += days;
+    at_tm.tm_hour  = seconds / 3600;
+    at_tm.tm_min   = (seconds % 3600) / 60;
+    at_tm.tm_sec   = seconds % 60;
+    at_tm.tm_isdst = -1;
+    return civil_time_mktime(&at_tm);
+}
@@ -4,6 +4,9 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
+#include "string_arena.h"
+#include "civil_time.h"
 
 
 #define GETTER(name, field)                                                                                            \
@@ -16,8 +19,9 @@
 
 #define MAX_SSID_SIZE         33
 #define MAX_AP_SCAN_LIST_SIZE 16
-#define MAX_ALARMS            64
 #define MAX_DESCRIPTION_LEN   64
+#define WORLD_CLOCK_ZONES     4
+#define WORLD_CLOCK_NO_CITY   0xFF
 
 
 typedef enum {
@@ -60,23 +64,91 @@ typedef struct {
     uint32_t                       error;
 } firmware_update_state_t;
 
+typedef enum {
+    ALARM_RECURRENCE_NONE = 0,
+    ALARM_RECURRENCE_DAILY,
+    ALARM_RECURRENCE_WEEKDAYS,
+    ALARM_RECURRENCE_WEEKLY,
+    ALARM_RECURRENCE_MONTHLY,
+#define ALARM_RECURRENCE_NUM 5
+} alarm_recurrence_t;
+
+
+// Parts of the model tracked by generation counters, see model_get_changes
+typedef enum {
+    MODEL_FIELD_MILITARY_TIME = 0,
+    MODEL_FIELD_NORMAL_BRIGHTNESS,
+    MODEL_FIELD_STANDBY_BRIGHTNESS,
+    MODEL_FIELD_STANDBY_DELAY,
+    MODEL_FIELD_NIGHT_MODE,
+    MODEL_FIELD_NIGHT_MODE_START,
+    MODEL_FIELD_NIGHT_MODE_END,
+    MODEL_FIELD_NUM_ALARMS,
+    MODEL_FIELD_ALARMS,
+    MODEL_FIELD_WIFI_STATE,
+    MODEL_FIELD_SCANNING,
+    MODEL_FIELD_AP_LIST,
+    MODEL_FIELD_LATEST_RELEASE,
+    MODEL_FIELD_FIRMWARE_UPDATE_STATE,
+    MODEL_FIELD_NIGHT_MODE_ACTIVE,
+    MODEL_FIELD_WORLD_CLOCK,
+    MODEL_FIELD_SOLAR_SCHEDULE,
+#define MODEL_FIELD_NUM 17
+} model_field_t;
+
+#define MODEL_FIELD_MASK(field) (1UL << (field))
+
+
 typedef struct {
-    uint64_t timestamp;
-    char     description[MAX_DESCRIPTION_LEN + 1];
+    uint32_t timestamp;       // For recurring alarms, the first occurrence
+    uint16_t description;     // Offset in the description arena
+    uint8_t  recurrence;
+    uint8_t  weekdays;        // Bitmask of the days of a weekly alarm, starting from Sunday
+    uint16_t duration;        // Minutes the event lasts, 0 for a plain alarm
 } alarm_t;
 
 
+// Persisted as a whole
+typedef struct {
+    uint8_t enabled;
+    uint8_t cities[WORLD_CLOCK_ZONES];     // Positions in the world_clock city table, or WORLD_CLOCK_NO_CITY
+} world_clock_config_t;
+
+
+// Persisted as a whole
+typedef struct {
+    uint8_t enabled;
+    int16_t latitude;      // Hundredths of a degree, north positive
+    int16_t longitude;     // Hundredths of a degree, east positive
+} solar_schedule_config_t;
+
+
+// Self contained copy of an alarm, used to import them in bulk
+typedef struct {
+    uint64_t    timestamp;
+    uint8_t     recurrence;
+    uint8_t     weekdays;
+    uint16_t    duration;
+    const char *description;
+} alarm_record_t;
+
+
 struct model {
     struct {
-        uint16_t num_alarms;
-        alarm_t  alarms[MAX_ALARMS];
-        uint8_t  military_time;
-        uint8_t  normal_brightness;
-        uint8_t  standby_brightness;
-        uint16_t standby_delay_seconds;
-        uint8_t  night_mode;
-        uint32_t night_mode_start;
-        uint32_t night_mode_end;
+        uint16_t       num_alarms;
+        uint16_t       alarms_capacity;
+        alarm_t       *alarms;
+        string_arena_t descriptions;
+        uint8_t        military_time;
+        uint8_t        normal_brightness;
+        uint8_t        standby_brightness;
+        uint16_t       standby_delay_seconds;
+        uint8_t        night_mode;
+        uint32_t       night_mode_start;
+        uint32_t       night_mode_end;
+
+        world_clock_config_t    world_clock;
+        solar_schedule_config_t solar_schedule;
     } config;
 
     struct {
@@ -92,6 +164,61 @@ struct model {
         firmware_update_state_t server_firmware_update_state;
         firmware_update_state_t client_firmware_update_state;
 
+        // Alarm slots sorted by their (next) occurrence and then by number, kept in sync by the updater.
+        // Allocated along with the alarm table, `alarms_capacity` items each
+        uint16_t *alarm_index;
+        uint32_t *occurrences;
+        uint16_t *recurring;
+        uint16_t  num_recurring;
+        // Latest end among the alarms up to each position of the index. It never decreases, so the alarms still in
+        // progress at any time are found with a binary search
+        uint32_t *max_ends;
+
+        // Range of the index falling in the current day, rebuilt on alarm changes or when the date rolls over
+        struct {
+            uint64_t start;
+            uint64_t end;
+            uint16_t first;
+            uint16_t count;
+        } today;
+
+        // Whether the night mode window is in effect, valid from `night.from` until `night.until` (the next
+        // transition) and as long as the configuration does not change
+        struct {
+            uint8_t  active;
+            uint64_t from;
+            uint64_t until;
+            uint32_t config_generation;
+        } night;
+
+        // UTC offsets of the world clock zones, valid from `from` until the first DST transition among them
+        struct {
+            uint64_t from;
+            uint64_t until;
+            uint32_t config_generation;
+            struct {
+                uint8_t           city;
+                int32_t           offset;
+                civil_time_zone_t zone;
+            } zones[WORLD_CLOCK_ZONES];
+        } world_clock;
+
+        // Solar events of the current local day, valid from its midnight until the next one and as long as the
+        // location does not change. The standby brightness ramps between them
+        struct {
+            uint64_t from;
+            uint64_t until;
+            uint32_t config_generation;
+            int64_t  dawn;
+            int64_t  sunrise;
+            int64_t  sunset;
+            int64_t  dusk;
+        } solar;
+
+        // Every change bumps `generation` and stores it in the counter of the field that changed
+        uint32_t generation;
+        uint32_t generations[MODEL_FIELD_NUM];
+
         uint8_t              new_release_notified;
         http_request_state_t latest_release_request_state;
         uint16_t             latest_release_major;
@@ -108,15 +235,51 @@ typedef struct model       mut_model_t;
 void        model_init(mut_model_t *pmodel);
 const char *model_get_ssid(model_t *pmodel);
 alarm_t     model_get_alarm(model_t *pmodel, size_t num);
-size_t      model_get_active_alarms(model_t *pmodel);
+const char *model_get_alarm_description(model_t *pmodel, size_t num);
+int         model_set_alarm_description(mut_model_t *pmodel, size_t num, const char *description);
+int         model_reserve_alarms(mut_model_t *pmodel, size_t count);
+uint8_t     model_is_alarm_store_full(model_t *pmodel);
+size_t      model_get_alarm_store_usage(model_t *pmodel);
+void        model_log_alarm_store_usage(model_t *pmodel);
+size_t      model_get_expired_alarms(model_t *pmodel);
+uint8_t     model_get_free_alarm_slot(model_t *pmodel, size_t *alarm_num);
 uint8_t     model_is_alarm_expired(model_t *pmodel, size_t alarm_num);
-uint8_t     model_get_nth_alarm_for_day(model_t *pmodel, size_t *alarm_num, size_t nth, uint16_t day, uint16_t month,
-                                        uint16_t year);
-uint8_t     model_get_nth_alarm(model_t *pmodel, size_t *alarm_num, size_t nth);
+size_t      model_get_day_alarms(model_t *pmodel, uint16_t day, uint16_t month, uint16_t year, size_t *alarms,
+                                 size_t max);
+uint32_t    model_get_month_alarm_days(model_t *pmodel, uint16_t month, uint16_t year);
+size_t      model_alarm_index_lower_bound(model_t *pmodel, uint64_t timestamp);
+void        model_rebuild_alarm_index(mut_model_t *pmodel);
+void        model_rebuild_today_alarms(mut_model_t *pmodel, uint64_t now);
+void        model_reposition_alarm(mut_model_t *pmodel, size_t alarm_num);
+void        model_update_alarm_occurrence(mut_model_t *pmodel, size_t alarm_num);
+uint8_t     model_alarm_occurs_on(const alarm_t *alarm, const struct tm *day_tm);
+uint8_t     model_is_today_stale(model_t *pmodel, uint64_t now);
+size_t      model_get_today_alarms_count(model_t *pmodel);
+uint8_t     model_get_nth_today_alarm(model_t *pmodel, size_t *alarm_num, size_t nth);
+uint8_t     model_get_next_alarm_after(model_t *pmodel, uint64_t timestamp, size_t *alarm_num, uint64_t *occurrence);
+uint8_t     model_get_following_alarm(model_t *pmodel, size_t *alarm_num, uint64_t *occurrence);
+uint64_t    model_get_alarm_end(model_t *pmodel, size_t alarm_num);
+size_t      model_get_alarms_in_progress(model_t *pmodel, uint64_t timestamp, size_t *alarms, size_t max);
+uint64_t    model_get_today_start(model_t *pmodel);
+uint64_t    model_get_today_end(model_t *pmodel);
 void        model_set_latest_release_state(mut_model_t *pmodel, http_request_state_t request_state, uint16_t major,
                                            uint16_t minor, uint16_t patch);
-void        model_set_night_mode(mut_model_t *pmodel, uint8_t night_mode);
-uint8_t     model_get_standby_brightness(model_t *pmodel);
+void        model_set_client_firmware_update_state(mut_model_t *pmodel, firmware_update_state_t state);
+void        model_touch(mut_model_t *pmodel, model_field_t field);
+uint32_t    model_get_generation(model_t *pmodel);
+uint32_t    model_get_field_generation(model_t *pmodel, model_field_t field);
+uint32_t    model_get_changes(model_t *pmodel, uint32_t *generation);
+uint8_t     model_firmware_update_state_equal(firmware_update_state_t first, firmware_update_state_t second);
+uint8_t     model_get_standby_brightness(model_t *pmodel, uint64_t now);
+uint8_t     model_is_night_mode_stale(model_t *pmodel, uint64_t now);
+void        model_update_night_mode(mut_model_t *pmodel, uint64_t now);
+uint8_t     model_is_world_clock_stale(model_t *pmodel, uint64_t now);
+void        model_update_world_clock(mut_model_t *pmodel, uint64_t now);
+const char *model_get_world_clock_name(model_t *pmodel, size_t zone);
+int32_t     model_get_world_clock_offset(model_t *pmodel, size_t zone);
+uint8_t     model_is_solar_schedule_stale(model_t *pmodel, uint64_t now);
+void        model_update_solar_schedule(mut_model_t *pmodel, uint64_t now);
+uint64_t    model_get_next_refresh(model_t *pmodel);
 uint8_t     model_is_new_release_available(model_t *pmodel);
 firmware_update_state_t model_get_firmware_update_state(model_t *pmodel);
 
@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <math.h>
+#include "civil_time.h"
+#include "solar.h"
+
+
+#define SECONDS_IN_DAY 86400.
+
+// Julian day of the J2000 epoch and of the Unix epoch
+#define J2000 2451545.
+#define J1970 2440587.5
+
+// Altitude of the sun's center at sunrise, accounting for refraction and the apparent radius
+#define SUNRISE_ALTITUDE -0.833
+#define DAWN_ALTITUDE    -6.
+
+#define RADIANS(degrees) ((degrees) * (M_PI / 180.))
+#define DEGREES(radians) ((radians) * (180. / M_PI))
+
+
+static double  hour_angle(double altitude, double latitude, double declination);
+static int64_t julian_to_epoch(double julian);
+
+
+/*
+ * Sunrise equation as used by the NOAA calculator, accurate to about a minute between the polar circles.
+ * `latitude` is north positive and `longitude` east positive, both in degrees. Where the sun does not cross an
+ * altitude the events collapse on noon (it stays below) or spread 12 hours around it (it stays above)
+ */
+void solar_compute_day(solar_day_t *day, int32_t year, uint32_t month, uint32_t mday, double latitude,
+                       double longitude) {
+    assert(day != NULL);
+
+    // Days from J2000 to the noon of the date
+    double n = (double)civil_time_days_from_civil(year, month, mday) + 0.5 + J1970 - J2000;
+    double j = n - longitude / 360.;
+
+    double anomaly  = fmod(357.5291 + 0.98560028 * j, 360.);
+    double center   = 1.9148 * sin(RADIANS(anomaly)) + 0.02 * sin(RADIANS(2 * anomaly)) +
+                    0.0003 * sin(RADIANS(3 * anomaly));
+    double ecliptic = fmod(anomaly + center + 180. + 102.9372, 360.);
+    double transit  = J2000 + j + 0.0053 * sin(RADIANS(anomaly)) - 0.0069 * sin(RADIANS(2 * ecliptic));
+
+    double declination = asin(sin(RADIANS(ecliptic)) * sin(RADIANS(23.4397)));
+    double sunrise     = hour_angle(SUNRISE_ALTITUDE, latitude, declination) / 360.;
+    double dawn        = hour_angle(DAWN_ALTITUDE, latitude, declination) / 360.;
+
+    day->dawn    = julian_to_epoch(transit - dawn);
+    day->sunrise = julian_to_epoch(transit - sunrise);
+    day->noon    = julian_to_epoch(transit);
+    day->sunset  = julian_to_epoch(transit + sunrise);
+    day->dusk    = julian_to_epoch(transit + dawn);
+}
+
+
+/*
+ * Degrees the earth turns between the sun crossing `altitude` and noon
+ */
+static double hour_angle(double altitude, double latitude, double declination) {
+    double cosine = (sin(RADIANS(altitude)) - sin(RADIANS(latitude)) * sin(declination)) /
+                    (cos(RADIANS(latitude)) * cos(declination));
+    if (cosine > 1.) {
+        cosine = 1.;
+    } else if (cosine < -1.) {
+        cosine = -1.;
+    }
+    return DEGREES(acos(cosine));
+}
+
+
+static int64_t julian_to_epoch(double julian) {
+    return (int64_t)floor((julian - J1970) * SECONDS_IN_DAY + .5);
+}
@@ -0,0 +1,22 @@
+#ifndef SOLAR_H_INCLUDED
+#define SOLAR_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// UTC epochs of the solar events of one day
+typedef struct {
+    int64_t dawn;        // Start of the civil twilight, with the sun 6 degrees below the horizon
+    int64_t sunrise;
+    int64_t noon;
+    int64_t sunset;
+    int64_t dusk;        // End of the civil twilight
+} solar_day_t;
+
+
+void solar_compute_day(solar_day_t *day, int32_t year, uint32_t month, uint32_t mday, double latitude,
+                       double longitude);
+
+
+#endif
@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <string.h>
+#include "string_arena.h"
+
+
+#define OWNER_SIZE     sizeof(uint16_t)
+#define RELEASED_OWNER UINT16_MAX
+#define MIN_CAPACITY   64
+
+
+static uint16_t get_owner(const string_arena_t *arena, size_t offset);
+static void     set_owner(string_arena_t *arena, size_t offset, uint16_t owner);
+
+
+void string_arena_init(string_arena_t *arena) {
+    assert(arena != NULL);
+    arena->buffer   = NULL;
+    arena->size     = 0;
+    arena->capacity = 0;
+    arena->garbage  = 0;
+}
+
+
+/*
+ * Appends the first `len` characters of `string`, growing the buffer up to `limit` bytes when compacting is not enough.
+ * Returns the offset of the string or STRING_ARENA_NONE if it does not fit.
+ */
+uint16_t string_arena_add(string_arena_t *arena, uint16_t owner, const char *string, size_t len, size_t limit,
+                          string_arena_relocate_t relocate, void *arg) {
+    assert(arena != NULL && string != NULL && owner != RELEASED_OWNER);
+    size_t needed = string_arena_entry_size(len);
+
+    if (limit > STRING_ARENA_LIMIT) {
+        limit = STRING_ARENA_LIMIT;
+    }
+
+    if ((size_t)arena->size + needed > arena->capacity && arena->garbage > 0) {
+        string_arena_compact(arena, relocate, arg);
+    }
+
+    if ((size_t)arena->size + needed > arena->capacity) {
+        size_t capacity = arena->capacity > 0 ? arena->capacity * 2 : MIN_CAPACITY;
+        if (capacity < (size_t)arena->size + needed) {
+            capacity = (size_t)arena->size + needed;
+        }
+        if (capacity > limit) {
+            capacity = limit;
+        }
+        if (capacity < (size_t)arena->size + needed) {
+            return STRING_ARENA_NONE;
+        }
+
+        char *buffer = realloc(arena->buffer, capacity);
+        if (buffer == NULL) {
+            return STRING_ARENA_NONE;
+        }
+        arena->buffer   = buffer;
+        arena->capacity = capacity;
+    }
+
+    uint16_t offset = arena->size + OWNER_SIZE;
+    set_owner(arena, arena->size, owner);
+    memcpy(&arena->buffer[offset], string, len);
+    arena->buffer[offset + len] = '\0';
+    arena->size += needed;
+
+    return offset;
+}
+
+
+void string_arena_release(string_arena_t *arena, uint16_t offset) {
+    assert(arena != NULL);
+    if (offset == STRING_ARENA_NONE) {
+        return;
+    }
+    assert(offset >= OWNER_SIZE && offset < arena->size);
+
+    set_owner(arena, offset - OWNER_SIZE, RELEASED_OWNER);
+    arena->garbage += string_arena_entry_size(strlen(&arena->buffer[offset]));
+}
+
+
+const char *string_arena_get(const string_arena_t *arena, uint16_t offset) {
+    assert(arena != NULL);
+    if (offset == STRING_ARENA_NONE) {
+        return "";
+    } else {
+        return &arena->buffer[offset];
+    }
+}
+
+
+/*
+ * Slides the live entries over the released ones; `relocate` is called for every string that moved.
+ * The buffer keeps its capacity.
+ */
+void string_arena_compact(string_arena_t *arena, string_arena_relocate_t relocate, void *arg) {
+    assert(arena != NULL);
+    size_t read = 0, write = 0;
+
+    while (read < arena->size) {
+        uint16_t owner = get_owner(arena, read);
+        size_t   size  = string_arena_entry_size(strlen(&arena->buffer[read + OWNER_SIZE]));
+
+        if (owner != RELEASED_OWNER) {
+            if (write != read) {
+                memmove(&arena->buffer[write], &arena->buffer[read], size);
+                if (relocate != NULL) {
+                    relocate(arg, owner, write + OWNER_SIZE);
+                }
+            }
+            write += size;
+        }
+        read += size;
+    }
+
+    arena->size    = write;
+    arena->garbage = 0;
+}
+
+
+size_t string_arena_entry_size(size_t len) {
+    return OWNER_SIZE + len + 1;
+}
+
+
+static uint16_t get_owner(const string_arena_t *arena, size_t offset) {
+    // Entries are not aligned
+    uint16_t owner = 0;
+    memcpy(&owner, &arena->buffer[offset], sizeof(owner));
+    return owner;
+}
+
+
+static void set_owner(string_arena_t *arena, size_t offset, uint16_t owner) {
+    memcpy(&arena->buffer[offset], &owner, sizeof(owner));
+}
@@ -0,0 +1,37 @@
+#ifndef STRING_ARENA_H_INCLUDED
+#define STRING_ARENA_H_INCLUDED
+
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define STRING_ARENA_NONE  UINT16_MAX
+#define STRING_ARENA_LIMIT UINT16_MAX
+
+
+/*
+ * Variable length strings packed one after the other in a single buffer.
+ * Every entry is tagged with the number of its owner, so that compaction can tell the owner where its string moved.
+ */
+typedef struct {
+    char    *buffer;
+    uint16_t size;         // Bytes in use, including released entries
+    uint16_t capacity;     // Bytes allocated
+    uint16_t garbage;      // Bytes held by released entries
+} string_arena_t;
+
+
+typedef void (*string_arena_relocate_t)(void *arg, uint16_t owner, uint16_t offset);
+
+
+void        string_arena_init(string_arena_t *arena);
+uint16_t    string_arena_add(string_arena_t *arena, uint16_t owner, const char *string, size_t len, size_t limit,
+                             string_arena_relocate_t relocate, void *arg);
+void        string_arena_release(string_arena_t *arena, uint16_t offset);
+const char *string_arena_get(const string_arena_t *arena, uint16_t offset);
+void        string_arena_compact(string_arena_t *arena, string_arena_relocate_t relocate, void *arg);
+size_t      string_arena_entry_size(size_t len);
+
+
+#endif
@@ -3,10 +3,13 @@
 #include <stdio.h>
 #include <assert.h>
 #include "updater.h"
+#include "civil_time.h"
+#include "command_log.h"
+#include "services/clock.h"
 #include <esp_log.h>
 
 
-#define MODIFIER(name, field, multiplier, min, max)                                                                    \
+#define MODIFIER(name, field, field_id, multiplier, min, max)                                                          \
     void model_updater_modify_##name(model_updater_t updater, int change) {                                            \
         assert(updater != NULL);                                                                                       \
         mut_model_t *pmodel = updater->pmodel;                                                                         \
@@ -22,15 +25,19 @@
                 pmodel->field = min;                                                                                   \
             }                                                                                                          \
         }                                                                                                              \
+        model_touch(pmodel, field_id);                                                                                 \
+        log_field(updater, field_id, pmodel->field);                                                                   \
     }
 
 
-#define SETTER(name, field)                                                                                            \
+#define SETTER(name, field, field_id)                                                                                  \
     uint8_t model_updater_set_##name(model_updater_t updater, typeof(((model_t *)0)->field) value) {                   \
         assert(updater != NULL);                                                                                       \
         mut_model_t *pmodel = updater->pmodel;                                                                         \
         if (pmodel->field != value) {                                                                                  \
             pmodel->field = value;                                                                                     \
+            model_touch(pmodel, field_id);                                                                             \
+            log_field(updater, field_id, value);                                                                       \
             return 1;                                                                                                  \
         } else {                                                                                                       \
             return 0;                                                                                                  \
@@ -38,20 +45,49 @@
     }
 
 
-#define TOGGLER(name, field)                                                                                           \
+#define TOGGLER(name, field, field_id)                                                                                 \
     void model_updater_toggle_##name(model_updater_t updater) {                                                        \
         assert(updater != NULL);                                                                                       \
         mut_model_t *pmodel = updater->pmodel;                                                                         \
         pmodel->field       = !pmodel->field;                                                                          \
+        model_touch(pmodel, field_id);                                                                                 \
+        log_field(updater, field_id, pmodel->field);                                                                   \
     }
 
 
 
 struct model_updater {
     mut_model_t *pmodel;
+
+    // Alarms written by the open batch; indexing and notifications are deferred to the commit
+    struct {
+        uint8_t   open;
+        uint8_t   grown;
+        uint16_t *alarms;
+        size_t    count;
+        size_t    capacity;
+        size_t    free_cursor;
+        size_t    free_end;
+    } batch;
+
+    // Optional records of the commands, not written while `log_suspended` (nested calls and replays): `log` for a
+    // whole session, `journal` for what changed since the last checkpoint of the persistance
+    command_log_t *log;
+    command_log_t *journal;
+    uint8_t        log_suspended;
 };
 
 
+static int  is_record_valid(model_t *pmodel, const alarm_record_t *record);
+static int  reserve_batch_entry(model_updater_t updater);
+static int  write_batch_alarm(model_updater_t updater, size_t alarm_num, const alarm_record_t *record);
+static void log_command(model_updater_t updater, model_command_tag_t tag, size_t target, uint32_t value,
+                        const void *payload, size_t len);
+static void log_field(model_updater_t updater, model_field_t field, uint32_t value);
+static void log_record(model_updater_t updater, model_command_tag_t tag, size_t target, const alarm_record_t *record);
+static int  replay_command(model_updater_t updater, const model_command_t *command, const uint8_t *payload);
+
+
 static const char *TAG = "ModelUpdater";
 
 
@@ -59,6 +95,13 @@ model_updater_t model_updater_init(mut_model_t *pmodel) {
     (void)TAG;
     model_updater_t updater = malloc(sizeof(struct model_updater));
     updater->pmodel         = pmodel;
+    updater->batch.open     = 0;
+    updater->batch.alarms   = NULL;
+    updater->batch.count    = 0;
+    updater->batch.capacity = 0;
+    updater->log            = NULL;
+    updater->journal        = NULL;
+    updater->log_suspended  = 0;
     model_init(pmodel);
 
     return updater;
@@ -71,46 +114,61 @@ mut_model_t *model_updater_read(model_updater_t updater) {
 }
 
 
-void model_updater_set_military_time(model_updater_t updater, uint8_t military_time) {
-    assert(updater != NULL);
-    updater->pmodel->config.military_time = military_time;
-}
-
-
 void model_updater_set_normal_brightness(model_updater_t updater, uint8_t brightness) {
     assert(updater != NULL);
-    updater->pmodel->config.normal_brightness = brightness - (brightness % 5);
+    brightness -= brightness % 5;
+    if (updater->pmodel->config.normal_brightness != brightness) {
+        updater->pmodel->config.normal_brightness = brightness;
+        model_touch(updater->pmodel, MODEL_FIELD_NORMAL_BRIGHTNESS);
+        log_field(updater, MODEL_FIELD_NORMAL_BRIGHTNESS, brightness);
+    }
 }
 
 
 void model_updater_set_standby_brightness(model_updater_t updater, uint8_t brightness) {
     assert(updater != NULL);
-    updater->pmodel->config.standby_brightness = brightness - (brightness % 5);
+    brightness -= brightness % 5;
+    if (updater->pmodel->config.standby_brightness != brightness) {
+        updater->pmodel->config.standby_brightness = brightness;
+        model_touch(updater->pmodel, MODEL_FIELD_STANDBY_BRIGHTNESS);
+        log_field(updater, MODEL_FIELD_STANDBY_BRIGHTNESS, brightness);
+    }
 }
 
 
 void model_updater_set_standby_delay(model_updater_t updater, uint16_t delay) {
     assert(updater != NULL);
-    updater->pmodel->config.standby_delay_seconds = delay - (delay % 5);
+    delay -= delay % 5;
+    if (updater->pmodel->config.standby_delay_seconds != delay) {
+        updater->pmodel->config.standby_delay_seconds = delay;
+        model_touch(updater->pmodel, MODEL_FIELD_STANDBY_DELAY);
+        log_field(updater, MODEL_FIELD_STANDBY_DELAY, delay);
+    }
 }
 
 
 void model_updater_update_wifi_state(model_updater_t updater, const char *ssid, uint32_t ip_addr,
                                      wifi_state_t wifi_state) {
     assert(updater != NULL);
-    if (ssid != NULL) {
-        snprintf(updater->pmodel->run.ssid, sizeof(updater->pmodel->run.ssid), "%s", ssid);
-    } else {
-        strcpy(updater->pmodel->run.ssid, "");
+    mut_model_t *pmodel = updater->pmodel;
+
+    if (ssid == NULL) {
+        ssid = "";
+    }
+    if (strncmp(pmodel->run.ssid, ssid, sizeof(pmodel->run.ssid) - 1) != 0 || pmodel->run.ip_addr != ip_addr ||
+        pmodel->run.wifi_state != wifi_state) {
+        snprintf(pmodel->run.ssid, sizeof(pmodel->run.ssid), "%s", ssid);
+        pmodel->run.ip_addr    = ip_addr;
+        pmodel->run.wifi_state = wifi_state;
+        model_touch(pmodel, MODEL_FIELD_WIFI_STATE);
     }
-    updater->pmodel->run.ip_addr    = ip_addr;
-    updater->pmodel->run.wifi_state = wifi_state;
 }
 
 
 void model_updater_clear_aps(model_updater_t updater) {
     assert(updater != NULL);
     updater->pmodel->run.ap_list_size = 0;
+    model_touch(updater->pmodel, MODEL_FIELD_AP_LIST);
 }
 
 
@@ -122,57 +180,625 @@ void model_updater_add_ap(model_updater_t updater, const char *ssid, int16_t rss
         snprintf(updater->pmodel->run.ap_list[i].ssid, sizeof(updater->pmodel->run.ap_list[i].ssid), "%s", ssid);
         updater->pmodel->run.ap_list[i].rssi = rssi;
         updater->pmodel->run.ap_list_size++;
+        model_touch(updater->pmodel, MODEL_FIELD_AP_LIST);
+    }
+}
+
+
+void model_updater_set_server_firmware_update_state(model_updater_t updater, firmware_update_state_t state) {
+    assert(updater != NULL);
+    if (!model_firmware_update_state_equal(updater->pmodel->run.server_firmware_update_state, state)) {
+        updater->pmodel->run.server_firmware_update_state = state;
+        model_touch(updater->pmodel, MODEL_FIELD_FIRMWARE_UPDATE_STATE);
     }
 }
 
 
 void model_updater_set_alarm_description(model_updater_t updater, size_t alarm_num, const char *description) {
     assert(updater != NULL);
-    snprintf(updater->pmodel->config.alarms[alarm_num].description,
-             sizeof(updater->pmodel->config.alarms[alarm_num].description), "%s", description);
+    if (model_set_alarm_description(updater->pmodel, alarm_num, description)) {
+        ESP_LOGW(TAG, "No room left for the description of alarm %zu", alarm_num);
+    }
+    model_touch(updater->pmodel, MODEL_FIELD_ALARMS);
+    log_command(updater, MODEL_COMMAND_SET_ALARM_DESCRIPTION, alarm_num, 0, description, strlen(description));
 }
 
 
 void model_updater_set_alarm_time(model_updater_t updater, size_t alarm_num, unsigned long timestamp) {
     assert(updater != NULL);
     updater->pmodel->config.alarms[alarm_num].timestamp = timestamp;
+    model_reposition_alarm(updater->pmodel, alarm_num);
+    model_touch(updater->pmodel, MODEL_FIELD_ALARMS);
+    log_command(updater, MODEL_COMMAND_SET_ALARM_TIME, alarm_num, timestamp, NULL, 0);
 }
 
 
-size_t model_updater_add_alarm(model_updater_t updater, uint16_t day, uint16_t month, uint16_t year) {
+void model_updater_set_alarm_recurrence(model_updater_t updater, size_t alarm_num, alarm_recurrence_t recurrence,
+                                        uint8_t weekdays) {
     assert(updater != NULL);
-    size_t  alarm_num = 0;
-    uint8_t found     = 0;
+    alarm_t *alarm = &updater->pmodel->config.alarms[alarm_num];
+
+    if (alarm->recurrence != recurrence || alarm->weekdays != weekdays) {
+        alarm->recurrence = recurrence;
+        alarm->weekdays   = weekdays;
+        // Rare enough that rebuilding the whole index (and the list of recurring alarms) is fine
+        model_rebuild_alarm_index(updater->pmodel);
+        model_touch(updater->pmodel, MODEL_FIELD_ALARMS);
+        log_command(updater, MODEL_COMMAND_SET_ALARM_RECURRENCE, alarm_num, recurrence | (weekdays << 8), NULL, 0);
+    }
+}
 
-    for (size_t i = 0; i < updater->pmodel->config.num_alarms; i++) {
-        if (model_is_alarm_expired(updater->pmodel, i)) {
-            alarm_num = i;
-            found     = 1;
-            break;
-        }
+
+/*
+ * Durations are not part of the ordering, only the ends of the index need to be updated
+ */
+void model_updater_set_alarm_duration(model_updater_t updater, size_t alarm_num, uint16_t minutes) {
+    assert(updater != NULL);
+    alarm_t *alarm = &updater->pmodel->config.alarms[alarm_num];
+
+    if (alarm->duration != minutes) {
+        alarm->duration = minutes;
+        model_reposition_alarm(updater->pmodel, alarm_num);
+        model_touch(updater->pmodel, MODEL_FIELD_ALARMS);
+        log_command(updater, MODEL_COMMAND_SET_ALARM_DURATION, alarm_num, minutes, NULL, 0);
     }
+}
 
-    if (!found) {
-        alarm_num = updater->pmodel->config.num_alarms;
-        if (updater->pmodel->config.num_alarms < MAX_ALARMS) {
-            updater->pmodel->config.num_alarms++;
+
+/*
+ * The slot sorts first in the index, where it is the next one reused. The description goes back to the arena now
+ */
+void model_updater_delete_alarm(model_updater_t updater, size_t alarm_num) {
+    assert(updater != NULL);
+    updater->log_suspended++;
+    model_updater_set_alarm_description(updater, alarm_num, "");
+    model_updater_set_alarm_recurrence(updater, alarm_num, ALARM_RECURRENCE_NONE, 0);
+    model_updater_set_alarm_time(updater, alarm_num, 0);
+    updater->log_suspended--;
+    log_command(updater, MODEL_COMMAND_DELETE_ALARM, alarm_num, 0, NULL, 0);
+}
+
+
+void model_updater_refresh_today(model_updater_t updater) {
+    assert(updater != NULL);
+    time_t now = clock_now();
+    if (model_is_today_stale(updater->pmodel, now)) {
+        // Also covers clock steps, e.g. the first SNTP sync
+        civil_time_prepare_local(now);
+        model_rebuild_today_alarms(updater->pmodel, now);
+        model_touch(updater->pmodel, MODEL_FIELD_ALARMS);
+    }
+}
+
+
+/*
+ * Night mode transitions are computed ahead, so the standby brightness does not need the local time every iteration
+ */
+void model_updater_refresh_night_mode(model_updater_t updater) {
+    assert(updater != NULL);
+    time_t now = clock_now();
+    if (model_is_night_mode_stale(updater->pmodel, now)) {
+        civil_time_prepare_local(now);
+        model_update_night_mode(updater->pmodel, now);
+    }
+}
+
+
+/*
+ * Offsets change only at DST transitions, the face adds them to the current time
+ */
+void model_updater_refresh_world_clock(model_updater_t updater) {
+    assert(updater != NULL);
+    time_t now = clock_now();
+    if (model_is_world_clock_stale(updater->pmodel, now)) {
+        model_update_world_clock(updater->pmodel, now);
+    }
+}
+
+
+void model_updater_set_world_clock_city(model_updater_t updater, size_t zone, uint8_t city) {
+    assert(updater != NULL && zone < WORLD_CLOCK_ZONES);
+    if (updater->pmodel->config.world_clock.cities[zone] != city) {
+        updater->pmodel->config.world_clock.cities[zone] = city;
+        model_touch(updater->pmodel, MODEL_FIELD_WORLD_CLOCK);
+        log_command(updater, MODEL_COMMAND_SET_WORLD_CLOCK_CITY, zone, city, NULL, 0);
+    }
+}
+
+
+/*
+ * The ephemeris is evaluated once per day, the standby brightness is then sampled from the cached events
+ */
+void model_updater_refresh_solar_schedule(model_updater_t updater) {
+    assert(updater != NULL);
+    time_t now = clock_now();
+    if (model_is_solar_schedule_stale(updater->pmodel, now)) {
+        civil_time_prepare_local(now);
+        model_update_solar_schedule(updater->pmodel, now);
+    }
+}
+
+
+void model_updater_set_solar_location(model_updater_t updater, int16_t latitude, int16_t longitude) {
+    assert(updater != NULL);
+    mut_model_t *pmodel = updater->pmodel;
+    if (pmodel->config.solar_schedule.latitude != latitude || pmodel->config.solar_schedule.longitude != longitude) {
+        pmodel->config.solar_schedule.latitude  = latitude;
+        pmodel->config.solar_schedule.longitude = longitude;
+        model_touch(pmodel, MODEL_FIELD_SOLAR_SCHEDULE);
+        log_command(updater, MODEL_COMMAND_SET_SOLAR_LOCATION, 0,
+                    (uint16_t)latitude | ((uint32_t)(uint16_t)longitude << 16), NULL, 0);
+    }
+}
+
+
+/*
+ * Returns the number of the new alarm, or -1 if the table is full
+ */
+int model_updater_add_alarm(model_updater_t updater, uint16_t day, uint16_t month, uint16_t year) {
+    assert(updater != NULL);
+    mut_model_t *pmodel    = updater->pmodel;
+    size_t       alarm_num = 0;
+
+    if (!model_get_free_alarm_slot(pmodel, &alarm_num)) {
+        alarm_num = pmodel->config.num_alarms;
+        if (model_reserve_alarms(pmodel, alarm_num + 1)) {
+            ESP_LOGW(TAG, "Alarm table full");
+            return -1;
         }
+
+        // New slots start as the oldest alarm (after the deleted ones, which have lower numbers) and get moved in
+        // place once their time is set
+        size_t position = model_alarm_index_lower_bound(pmodel, 1);
+        size_t moved    = pmodel->config.num_alarms - position;
+        memmove(&pmodel->run.alarm_index[position + 1], &pmodel->run.alarm_index[position],
+                moved * sizeof(pmodel->run.alarm_index[0]));
+        memmove(&pmodel->run.max_ends[position + 1], &pmodel->run.max_ends[position],
+                moved * sizeof(pmodel->run.max_ends[0]));
+        pmodel->run.alarm_index[position]            = alarm_num;
+        pmodel->run.max_ends[position]               = position > 0 ? pmodel->run.max_ends[position - 1] : 0;
+        pmodel->config.alarms[alarm_num].timestamp   = 0;
+        pmodel->config.alarms[alarm_num].description = STRING_ARENA_NONE;
+        pmodel->config.alarms[alarm_num].recurrence  = ALARM_RECURRENCE_NONE;
+        pmodel->config.alarms[alarm_num].weekdays    = 0;
+        pmodel->config.alarms[alarm_num].duration    = 0;
+        pmodel->run.occurrences[alarm_num]           = 0;
+        pmodel->config.num_alarms++;
+        model_touch(pmodel, MODEL_FIELD_NUM_ALARMS);
     }
 
+    // Logged as a single command, the steps are replayed by running it again
+    updater->log_suspended++;
     model_updater_set_alarm_description(updater, alarm_num, "New event");
+    model_updater_set_alarm_recurrence(updater, alarm_num, ALARM_RECURRENCE_NONE, 0);
+    model_updater_set_alarm_duration(updater, alarm_num, 0);
 
-    time_t    now    = time(NULL);
-    struct tm tm_now = *localtime(&now);
+    time_t    now    = clock_now();
+    struct tm tm_now = civil_time_localtime(now);
     tm_now.tm_mday   = day;
     tm_now.tm_mon    = month;
     tm_now.tm_year   = year;
     tm_now.tm_sec    = 0;
-    time_t timestamp = mktime(&tm_now);
+    time_t timestamp = civil_time_mktime(&tm_now);
 
     model_updater_set_alarm_time(updater, alarm_num, timestamp);
+    updater->log_suspended--;
+    log_command(updater, MODEL_COMMAND_ADD_ALARM, alarm_num, day | (month << 8) | ((uint32_t)year << 16), NULL, 0);
+    // The time of day comes from the clock, so a replay would not get the same one
+    log_command(updater, MODEL_COMMAND_SET_ALARM_TIME, alarm_num, timestamp, NULL, 0);
+
+    return alarm_num;
+}
+
+
+/*
+ * Starts collecting alarm changes; nothing is indexed or notified until model_updater_commit_alarm_batch
+ */
+void model_updater_begin_alarm_batch(model_updater_t updater) {
+    assert(updater != NULL && !updater->batch.open);
+    updater->batch.open        = 1;
+    updater->batch.grown       = 0;
+    updater->batch.count       = 0;
+    updater->batch.free_cursor = 0;
+    updater->batch.free_end    = model_get_expired_alarms(updater->pmodel);
+    log_command(updater, MODEL_COMMAND_BEGIN_ALARM_BATCH, 0, 0, NULL, 0);
+}
+
+
+/*
+ * Adds an alarm to the open batch, in the first expired slot or in a new one.
+ * Returns the alarm number, or -1 if the record is not valid or the store is full
+ */
+int model_updater_batch_add_alarm(model_updater_t updater, const alarm_record_t *record) {
+    assert(updater != NULL && updater->batch.open && record != NULL);
+    mut_model_t *pmodel = updater->pmodel;
+
+    // Room for the alarm number first, so that nothing is left behind when there is none
+    if (!is_record_valid(pmodel, record) || reserve_batch_entry(updater)) {
+        return -1;
+    }
+
+    // The index is not updated until the commit, so the expired prefix it had at the beginning is walked in order.
+    // Slots replaced in the meantime are not expired anymore and get skipped
+    size_t  alarm_num = 0;
+    uint8_t found     = 0;
+    while (!found && updater->batch.free_cursor < updater->batch.free_end) {
+        alarm_num = pmodel->run.alarm_index[updater->batch.free_cursor++];
+        found     = model_is_alarm_expired(pmodel, alarm_num);
+    }
+
+    if (!found) {
+        alarm_num = pmodel->config.num_alarms;
+        if (model_reserve_alarms(pmodel, alarm_num + 1)) {
+            return -1;
+        }
+        // A complete entry before it is counted, the description follows and the index is sorted again on commit
+        pmodel->run.alarm_index[alarm_num] = alarm_num;
+        pmodel->config.alarms[alarm_num]   = (alarm_t){
+            .timestamp   = record->timestamp,
+            .description = STRING_ARENA_NONE,
+            .recurrence  = record->recurrence,
+            .weekdays    = record->weekdays,
+            .duration    = record->duration,
+        };
+        model_update_alarm_occurrence(pmodel, alarm_num);
+        pmodel->config.num_alarms++;
+        updater->batch.grown = 1;
+    }
+
+    int result = write_batch_alarm(updater, alarm_num, record);
+    if (result >= 0) {
+        log_record(updater, MODEL_COMMAND_BATCH_ADD_ALARM, alarm_num, record);
+    }
+    return result;
+}
+
+
+/*
+ * Overwrites an existing alarm as part of the open batch. Returns -1 if the record is not valid
+ */
+int model_updater_batch_replace_alarm(model_updater_t updater, size_t alarm_num, const alarm_record_t *record) {
+    assert(updater != NULL && updater->batch.open && record != NULL);
+
+    if (alarm_num >= updater->pmodel->config.num_alarms || !is_record_valid(updater->pmodel, record) ||
+        reserve_batch_entry(updater)) {
+        return -1;
+    }
 
+    int result = write_batch_alarm(updater, alarm_num, record);
+    if (result >= 0) {
+        log_record(updater, MODEL_COMMAND_BATCH_REPLACE_ALARM, alarm_num, record);
+    }
+    return result;
+}
+
+
+/*
+ * Indexes the alarms of the batch and notifies the change once.
+ * Returns how many alarms were written and, in `alarms`, their numbers (valid until the next batch)
+ */
+size_t model_updater_commit_alarm_batch(model_updater_t updater, const uint16_t **alarms) {
+    assert(updater != NULL && updater->batch.open);
+    mut_model_t *pmodel = updater->pmodel;
+
+    updater->batch.open = 0;
+    if (updater->batch.count > 0) {
+        model_rebuild_alarm_index(pmodel);
+        model_touch(pmodel, MODEL_FIELD_ALARMS);
+    }
+    if (updater->batch.grown) {
+        model_touch(pmodel, MODEL_FIELD_NUM_ALARMS);
+    }
+    log_command(updater, MODEL_COMMAND_COMMIT_ALARM_BATCH, 0, 0, NULL, 0);
+
+    if (alarms != NULL) {
+        *alarms = updater->batch.alarms;
+    }
+    return updater->batch.count;
+}
+
+
+SETTER(military_time, config.military_time, MODEL_FIELD_MILITARY_TIME);
+SETTER(night_mode, config.night_mode, MODEL_FIELD_NIGHT_MODE);
+SETTER(night_mode_start, config.night_mode_start, MODEL_FIELD_NIGHT_MODE_START);
+SETTER(night_mode_end, config.night_mode_end, MODEL_FIELD_NIGHT_MODE_END);
+SETTER(scanning, run.scanning, MODEL_FIELD_SCANNING);
+SETTER(world_clock, config.world_clock.enabled, MODEL_FIELD_WORLD_CLOCK);
+SETTER(solar_schedule, config.solar_schedule.enabled, MODEL_FIELD_SOLAR_SCHEDULE);
+
+
+/*
+ * Every change made through the updater from now on is appended to `log`; NULL stops recording
+ */
+void model_updater_set_command_log(model_updater_t updater, command_log_t *log) {
+    assert(updater != NULL);
+    updater->log = log;
+}
+
+
+/*
+ * Like model_updater_set_command_log, for the journal of the persistance; both can be set at once
+ */
+void model_updater_set_journal(model_updater_t updater, command_log_t *journal) {
+    assert(updater != NULL);
+    updater->journal = journal;
+}
+
+
+/*
+ * Applies the commands recorded in `log`, which are not recorded again. Returns how many were applied and, in
+ * `diverged` if not NULL, how many did not land where they were recorded (e.g. an alarm added in another slot)
+ */
+size_t model_updater_replay(model_updater_t updater, const command_log_t *log, size_t *diverged) {
+    assert(updater != NULL && log != NULL);
+    model_command_t command = {0};
+    uint8_t         payload[UINT8_MAX + 1];
+    size_t          cursor  = 0;
+    size_t          count   = 0;
+    size_t          missed  = 0;
+
+    updater->log_suspended++;
+    while ((cursor = command_log_read(log, cursor, &command, payload)) > 0) {
+        payload[command.len] = '\0';
+        if (replay_command(updater, &command, payload)) {
+            missed++;
+        }
+        count++;
+    }
+    updater->log_suspended--;
+
+    if (diverged != NULL) {
+        *diverged = missed;
+    }
+    return count;
+}
+
+
+/*
+ * Alarms that would be expired right away are refused, as are malformed recurrences
+ */
+static int is_record_valid(model_t *pmodel, const alarm_record_t *record) {
+    if (record->timestamp == 0 || record->timestamp > UINT32_MAX || record->recurrence >= ALARM_RECURRENCE_NUM ||
+        record->weekdays >= (1 << 7) || (record->recurrence == ALARM_RECURRENCE_WEEKLY && record->weekdays == 0)) {
+        return 0;
+    }
+    if (record->recurrence == ALARM_RECURRENCE_NONE && record->timestamp < model_get_today_start(pmodel)) {
+        return 0;
+    }
+    return 1;
+}
+
+
+/*
+ * Makes room for one more alarm number in the batch. Returns -1 if there is none
+ */
+static int reserve_batch_entry(model_updater_t updater) {
+    if (updater->batch.count == updater->batch.capacity) {
+        size_t    capacity = updater->batch.capacity > 0 ? updater->batch.capacity * 2 : 16;
+        uint16_t *grown    = realloc(updater->batch.alarms, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        updater->batch.alarms   = grown;
+        updater->batch.capacity = capacity;
+    }
+    return 0;
+}
+
+
+/*
+ * Writes the record in the slot; reserve_batch_entry has made room for its number
+ */
+static int write_batch_alarm(model_updater_t updater, size_t alarm_num, const alarm_record_t *record) {
+    mut_model_t *pmodel = updater->pmodel;
+
+    alarm_t *alarm    = &pmodel->config.alarms[alarm_num];
+    alarm->timestamp  = record->timestamp;
+    alarm->recurrence = record->recurrence;
+    alarm->weekdays   = record->weekdays;
+    alarm->duration   = record->duration;
+    if (model_set_alarm_description(pmodel, alarm_num, record->description != NULL ? record->description : "")) {
+        ESP_LOGW(TAG, "No room left for the description of alarm %zu", alarm_num);
+    }
+    // Keeps model_is_alarm_expired accurate for the slot search until the index is rebuilt
+    model_update_alarm_occurrence(pmodel, alarm_num);
+
+    updater->batch.alarms[updater->batch.count++] = alarm_num;
     return alarm_num;
 }
 
 
-SETTER(scanning, run.scanning);
+/*
+ * Returns -1 if the command did not apply as it was recorded
+ */
+static int replay_command(model_updater_t updater, const model_command_t *command, const uint8_t *payload) {
+    mut_model_t *pmodel = updater->pmodel;
+    size_t       target = command->target;
+    uint32_t     value  = command->value;
+    int          result = 0;
+
+    // Only the persisted configuration is meaningful after a restart
+    switch (command->tag) {
+        case MODEL_COMMAND_SET_FIELD:
+            switch (target) {
+                case MODEL_FIELD_MILITARY_TIME:
+                    model_updater_set_military_time(updater, value);
+                    break;
+                case MODEL_FIELD_NORMAL_BRIGHTNESS:
+                    model_updater_set_normal_brightness(updater, value);
+                    break;
+                case MODEL_FIELD_STANDBY_BRIGHTNESS:
+                    model_updater_set_standby_brightness(updater, value);
+                    break;
+                case MODEL_FIELD_STANDBY_DELAY:
+                    model_updater_set_standby_delay(updater, value);
+                    break;
+                case MODEL_FIELD_NIGHT_MODE:
+                    model_updater_set_night_mode(updater, value);
+                    break;
+                case MODEL_FIELD_NIGHT_MODE_START:
+                    model_updater_set_night_mode_start(updater, value);
+                    break;
+                case MODEL_FIELD_NIGHT_MODE_END:
+                    model_updater_set_night_mode_end(updater, value);
+                    break;
+                case MODEL_FIELD_WORLD_CLOCK:
+                    model_updater_set_world_clock(updater, value);
+                    break;
+                case MODEL_FIELD_SOLAR_SCHEDULE:
+                    model_updater_set_solar_schedule(updater, value);
+                    break;
+                default:
+                    break;
+            }
+            break;
+
+        case MODEL_COMMAND_ADD_ALARM: {
+            int alarm_num = model_updater_add_alarm(updater, value & 0xFF, (value >> 8) & 0xFF, value >> 16);
+            if (alarm_num != (int)target) {
+                ESP_LOGW(TAG, "Replayed alarm %zu was added as %i", target, alarm_num);
+                result = -1;
+            }
+            break;
+        }
+
+        case MODEL_COMMAND_SET_ALARM_TIME:
+            if (target < pmodel->config.num_alarms) {
+                model_updater_set_alarm_time(updater, target, value);
+            } else {
+                result = -1;
+            }
+            break;
+
+        case MODEL_COMMAND_SET_ALARM_RECURRENCE:
+            if (target < pmodel->config.num_alarms) {
+                model_updater_set_alarm_recurrence(updater, target, value & 0xFF, (value >> 8) & 0xFF);
+            } else {
+                result = -1;
+            }
+            break;
+
+        case MODEL_COMMAND_SET_ALARM_DURATION:
+            if (target < pmodel->config.num_alarms) {
+                model_updater_set_alarm_duration(updater, target, value);
+            } else {
+                result = -1;
+            }
+            break;
+
+        case MODEL_COMMAND_SET_WORLD_CLOCK_CITY:
+            if (target < WORLD_CLOCK_ZONES) {
+                model_updater_set_world_clock_city(updater, target, value);
+            } else {
+                result = -1;
+            }
+            break;
+
+        case MODEL_COMMAND_SET_SOLAR_LOCATION:
+            model_updater_set_solar_location(updater, (int16_t)(value & 0xFFFF), (int16_t)(value >> 16));
+            break;
+
+        case MODEL_COMMAND_SET_ALARM_DESCRIPTION:
+            if (target < pmodel->config.num_alarms) {
+                model_updater_set_alarm_description(updater, target, (const char *)payload);
+            } else {
+                result = -1;
+            }
+            break;
+
+        case MODEL_COMMAND_DELETE_ALARM:
+            if (target < pmodel->config.num_alarms) {
+                model_updater_delete_alarm(updater, target);
+            } else {
+                result = -1;
+            }
+            break;
+
+        case MODEL_COMMAND_BEGIN_ALARM_BATCH:
+            if (!updater->batch.open) {
+                model_updater_begin_alarm_batch(updater);
+            }
+            break;
+
+        case MODEL_COMMAND_BATCH_ADD_ALARM:
+        case MODEL_COMMAND_BATCH_REPLACE_ALARM: {
+            if (!updater->batch.open || command->len < 4) {
+                result = -1;
+                break;
+            }
+            alarm_record_t record = {
+                .timestamp   = value,
+                .recurrence  = payload[0],
+                .weekdays    = payload[1],
+                .duration    = payload[2] | (payload[3] << 8),
+                .description = (const char *)&payload[4],
+            };
+            int alarm_num = command->tag == MODEL_COMMAND_BATCH_ADD_ALARM
+                                ? model_updater_batch_add_alarm(updater, &record)
+                                : model_updater_batch_replace_alarm(updater, target, &record);
+            if (alarm_num != (int)target) {
+                ESP_LOGW(TAG, "Replayed alarm %zu was written as %i", target, alarm_num);
+                result = -1;
+            }
+            break;
+        }
+
+        case MODEL_COMMAND_COMMIT_ALARM_BATCH:
+            if (updater->batch.open) {
+                model_updater_commit_alarm_batch(updater, NULL);
+            }
+            break;
+
+        default:
+            ESP_LOGW(TAG, "Unknown command %i", command->tag);
+            result = -1;
+            break;
+    }
+
+    return result;
+}
+
+
+static void log_command(model_updater_t updater, model_command_tag_t tag, size_t target, uint32_t value,
+                        const void *payload, size_t len) {
+    if ((updater->log == NULL && updater->journal == NULL) || updater->log_suspended) {
+        return;
+    }
+
+    if (len > UINT8_MAX) {
+        len = UINT8_MAX;
+    }
+    model_command_t command = {.tag = tag, .len = len, .target = target, .value = value};
+    if (updater->log != NULL) {
+        command_log_append(updater->log, &command, payload);
+    }
+    if (updater->journal != NULL) {
+        command_log_append(updater->journal, &command, payload);
+    }
+}
+
+
+static void log_field(model_updater_t updater, model_field_t field, uint32_t value) {
+    log_command(updater, MODEL_COMMAND_SET_FIELD, field, value, NULL, 0);
+}
+
+
+static void log_record(model_updater_t updater, model_command_tag_t tag, size_t target, const alarm_record_t *record) {
+    if ((updater->log == NULL && updater->journal == NULL) || updater->log_suspended) {
+        return;
+    }
+
+    uint8_t     payload[UINT8_MAX];
+    const char *description = record->description != NULL ? record->description : "";
+    size_t      len         = strlen(description);
+    if (len > sizeof(payload) - 4) {
+        len = sizeof(payload) - 4;
+    }
+
+    payload[0] = record->recurrence;
+    payload[1] = record->weekdays;
+    payload[2] = record->duration & 0xFF;
+    payload[3] = record->duration >> 8;
+    memcpy(&payload[4], description, len);
+    log_command(updater, tag, target, record->timestamp, payload, len + 4);
+}
@@ -4,9 +4,10 @@
 
 #include <stdlib.h>
 #include "model.h"
+#include "command_log.h"
 
 
-#define SETTER(name, field)                                                                                            \
+#define SETTER(name, field, field_id)                                                                                  \
     uint8_t model_updater_set_##name(model_updater_t updater, typeof(((model_t *)0)->field) value);
 
 
@@ -15,7 +16,6 @@ typedef struct model_updater *model_updater_t;
 
 model_updater_t model_updater_init(mut_model_t *pmodel);
 mut_model_t    *model_updater_read(model_updater_t updater);
-void            model_updater_set_military_time(model_updater_t updater, uint8_t military_time);
 void            model_updater_set_normal_brightness(model_updater_t updater, uint8_t brightness);
 void            model_updater_set_standby_brightness(model_updater_t updater, uint8_t brightness);
 void            model_updater_set_standby_delay(model_updater_t updater, uint16_t delay);
@@ -23,11 +23,36 @@ void            model_updater_update_wifi_state(model_updater_t updater, const c
                                                 wifi_state_t wifi_state);
 void            model_updater_clear_aps(model_updater_t updater);
 void            model_updater_add_ap(model_updater_t updater, const char *ssid, int16_t rssi);
-size_t          model_updater_add_alarm(model_updater_t updater, uint16_t day, uint16_t month, uint16_t year);
+void            model_updater_set_server_firmware_update_state(model_updater_t updater, firmware_update_state_t state);
+int             model_updater_add_alarm(model_updater_t updater, uint16_t day, uint16_t month, uint16_t year);
 void            model_updater_set_alarm_time(model_updater_t updater, size_t alarm_num, unsigned long timestamp);
+void            model_updater_set_alarm_recurrence(model_updater_t updater, size_t alarm_num,
+                                                   alarm_recurrence_t recurrence, uint8_t weekdays);
+void            model_updater_set_alarm_duration(model_updater_t updater, size_t alarm_num, uint16_t minutes);
+void            model_updater_delete_alarm(model_updater_t updater, size_t alarm_num);
+void            model_updater_refresh_today(model_updater_t updater);
+void            model_updater_refresh_night_mode(model_updater_t updater);
+void            model_updater_refresh_world_clock(model_updater_t updater);
+void            model_updater_set_world_clock_city(model_updater_t updater, size_t zone, uint8_t city);
+void            model_updater_refresh_solar_schedule(model_updater_t updater);
+void            model_updater_set_solar_location(model_updater_t updater, int16_t latitude, int16_t longitude);
 void            model_updater_set_alarm_description(model_updater_t updater, size_t alarm_num, const char *description);
-
-SETTER(scanning, run.scanning);
+void            model_updater_begin_alarm_batch(model_updater_t updater);
+int             model_updater_batch_add_alarm(model_updater_t updater, const alarm_record_t *record);
+int             model_updater_batch_replace_alarm(model_updater_t updater, size_t alarm_num,
+                                                  const alarm_record_t *record);
+size_t          model_updater_commit_alarm_batch(model_updater_t updater, const uint16_t **alarms);
+void            model_updater_set_command_log(model_updater_t updater, command_log_t *log);
+void            model_updater_set_journal(model_updater_t updater, command_log_t *journal);
+size_t          model_updater_replay(model_updater_t updater, const command_log_t *log, size_t *diverged);
+
+SETTER(military_time, config.military_time, MODEL_FIELD_MILITARY_TIME);
+SETTER(night_mode, config.night_mode, MODEL_FIELD_NIGHT_MODE);
+SETTER(night_mode_start, config.night_mode_start, MODEL_FIELD_NIGHT_MODE_START);
+SETTER(night_mode_end, config.night_mode_end, MODEL_FIELD_NIGHT_MODE_END);
+SETTER(scanning, run.scanning, MODEL_FIELD_SCANNING);
+SETTER(world_clock, config.world_clock.enabled, MODEL_FIELD_WORLD_CLOCK);
+SETTER(solar_schedule, config.solar_schedule.enabled, MODEL_FIELD_SOLAR_SCHEDULE);
 
 #undef SETTER
 
@@ -0,0 +1,38 @@
+#include <assert.h>
+#include "world_clock.h"
+
+
+/*
+ * Cities that can be picked for the world clock. They are persisted by position, so new ones go at the end
+ */
+static const world_clock_city_t cities[] = {
+    // The first ones are the defaults
+    {"London", "GMT0BST,M3.5.0/1,M10.5.0"},
+    {"New York", "EST5EDT,M3.2.0,M11.1.0"},
+    {"Tokyo", "JST-9"},
+    {"Sydney", "AEST-10AEDT,M10.1.0,M4.1.0/3"},
+    {"UTC", "UTC0"},
+    {"Rome", "CET-1CEST,M3.5.0,M10.5.0/3"},
+    {"Helsinki", "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+    {"Moscow", "MSK-3"},
+    {"Dubai", "<+04>-4"},
+    {"Mumbai", "IST-5:30"},
+    {"Singapore", "<+08>-8"},
+    {"Auckland", "NZST-12NZDT,M9.5.0,M4.1.0/3"},
+    {"Sao Paulo", "<-03>3"},
+    {"Chicago", "CST6CDT,M3.2.0,M11.1.0"},
+    {"Denver", "MST7MDT,M3.2.0,M11.1.0"},
+    {"Los Angeles", "PST8PDT,M3.2.0,M11.1.0"},
+};
+
+
+size_t world_clock_get_city_count(void) {
+    return sizeof(cities) / sizeof(cities[0]);
+}
+
+
+const world_clock_city_t *world_clock_get_city(size_t city) {
+    assert(city < world_clock_get_city_count());
+    return &cities[city];
+}
+
@@ -0,0 +1,18 @@
+#ifndef WORLD_CLOCK_H_INCLUDED
+#define WORLD_CLOCK_H_INCLUDED
+
+
+#include <stdlib.h>
+
+
+typedef struct {
+    const char *name;
+    const char *posix_tz;
+} world_clock_city_t;
+
+
+size_t                    world_clock_get_city_count(void);
+const world_clock_city_t *world_clock_get_city(size_t city);
+
+
+#endif
@@ -7,12 +7,21 @@
 #include "esp_log.h"
 
 #define COMPATIBILITY_KEY     "COMPATIBILITY"
-#define COMPATIBILITY_VERSION 1
+#define COMPATIBILITY_VERSION 3
 
 
 static const char *TAG = "Storage";
 
 
+static esp_err_t open_for_writing(nvs_handle_t *handle);
+static void      close_after_writing(nvs_handle_t handle);
+
+
+// Writes in between begin and commit share this handle and are committed all at once
+static nvs_handle_t transaction_handle = 0;
+static uint8_t      transaction_open   = 0;
+
+
 void storage_init(void) {
     // Initialize NVS
     esp_err_t err = nvs_flash_init();
@@ -70,7 +79,7 @@ void storage_save_uint8(uint8_t *value, char *key) {
     nvs_handle_t handle;
     assert(strlen(key) <= 15);
 
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &handle);
+    esp_err_t err = open_for_writing(&handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error (%i) opening NVS handle!\n", err);
         return;
@@ -79,10 +88,8 @@ void storage_save_uint8(uint8_t *value, char *key) {
     err = nvs_set_u8(handle, key, *value);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "NVS error (%i) while writing %s", err, key);
-    } else {
-        ESP_ERROR_CHECK(nvs_commit(handle));
-        nvs_close(handle);
     }
+    close_after_writing(handle);
 }
 
 
@@ -108,7 +115,7 @@ void storage_save_uint16(uint16_t *value, char *key) {
     ESP_LOGI(TAG, "Trying to save key %s", key);
     assert(strlen(key) <= 15);
 
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &handle);
+    esp_err_t err = open_for_writing(&handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error (%i) opening NVS handle!\n", err);
         return;
@@ -117,10 +124,8 @@ void storage_save_uint16(uint16_t *value, char *key) {
     err = nvs_set_u16(handle, key, *value);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "NVS error (%i) while writing %s", err, key);
-    } else {
-        ESP_ERROR_CHECK(nvs_commit(handle));
-        nvs_close(handle);
     }
+    close_after_writing(handle);
 }
 
 
@@ -146,7 +151,7 @@ void storage_save_uint32(uint32_t *value, char *key) {
     ESP_LOGI(TAG, "Trying to save key %s", key);
     assert(strlen(key) <= 15);
 
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &handle);
+    esp_err_t err = open_for_writing(&handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error (%i) opening NVS handle!\n", err);
         return;
@@ -155,10 +160,8 @@ void storage_save_uint32(uint32_t *value, char *key) {
     err = nvs_set_u32(handle, key, *value);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "NVS error (%i) while writing %s", err, key);
-    } else {
-        ESP_ERROR_CHECK(nvs_commit(handle));
-        nvs_close(handle);
     }
+    close_after_writing(handle);
 }
 
 
@@ -184,7 +187,7 @@ void storage_save_uint64(uint64_t *value, char *key) {
     ESP_LOGI(TAG, "Trying to save key %s", key);
     assert(strlen(key) <= 15);
 
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &handle);
+    esp_err_t err = open_for_writing(&handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error (%i) opening NVS handle!\n", err);
         return;
@@ -193,10 +196,8 @@ void storage_save_uint64(uint64_t *value, char *key) {
     err = nvs_set_u64(handle, key, *value);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "NVS error (%i) while writing %s", err, key);
-    } else {
-        ESP_ERROR_CHECK(nvs_commit(handle));
-        nvs_close(handle);
     }
+    close_after_writing(handle);
 }
 
 
@@ -222,7 +223,7 @@ void storage_save_blob(void *value, size_t len, char *key) {
     ESP_LOGI(TAG, "Trying to save key %s", key);
     assert(strlen(key) <= 15);
 
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &handle);
+    esp_err_t err = open_for_writing(&handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Error (%i) opening NVS handle!\n", err);
         return;
@@ -231,7 +232,41 @@ void storage_save_blob(void *value, size_t len, char *key) {
     err = nvs_set_blob(handle, key, value, len);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "NVS error (%i) while writing %s", err, key);
+    }
+    close_after_writing(handle);
+}
+
+
+/*
+ * Groups the following writes in a single commit
+ */
+void storage_begin_transaction(void) {
+    assert(!transaction_open);
+    ESP_ERROR_CHECK(nvs_open("storage", NVS_READWRITE, &transaction_handle));
+    transaction_open = 1;
+}
+
+
+void storage_commit_transaction(void) {
+    assert(transaction_open);
+    transaction_open = 0;
+    ESP_ERROR_CHECK(nvs_commit(transaction_handle));
+    nvs_close(transaction_handle);
+}
+
+
+static esp_err_t open_for_writing(nvs_handle_t *handle) {
+    if (transaction_open) {
+        *handle = transaction_handle;
+        return ESP_OK;
     } else {
+        return nvs_open("storage", NVS_READWRITE, handle);
+    }
+}
+
+
+static void close_after_writing(nvs_handle_t handle) {
+    if (!transaction_open) {
         ESP_ERROR_CHECK(nvs_commit(handle));
         nvs_close(handle);
     }
@@ -16,5 +16,7 @@ int  storage_load_uint64(uint64_t *value, char *key);
 void storage_save_uint64(uint64_t *value, char *key);
 int  storage_load_blob(void *value, size_t len, char *key);
 void storage_save_blob(void *value, size_t len, char *key);
+void storage_begin_transaction(void);
+void storage_commit_transaction(void);
 
 #endif
\ No newline at end of file
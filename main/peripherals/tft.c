@@ -1,12 +1,15 @@
 #include "sdkconfig.h"
 #include "lvgl_helpers.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include "lvgl_tft/disp_spi.h"
 #include "lvgl_touch/tp_spi.h"
 #include "hardwareprofile.h"
 #include "lvgl_spi_conf.h"
 #include "driver/ledc.h"
+#include "soc/soc_caps.h"
 #include "tft.h"
 #include "lvgl_i2c/i2c_manager.h"
 
@@ -19,6 +22,8 @@
 
 static const char *TAG              = "Tft";
 static void       *backlight_handle = NULL;
+// Duty of the last change, so that the LEDC registers are not read back
+static uint32_t    backlight_duty   = 0;
 static void (*on_touch_cb)(void);
 
 
@@ -27,7 +32,7 @@ void tft_init(void (*touch_cb)(void)) {
 
 
     ledc_timer_config_t ledc_timer = {
-        .duty_resolution = LEDC_TIMER_8_BIT,        // resolution of PWM duty
+        .duty_resolution = TFT_BACKLIGHT_DUTY_BITS, // resolution of PWM duty
         .freq_hz         = 2000,                    // frequency of PWM signal
         .speed_mode      = LEDC_LOW_SPEED_MODE,     // timer mode
         .timer_num       = LEDC_TIMER_0,            // timer index
@@ -128,11 +133,51 @@ void tft_init(void (*touch_cb)(void)) {
 
 
 void tft_backlight_set(uint8_t percentage) {
-    uint16_t duty = (percentage * 255) / 100;
-    if (ledc_get_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0) != duty) {
-        ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, duty);
-        ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+    uint32_t duty = tft_backlight_duty(percentage);
+#if SOC_LEDC_SUPPORT_FADE_STOP
+    // Otherwise a fade in progress would overwrite the duty when it ends
+    ledc_fade_stop(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+#endif
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, duty);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+    backlight_duty = duty;
+}
+
+
+/*
+ * The LEDC hardware steps the duty, so the caller does not wait for the fade to complete. The steps are linear in
+ * duty between the two levels, which are gamma corrected
+ */
+void tft_backlight_fade(uint8_t percentage, uint32_t millis) {
+    uint32_t duty = tft_backlight_duty(percentage);
+    if (duty == backlight_duty) {
+        // Already there or on the way
+        return;
     }
+#if SOC_LEDC_SUPPORT_FADE_STOP
+    // Starting a fade waits for the one in progress to end
+    ledc_fade_stop(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+#endif
+    ledc_set_fade_time_and_start(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, duty, millis, LEDC_FADE_NO_WAIT);
+    backlight_duty = duty;
+}
+
+
+/*
+ * Sleeping stops the panel from scanning its frame memory, which it keeps, and turns off most of the controller
+ */
+void tft_display_sleep(uint8_t sleep) {
+#if defined(CONFIG_LV_TFT_DISPLAY_CONTROLLER_ST7796S)
+    if (sleep) {
+        st7796s_sleep_in();
+    } else {
+        st7796s_sleep_out();
+        // The controller accepts other commands 5 ms after leaving sleep
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+#else
+    (void)sleep;
+#endif
 }
 
 
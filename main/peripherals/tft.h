@@ -6,8 +6,30 @@
 #include <stdint.h>
 
 
+// 13 bits of PWM resolution, so that the dimmest levels still differ after the gamma correction
+#define TFT_BACKLIGHT_DUTY_BITS 13
+#define TFT_BACKLIGHT_DUTY_MAX  ((1UL << TFT_BACKLIGHT_DUTY_BITS) - 1)
+
+
+/*
+ * Maps a brightness percentage to the luminance with the same perceived lightness (CIE 1976 L*), so that equal steps
+ * of the sliders look equal
+ */
+static inline uint32_t tft_backlight_duty(uint8_t percentage) {
+    uint32_t lightness = percentage > 100 ? 100 : percentage;
+    if (lightness <= 8) {
+        return (lightness * TFT_BACKLIGHT_DUTY_MAX * 10) / 9033;
+    } else {
+        uint64_t cube = (uint64_t)(lightness + 16) * (lightness + 16) * (lightness + 16);
+        return (uint32_t)((cube * TFT_BACKLIGHT_DUTY_MAX) / (116ULL * 116ULL * 116ULL));
+    }
+}
+
+
 void tft_init(void (*touch_cb)(void));
 void tft_backlight_set(uint8_t percentage);
+void tft_backlight_fade(uint8_t percentage, uint32_t millis);
+void tft_display_sleep(uint8_t sleep);
 void tft_touch_read_cb(struct _lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
 
 
@@ -0,0 +1,35 @@
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "clock.h"
+
+
+/*
+ * Wall clock, seconds since the epoch
+ */
+time_t clock_now(void) {
+    return time(NULL);
+}
+
+
+int64_t clock_now_millis(void) {
+    struct timeval tv = {0};
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+
+/*
+ * Monotonic milliseconds since boot
+ */
+unsigned long clock_millis(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+
+/*
+ * Converts an interval of clock time in real time, e.g. for the period of an OS timer
+ */
+unsigned long clock_to_real_millis(unsigned long millis) {
+    return millis;
+}
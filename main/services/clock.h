@@ -0,0 +1,25 @@
+#ifndef CLOCK_H_INCLUDED
+#define CLOCK_H_INCLUDED
+
+
+#include <stdint.h>
+#include <time.h>
+
+
+/*
+ * Time sources of the application. The firmware reads the real clocks, while the simulator runs a virtual clock
+ * that can go faster than real time or jump to an instant.
+ */
+time_t        clock_now(void);
+int64_t       clock_now_millis(void);
+unsigned long clock_millis(void);
+unsigned long clock_to_real_millis(unsigned long millis);
+
+#ifdef SIMULATED_APPLICATION
+void     clock_set_speed(uint32_t speed);
+void     clock_jump_to(time_t timestamp);
+uint32_t clock_get_speed(void);
+#endif
+
+
+#endif
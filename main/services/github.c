@@ -22,6 +22,9 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt);
 static void      cleanup(void);
 static uint8_t   extract_release(const char *buffer);
 static esp_err_t ota_client_init_cb(esp_http_client_handle_t client);
+static void      latest_release_event(github_event_t *event, http_request_state_t state, uint16_t major,
+                                      uint16_t minor, uint16_t patch);
+static void      firmware_update_event(github_event_t *event);
 
 
 static const char *URL_GET_LATEST_RELEASE = "https://api.github.com/repos/Maldus512/wt32-sc01-clock/releases/latest";
@@ -37,9 +40,12 @@ static firmware_update_state_t firmware_update_state = {.tag = FIRMWARE_UPDATE_S
 static esp_https_ota_handle_t  update_handle;
 
 
-void github_request_latest_release(mut_model_t *pmodel) {
+/*
+ * Returns 1 if the request started, with the event to report
+ */
+uint8_t github_request_latest_release(github_event_t *event) {
     if (client != NULL) {
-        return;
+        return 0;
     }
 
     ESP_LOGI(TAG, "Requesting latest release from Github");
@@ -60,11 +66,12 @@ void github_request_latest_release(mut_model_t *pmodel) {
     client = esp_http_client_init(&config);
     esp_http_client_set_header(client, "Accept", "application/vnd.github+json");
     esp_http_client_set_header(client, "X-GitHub-Api-Version", "2022-11-28");
-    model_set_latest_release_state(pmodel, HTTP_REQUEST_STATE_WAITING, 0, 0, 0);
+    latest_release_event(event, HTTP_REQUEST_STATE_WAITING, 0, 0, 0);
+    return 1;
 }
 
 
-void github_ota(mut_model_t *pmodel) {
+uint8_t github_ota(github_event_t *event) {
     if (client != NULL) {
         // return;
     }
@@ -95,11 +102,15 @@ void github_ota(mut_model_t *pmodel) {
         firmware_update_state.error        = err;
     }
 
-    pmodel->run.client_firmware_update_state = firmware_update_state;
+    firmware_update_event(event);
+    return 1;
 }
 
 
-uint8_t github_manage(mut_model_t *pmodel) {
+/*
+ * Blocks for a step of the request or of the update in progress. Returns 1 if there is an event to report
+ */
+uint8_t github_manage(github_event_t *event) {
     uint8_t update = 0;
 
     if (client != NULL) {
@@ -115,22 +126,22 @@ uint8_t github_manage(mut_model_t *pmodel) {
                 int minor = 0;
                 int patch = 0;
                 if (sscanf(name, "v%i.%i.%i", &major, &minor, &patch) == 3) {
-                    model_set_latest_release_state(pmodel, HTTP_REQUEST_STATE_DONE, major, minor, patch);
+                    latest_release_event(event, HTTP_REQUEST_STATE_DONE, major, minor, patch);
                 } else if (sscanf(name, "%i.%i.%i", &major, &minor, &patch) == 3) {
-                    model_set_latest_release_state(pmodel, HTTP_REQUEST_STATE_DONE, major, minor, patch);
+                    latest_release_event(event, HTTP_REQUEST_STATE_DONE, major, minor, patch);
                 } else {
-                    model_set_latest_release_state(pmodel, HTTP_REQUEST_STATE_ERROR, 0, 0, 0);
+                    latest_release_event(event, HTTP_REQUEST_STATE_ERROR, 0, 0, 0);
                 }
             } else {
                 cleanup();
-                model_set_latest_release_state(pmodel, HTTP_REQUEST_STATE_ERROR, 0, 0, 0);
+                latest_release_event(event, HTTP_REQUEST_STATE_ERROR, 0, 0, 0);
             }
             update = 1;
         }
         // Failure
         else if (err == ESP_FAIL) {
             ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
-            model_set_latest_release_state(pmodel, HTTP_REQUEST_STATE_ERROR, 0, 0, 0);
+            latest_release_event(event, HTTP_REQUEST_STATE_ERROR, 0, 0, 0);
             cleanup();
             update = 1;
         }
@@ -178,14 +189,38 @@ uint8_t github_manage(mut_model_t *pmodel) {
                 firmware_update_state.error        = err;
                 break;
         }
-        pmodel->run.client_firmware_update_state = firmware_update_state;
-        update                                   = 1;
+        firmware_update_event(event);
+        update = 1;
     }
 
     return update;
 }
 
 
+/*
+ * Whether a request or an update is in progress, so that github_manage must be called again soon
+ */
+uint8_t github_is_busy(void) {
+    return client != NULL || firmware_update_state.tag == FIRMWARE_UPDATE_STATE_TAG_UPDATING;
+}
+
+
+static void latest_release_event(github_event_t *event, http_request_state_t state, uint16_t major,
+                                 uint16_t minor, uint16_t patch) {
+    event->tag                     = GITHUB_EVENT_TAG_LATEST_RELEASE;
+    event->as.latest_release.state = state;
+    event->as.latest_release.major = major;
+    event->as.latest_release.minor = minor;
+    event->as.latest_release.patch = patch;
+}
+
+
+static void firmware_update_event(github_event_t *event) {
+    event->tag                = GITHUB_EVENT_TAG_FIRMWARE_UPDATE;
+    event->as.firmware_update = firmware_update_state;
+}
+
+
 static esp_err_t ota_client_init_cb(esp_http_client_handle_t client) {
     esp_http_client_set_header(client, "Accept", "application/octet-stream");
     esp_http_client_set_header(client, "X-GitHub-Api-Version", "2022-11-28");
@@ -5,9 +5,31 @@
 #include "model/model.h"
 
 
-void    github_request_latest_release(mut_model_t *pmodel);
-uint8_t github_manage(mut_model_t *pmodel);
-void    github_ota(mut_model_t *pmodel);
+typedef enum {
+    GITHUB_EVENT_TAG_LATEST_RELEASE = 0,
+    GITHUB_EVENT_TAG_FIRMWARE_UPDATE,
+} github_event_tag_t;
+
+
+// Progress of the service, applied to the model by the controller
+typedef struct {
+    github_event_tag_t tag;
+    union {
+        struct {
+            http_request_state_t state;
+            uint16_t             major;
+            uint16_t             minor;
+            uint16_t             patch;
+        } latest_release;
+        firmware_update_state_t firmware_update;
+    } as;
+} github_event_t;
+
+
+uint8_t github_request_latest_release(github_event_t *event);
+uint8_t github_manage(github_event_t *event);
+uint8_t github_is_busy(void);
+uint8_t github_ota(github_event_t *event);
 
 
 #endif
@@ -12,6 +12,7 @@
 #include "network.h"
 #include "server.h"
 #include "model/updater.h"
+#include "controller/wakeup.h"
 #include "esp_sntp.h"
 
 
@@ -292,6 +293,9 @@ static void network_event_handler(void *arg, esp_event_base_t event_base, long i
                 break;
         }
     }
+
+    // The controller reads the new state (and scan results) in its next iteration
+    wakeup_notify();
 }
 
 
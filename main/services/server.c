@@ -7,10 +7,17 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include "model/updater.h"
+#include "controller/snapshot.h"
+#include "controller/wakeup.h"
 #include "config/app_config.h"
 
 
+// Largest body accepted by PUT /alarms, about 300 alarms with long descriptions
+#define MAX_ALARM_IMPORT_SIZE (32 * 1024)
+
+
 static esp_err_t firmware_update_put_handler(httpd_req_t *req);
+static esp_err_t alarms_put_handler(httpd_req_t *req);
 static void      set_firmware_update_state(firmware_update_state_tag_t state);
 static void      firmware_update_failed(httpd_req_t *req, firmware_update_failure_code_t code, esp_err_t error);
 static esp_err_t home_get_handler(httpd_req_t *req);
@@ -20,6 +27,9 @@ static const char             *TAG                   = "Server";
 static httpd_handle_t          server                = NULL;
 static SemaphoreHandle_t       sem                   = NULL;
 static firmware_update_state_t firmware_update_state = {.tag = FIRMWARE_UPDATE_STATE_TAG_NONE};
+// Received by the server task and taken by the main loop, under `sem`
+static alarm_import_t          pending_import        = {0};
+static uint8_t                 import_pending        = 0;
 
 
 void server_init(void) {
@@ -36,6 +46,21 @@ firmware_update_state_t server_firmware_update_state(void) {
 }
 
 
+/*
+ * Hands the alarms received with PUT /alarms over to the main loop, which releases them after the import
+ */
+uint8_t server_take_alarm_import(alarm_import_t *import) {
+    xSemaphoreTake(sem, portMAX_DELAY);
+    uint8_t taken = import_pending;
+    if (taken) {
+        *import        = pending_import;
+        import_pending = 0;
+    }
+    xSemaphoreGive(sem);
+    return taken;
+}
+
+
 void *server_start(void) {
     if (server != NULL) {
         return server;
@@ -43,9 +68,10 @@ void *server_start(void) {
 
     httpd_config_t config   = HTTPD_DEFAULT_CONFIG();
     config.task_priority    = 1;
+    config.core_id          = APP_CONFIG_NETWORK_CORE;
     config.stack_size       = APP_CONFIG_TASK_SIZE * 10;
     config.lru_purge_enable = true;
-    config.max_uri_handlers = 2;
+    config.max_uri_handlers = 3;
     config.max_open_sockets = CONFIG_LWIP_MAX_SOCKETS - 3;
 
     /* Start the httpd server */
@@ -67,6 +93,14 @@ void *server_start(void) {
         };
         httpd_register_uri_handler(server, &system_firmware_update);
 
+        // PUT /alarms
+        const httpd_uri_t alarms = {
+            .uri     = (const char *)"/alarms",
+            .method  = HTTP_PUT,
+            .handler = alarms_put_handler,
+        };
+        httpd_register_uri_handler(server, &alarms);
+
         return server;
     } else {
         ESP_LOGW(TAG, "Error starting server (0x%03X)!", res);
@@ -97,6 +131,15 @@ static esp_err_t firmware_update_put_handler(httpd_req_t *req) {
     esp_err_t              err = ESP_OK;
     int                    ret;
 
+    // Runs in the server task; the snapshot is read without locking against the UI loop
+    model_snapshot_t snapshot = {0};
+    snapshot_read(&snapshot);
+    if (snapshot.client_firmware_update_state.tag == FIRMWARE_UPDATE_STATE_TAG_UPDATING) {
+        ESP_LOGW(TAG, "Refusing the upload, an update is already in progress");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "{\"desc\":\"Update already in progress\"}");
+        return ESP_FAIL;
+    }
+
     set_firmware_update_state(FIRMWARE_UPDATE_STATE_TAG_UPDATING);
     vTaskDelay(pdMS_TO_TICKS(1200));     // Allow time for the application to display the update page
 
@@ -180,6 +223,67 @@ static esp_err_t firmware_update_put_handler(httpd_req_t *req) {
 }
 
 
+/*
+ * A JSON array of alarms (see alarm_import_parse), added by the main loop in a single batch.
+ * The reply only says how many were accepted for the import; invalid ones are skipped then
+ */
+static esp_err_t alarms_put_handler(httpd_req_t *req) {
+    if (req->content_len == 0 || req->content_len > MAX_ALARM_IMPORT_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "{\"desc\":\"Invalid size\"}");
+        return ESP_FAIL;
+    }
+
+    char *body = malloc(req->content_len);
+    if (body == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    size_t total = 0;
+    while (total < req->content_len) {
+        int ret = httpd_req_recv(req, &body[total], req->content_len - total);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        } else if (ret <= 0) {
+            ESP_LOGW(TAG, "Error while receiving the alarms: %i", ret);
+            free(body);
+            return ESP_FAIL;
+        }
+        total += ret;
+    }
+
+    alarm_import_t import = {0};
+    int            res    = alarm_import_parse(&import, body, total);
+    free(body);
+    if (res) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "{\"desc\":\"Invalid alarms\"}");
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(sem, portMAX_DELAY);
+    uint8_t busy = import_pending;
+    if (!busy) {
+        pending_import = import;
+        import_pending = 1;
+    }
+    xSemaphoreGive(sem);
+
+    if (busy) {
+        alarm_import_release(&import);
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_send(req, "{\"desc\":\"Import in progress\"}", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+
+    wakeup_notify();
+    char string[32] = {0};
+    snprintf(string, sizeof(string), "{\"alarms\":%zu}", import.count);
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_send(req, string, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+
 static esp_err_t home_get_handler(httpd_req_t *req) {
     extern const unsigned char index_html_start[] asm("_binary_index_html_start");
     extern const unsigned char index_html_end[] asm("_binary_index_html_end");
@@ -198,6 +302,7 @@ static void set_firmware_update_state(firmware_update_state_tag_t state) {
     xSemaphoreTake(sem, portMAX_DELAY);
     firmware_update_state.tag = state;
     xSemaphoreGive(sem);
+    wakeup_notify();
 }
 
 
@@ -207,6 +312,7 @@ static void firmware_update_failed(httpd_req_t *req, firmware_update_failure_cod
     firmware_update_state.failure_code = code;
     firmware_update_state.error        = (int32_t)error;
     xSemaphoreGive(sem);
+    wakeup_notify();
 
     char string[90] = {0};
     snprintf(string, sizeof(string), "{\"desc\":\"OTA error\",\"error\":3,\"step\":%i,\"code\":%i}", code, error);
@@ -3,12 +3,14 @@
 
 
 #include "model/model.h"
+#include "controller/alarm_import.h"
 
 
 void                    server_init(void);
 void                    server_stop(void);
 void                   *server_start(void);
 firmware_update_state_t server_firmware_update_state(void);
+uint8_t                 server_take_alarm_import(alarm_import_t *import);
 
 
 #endif
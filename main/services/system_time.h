@@ -5,6 +5,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "clock.h"
 
 
 typedef unsigned long timestamp_t;
@@ -17,7 +18,7 @@ typedef unsigned long timestamp_t;
 #define is_expired(start, current, delay) is_loosely_expired(start, current, delay)
 
 
-#define get_millis() (xTaskGetTickCount() * portTICK_PERIOD_MS)
+#define get_millis() clock_millis()
 
 
 static inline __attribute__((always_inline)) timestamp_t time_interval(timestamp_t a, timestamp_t b) {
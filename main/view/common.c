@@ -9,11 +9,3 @@ void view_common_set_hidden(lv_obj_t *obj, int hidden) {
         lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
     }
 }
-
-
-view_controller_msg_t *view_controller_msg(view_controller_msg_t msg) {
-    view_controller_msg_t *alloc_msg = lv_mem_alloc(sizeof(view_controller_msg_t));
-    assert(alloc_msg != NULL);
-    memcpy(alloc_msg, &msg, sizeof(view_controller_msg_t));
-    return alloc_msg;
-}
@@ -0,0 +1,48 @@
+#include <assert.h>
+#include "controller_msg.h"
+
+
+// The controller handles a message before the event that sent it returns, so only one is usually in flight
+#define MAX_CONTROLLER_MESSAGES 4
+
+
+static view_controller_msg_t       controller_messages[MAX_CONTROLLER_MESSAGES];
+// Bitmap of the slots taken
+static uint32_t                    controller_messages_in_use = 0;
+static view_controller_msg_stats_t controller_messages_stats  = {0};
+
+
+/*
+ * Takes a slot out of a static pool, to be given back with view_controller_msg_release. Returns NULL when the pool is
+ * exhausted, which the controller ignores
+ */
+view_controller_msg_t *view_controller_msg(view_controller_msg_t msg) {
+    uint32_t free_slots = ~controller_messages_in_use & ((1U << MAX_CONTROLLER_MESSAGES) - 1);
+    if (free_slots == 0) {
+        controller_messages_stats.exhausted++;
+        return NULL;
+    }
+
+    size_t index = __builtin_ctz(free_slots);
+    controller_messages_in_use |= 1U << index;
+
+    size_t in_flight = __builtin_popcount(controller_messages_in_use);
+    if (in_flight > controller_messages_stats.high_water) {
+        controller_messages_stats.high_water = in_flight;
+    }
+
+    controller_messages[index] = msg;
+    return &controller_messages[index];
+}
+
+
+void view_controller_msg_release(view_controller_msg_t *msg) {
+    size_t index = msg - controller_messages;
+    assert(index < MAX_CONTROLLER_MESSAGES);
+    controller_messages_in_use &= ~(1U << index);
+}
+
+
+view_controller_msg_stats_t view_controller_msg_get_stats(void) {
+    return controller_messages_stats;
+}
@@ -0,0 +1,40 @@
+#ifndef CONTROLLER_MSG_H_INCLUDED
+#define CONTROLLER_MSG_H_INCLUDED
+
+
+#include "model/model.h"
+
+
+typedef enum {
+    VIEW_CONTROLLER_MESSAGE_TAG_SCAN_AP,
+    VIEW_CONTROLLER_MESSAGE_TAG_CONNECT_TO,
+    VIEW_CONTROLLER_MESSAGE_TAG_SAVE_ALARM,
+    VIEW_CONTROLLER_MESSAGE_TAG_RESET,
+    VIEW_CONTROLLER_MESSAGE_TAG_OTA,
+} view_controller_msg_tag_t;
+
+typedef struct {
+    view_controller_msg_tag_t tag;
+    union {
+        struct {
+            char ssid[MAX_SSID_SIZE];
+            char psk[MAX_SSID_SIZE];
+        } connect_to;
+        struct {
+            size_t num;
+        } save_alarm;
+    } as;
+} view_controller_msg_t;
+
+typedef struct {
+    size_t   high_water;     // Most messages in flight at once
+    uint32_t exhausted;      // Messages dropped because all the slots were in use
+} view_controller_msg_stats_t;
+
+
+view_controller_msg_t      *view_controller_msg(view_controller_msg_t msg);
+void                        view_controller_msg_release(view_controller_msg_t *msg);
+view_controller_msg_stats_t view_controller_msg_get_stats(void);
+
+
+#endif
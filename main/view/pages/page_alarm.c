@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "model/updater.h"
+#include "model/civil_time.h"
 #include "view/view.h"
 #include "view/common.h"
 #include "view/theme/style.h"
@@ -19,16 +20,27 @@ enum {
     ROLLER_HOUR_ID,
     ROLLER_MINUTE_ID,
     BTN_DELETE_ID,
+    DROPDOWN_RECURRENCE_ID,
+    DROPDOWN_DURATION_ID,
 };
 
 
+// Minutes for each option of the duration dropdown
+static const uint16_t durations[] = {0, 15, 30, 60, 120, 24 * 60};
+
+
 struct page_data {
     lv_obj_t *textarea;
     lv_obj_t *keyboard;
     lv_obj_t *roller_hour;
     lv_obj_t *roller_minute;
+    lv_obj_t *dropdown_recurrence;
+    lv_obj_t *dropdown_duration;
 
     size_t alarm_num;
+    // Option shown when the page opened; durations that are not among the options (e.g. imported) are kept unless
+    // another one is picked
+    uint16_t initial_duration;
 };
 
 
@@ -58,7 +70,7 @@ static void open_page(pman_handle_t handle, void *state) {
 
     alarm_t   alarm      = model_get_alarm(pmodel, pdata->alarm_num);
     time_t    alarm_time = alarm.timestamp;
-    struct tm alarm_tm   = *localtime(&alarm_time);
+    struct tm alarm_tm   = civil_time_localtime(alarm_time);
 
     lv_obj_t *btn = lv_btn_create(lv_scr_act());
     lv_obj_set_size(btn, 56, 56);
@@ -72,7 +84,7 @@ static void open_page(pman_handle_t handle, void *state) {
     lv_obj_t *ta = lv_textarea_create(lv_scr_act());
     lv_obj_set_style_text_font(ta, STYLE_FONT_TINY, LV_STATE_DEFAULT);
     lv_textarea_set_one_line(ta, 0);
-    lv_textarea_set_text(ta, alarm.description);
+    lv_textarea_set_text(ta, model_get_alarm_description(pmodel, pdata->alarm_num));
     lv_textarea_set_max_length(ta, 33);
     lv_obj_set_size(ta, LV_HOR_RES - 80, 64);
     lv_obj_align(ta, LV_ALIGN_TOP_RIGHT, -8, 4);
@@ -106,6 +118,31 @@ static void open_page(pman_handle_t handle, void *state) {
     view_register_object_default_callback(roller_minute, ROLLER_MINUTE_ID);
     pdata->roller_minute = roller_minute;
 
+    lv_obj_t *dropdown = lv_dropdown_create(lv_scr_act());
+    lv_obj_set_style_text_font(dropdown, STYLE_FONT_TINY, LV_STATE_DEFAULT);
+    lv_dropdown_set_options(dropdown, "Once\nDaily\nWeekdays\nWeekly\nMonthly");
+    lv_dropdown_set_selected(dropdown, alarm.recurrence);
+    lv_obj_set_width(dropdown, 112);
+    lv_obj_align(dropdown, LV_ALIGN_LEFT_MID, 8, 32);
+    view_register_object_default_callback(dropdown, DROPDOWN_RECURRENCE_ID);
+    pdata->dropdown_recurrence = dropdown;
+
+    pdata->initial_duration = 0;
+    for (size_t i = 0; i < sizeof(durations) / sizeof(durations[0]); i++) {
+        if (durations[i] == alarm.duration) {
+            pdata->initial_duration = i;
+        }
+    }
+
+    dropdown = lv_dropdown_create(lv_scr_act());
+    lv_obj_set_style_text_font(dropdown, STYLE_FONT_TINY, LV_STATE_DEFAULT);
+    lv_dropdown_set_options(dropdown, "No duration\n15 minutes\n30 minutes\n1 hour\n2 hours\nAll day");
+    lv_dropdown_set_selected(dropdown, pdata->initial_duration);
+    lv_obj_set_width(dropdown, 112);
+    lv_obj_align(dropdown, LV_ALIGN_LEFT_MID, 8, 96);
+    view_register_object_default_callback(dropdown, DROPDOWN_DURATION_ID);
+    pdata->dropdown_duration = dropdown;
+
     btn = lv_btn_create(lv_scr_act());
     lv_obj_set_style_bg_color(btn, STYLE_RED, LV_STATE_DEFAULT);
     lv_obj_set_size(btn, 64, 64);
@@ -178,10 +215,20 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                                 lv_textarea_get_text(pdata->textarea));     // invalidate the alarm
 
                             time_t    alarm_time = model_get_alarm(pmodel, pdata->alarm_num).timestamp;
-                            struct tm alarm_tm   = *localtime(&alarm_time);
+                            struct tm alarm_tm   = civil_time_localtime(alarm_time);
                             alarm_tm.tm_hour     = lv_roller_get_selected(pdata->roller_hour);
                             alarm_tm.tm_min      = lv_roller_get_selected(pdata->roller_minute) * 5;
-                            model_updater_set_alarm_time(updater, pdata->alarm_num, mktime(&alarm_tm));
+                            model_updater_set_alarm_time(updater, pdata->alarm_num, civil_time_mktime(&alarm_tm));
+
+                            // Weekly alarms repeat on the weekday they were created for
+                            model_updater_set_alarm_recurrence(updater, pdata->alarm_num,
+                                                               lv_dropdown_get_selected(pdata->dropdown_recurrence),
+                                                               1 << alarm_tm.tm_wday);
+
+                            uint16_t duration = lv_dropdown_get_selected(pdata->dropdown_duration);
+                            if (duration != pdata->initial_duration) {
+                                model_updater_set_alarm_duration(updater, pdata->alarm_num, durations[duration]);
+                            }
 
                             msg.user_msg = view_controller_msg(
                                 (view_controller_msg_t){.tag = VIEW_CONTROLLER_MESSAGE_TAG_SAVE_ALARM,
@@ -190,7 +237,7 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                             break;
                         }
                         case BTN_DELETE_ID:
-                            model_updater_set_alarm_time(updater, pdata->alarm_num, 0);     // invalidate the alarm
+                            model_updater_delete_alarm(updater, pdata->alarm_num);
                             msg.user_msg = view_controller_msg(
                                 (view_controller_msg_t){.tag = VIEW_CONTROLLER_MESSAGE_TAG_SAVE_ALARM,
                                                         .as  = {.save_alarm = {.num = pdata->alarm_num}}});
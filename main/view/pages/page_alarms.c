@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "model/updater.h"
+#include "model/civil_time.h"
 #include "view/view.h"
 #include "view/common.h"
 #include "view/theme/style.h"
@@ -95,9 +96,12 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                             msg.stack_msg = PMAN_STACK_MSG_BACK();
                             break;
                         case BTN_CREATE_ID: {
-                            size_t alarm_num = model_updater_add_alarm(
-                                updater, pdata->date->day, pdata->date->month - 1, pdata->date->year - 1900);
-                            msg.stack_msg = PMAN_STACK_MSG_PUSH_PAGE_EXTRA(&page_alarm, (void *)(uintptr_t)alarm_num);
+                            int alarm_num = model_updater_add_alarm(updater, pdata->date->day, pdata->date->month - 1,
+                                                                    pdata->date->year - 1900);
+                            if (alarm_num >= 0) {
+                                msg.stack_msg =
+                                    PMAN_STACK_MSG_PUSH_PAGE_EXTRA(&page_alarm, (void *)(uintptr_t)alarm_num);
+                            }
                             break;
                         }
                         case BTN_MODIFY_ID: {
@@ -145,26 +149,32 @@ static void destroy_page(void *state, void *extra) {
 static void update_list(model_t *pmodel, struct page_data *pdata) {
     lv_obj_clean(pdata->list);
 
-    uint8_t found = 0;
-    size_t  count = 0;
-    do {
-        size_t alarm_num = 0;
-        found = model_get_nth_alarm_for_day(pmodel, &alarm_num, count, pdata->date->day, pdata->date->month - 1,
-                                            pdata->date->year - 1900);
-        if (found) {
-            count++;
-            char      string[MAX_DESCRIPTION_LEN + 32] = {0};
-            time_t    timestamp                        = model_get_alarm(pmodel, alarm_num).timestamp;
-            struct tm time_tm                          = *localtime(&timestamp);
-            snprintf(string, sizeof(string), "[%02i:%02i] %s", time_tm.tm_hour, time_tm.tm_min,
-                     model_get_alarm(pmodel, alarm_num).description);
-            lv_obj_t *btn = lv_list_add_btn(pdata->list, NULL, string);
-            lv_label_set_long_mode(lv_obj_get_child(btn, 0), LV_LABEL_LONG_DOT);
-            view_register_object_default_callback_with_number(btn, BTN_MODIFY_ID, alarm_num);
-        }
-    } while (found);
+    size_t  max    = pmodel->config.num_alarms + pmodel->run.num_recurring;
+    size_t *alarms = malloc(max * sizeof(size_t));
+    size_t  count  = 0;
+    if (alarms != NULL) {
+        count = model_get_day_alarms(pmodel, pdata->date->day, pdata->date->month - 1, pdata->date->year - 1900,
+                                     alarms, max);
+    } else {
+        ESP_LOGW(TAG, "Not enough memory to list the alarms of the day");
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t    alarm_num                        = alarms[i];
+        char      string[MAX_DESCRIPTION_LEN + 32] = {0};
+        alarm_t   alarm                            = model_get_alarm(pmodel, alarm_num);
+        struct tm time_tm                          = civil_time_localtime(alarm.timestamp);
+        snprintf(string, sizeof(string), "[%02i:%02i] %s", time_tm.tm_hour, time_tm.tm_min,
+                 model_get_alarm_description(pmodel, alarm_num));
+        lv_obj_t *btn =
+            lv_list_add_btn(pdata->list, alarm.recurrence != ALARM_RECURRENCE_NONE ? LV_SYMBOL_LOOP : NULL, string);
+        // The label is the last child, after the optional icon
+        lv_label_set_long_mode(lv_obj_get_child(btn, -1), LV_LABEL_LONG_DOT);
+        view_register_object_default_callback_with_number(btn, BTN_MODIFY_ID, alarm_num);
+    }
+    free(alarms);
 
-    if (model_get_active_alarms(pmodel) < MAX_ALARMS) {
+    if (!model_is_alarm_store_full(pmodel)) {
         lv_obj_t *btn = lv_list_add_btn(pdata->list, LV_SYMBOL_PLUS, "New event");
         view_register_object_default_callback(btn, BTN_CREATE_ID);
     }
@@ -3,21 +3,27 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "model/updater.h"
+#include "model/civil_time.h"
+#include "model/world_clock.h"
 #include "view/view.h"
 #include "view/common.h"
 #include "view/theme/style.h"
 #include "src/extra/libs/qrcode/lv_qrcode.h"
 #include "config/app_config.h"
+#include "services/clock.h"
 #include <esp_log.h>
 
 
 LV_IMG_DECLARE(img_bell);
 
 
-#define FLAG_WIDTH       64
-#define FLAG_HEIGHT      64
-#define FLAG_LEFT_LIMIT  -36
-#define FLAG_RIGHT_LIMIT 444
+#define FLAG_WIDTH           64
+#define FLAG_HEIGHT          64
+#define FLAG_LEFT_LIMIT      -36
+#define FLAG_RIGHT_LIMIT     444
+#define MAX_HIGHLIGHTED_DAYS 31
+#define MAX_BANNER_ITEMS     4
+#define WORLD_CLOCK_WIDTH    104
 
 
 enum {
@@ -33,13 +39,19 @@ enum {
     BTN_UPDATE_ID,
     CB_MILITARY_TIME_ID,
     CB_NIGHT_MODE_ID,
+    CB_WORLD_CLOCK_ID,
+    CB_SOLAR_SCHEDULE_ID,
+    DROPDOWN_WORLD_CLOCK_ID,
     SLIDER_NORMAL_BRIGHTNESS_ID,
     SLIDER_STANDBY_BRIGHTNESS_ID,
     SLIDER_STANDBY_DELAY_ID,
+    SLIDER_LATITUDE_ID,
+    SLIDER_LONGITUDE_ID,
     CALENDAR_ID,
     CALENDAR_HEADER_ID,
     WATCHER_WIFI_ID,
     WATCHER_UPDATE_ID,
+    WATCHER_ALARMS_ID,
     TAB_ID,
 };
 
@@ -53,7 +65,8 @@ typedef enum {
 typedef enum {
     PARAMETER_PAGE_BRIGHTNESS = 0,
     PARAMETER_PAGE_NIGHT_MODE,
-#define PARAMETER_PAGE_NUM 2
+    PARAMETER_PAGE_WORLD_CLOCK,
+#define PARAMETER_PAGE_NUM 3
 } parameter_page_t;
 
 
@@ -69,6 +82,13 @@ struct page_data {
     lv_obj_t *btn_bell;
     lv_obj_t *btn_flag;
 
+    // Shown in place of the date; a label is redrawn only when its minute or its city changes
+    struct {
+        lv_obj_t   *lbl_zones[WORLD_CLOCK_ZONES];
+        int32_t     minutes[WORLD_CLOCK_ZONES];
+        const char *names[WORLD_CLOCK_ZONES];
+    } world_clock;
+
     lv_obj_t *obj_menu;
 
     struct {
@@ -83,6 +103,12 @@ struct page_data {
         lv_obj_t *btn_today;
 
         lv_calendar_date_t showed_date;
+
+        // Highlights of the month on display, recomputed only when the month or the alarms change
+        lv_calendar_date_t highlighted_days[MAX_HIGHLIGHTED_DAYS];
+        uint16_t           highlighted_month;
+        uint16_t           highlighted_year;
+        uint32_t           highlighted_generation;
     } alarms;
 
     struct {
@@ -98,6 +124,13 @@ struct page_data {
         lv_obj_t *slider_standby_brightness;
         lv_obj_t *slider_standby_delay;
         lv_obj_t *btn_night_mode;
+        lv_obj_t *cb_solar_schedule;
+        lv_obj_t *lbl_latitude;
+        lv_obj_t *lbl_longitude;
+        lv_obj_t *slider_latitude;
+        lv_obj_t *slider_longitude;
+        lv_obj_t *cb_world_clock;
+        lv_obj_t *dropdown_cities[WORLD_CLOCK_ZONES];
 
         parameter_page_t page;
     } settings;
@@ -108,7 +141,15 @@ struct page_data {
     } info;
 
     size_t tab;
-    size_t nth_alarm_today;
+
+    // Events in progress followed by the next one, shown in turn by the banner
+    struct {
+        size_t   alarms[MAX_BANNER_ITEMS];
+        size_t   count;
+        size_t   in_progress;
+        size_t   nth;
+        uint64_t next_occurrence;
+    } banner;
 
     pman_timer_t *timer_time;
     pman_timer_t *timer_alarms;
@@ -124,8 +165,13 @@ static void update_settings(model_t *pmodel, struct page_data *pdata);
 static void update_wifi_state(model_t *pmodel, struct page_data *pdata);
 static void btns_value_changed_event_cb(lv_event_t *e);
 static void update_alarms(model_t *pmodel, struct page_data *pdata, uint8_t next);
+static void update_highlighted_days(model_t *pmodel, struct page_data *pdata);
+static void show_alarm(model_t *pmodel, struct page_data *pdata, size_t alarm_num);
+static void set_banner_text(model_t *pmodel, struct page_data *pdata, size_t nth);
 static void create_parameter_page(model_t *pmodel, struct page_data *pdata);
 static void update_info(model_t *pmodel, struct page_data *pdata);
+static void update_world_clock(model_t *pmodel, struct page_data *pdata, time_t now);
+static void reset_world_clock(struct page_data *pdata);
 
 
 static const char *TAG = "PageMain";
@@ -142,13 +188,14 @@ static void *create_page(pman_handle_t handle, void *extra) {
     pdata->timer_alarms    = PMAN_REGISTER_TIMER_ID(handle, 10000UL, TIMER_ALARMS_ID);
     pdata->menu_state      = MENU_STATE_CLOSED;
     pdata->tab             = 0;
-    pdata->nth_alarm_today = 0;
+    pdata->banner.count    = 0;
+    pdata->banner.nth      = 0;
 
-    time_t     now                  = time(NULL);
-    struct tm *tm_struct            = localtime(&now);
-    pdata->alarms.showed_date.day   = tm_struct->tm_mday;
-    pdata->alarms.showed_date.month = tm_struct->tm_mon + 1;
-    pdata->alarms.showed_date.year  = tm_struct->tm_year + 1900;
+    time_t    now                  = clock_now();
+    struct tm tm_struct            = civil_time_localtime(now);
+    pdata->alarms.showed_date.day   = tm_struct.tm_mday;
+    pdata->alarms.showed_date.month = tm_struct.tm_mon + 1;
+    pdata->alarms.showed_date.year  = tm_struct.tm_year + 1900;
 
     pdata->settings.page = PARAMETER_PAGE_BRIGHTNESS;
 
@@ -163,12 +210,10 @@ static void open_page(pman_handle_t handle, void *state) {
     model_updater_t   updater = pman_get_user_data(handle);
     model_t          *pmodel  = model_updater_read(updater);
 
-    VIEW_ADD_WATCHED_VARIABLE(&pmodel->run.scanning, WATCHER_WIFI_ID);
-    VIEW_ADD_WATCHED_VARIABLE(&pmodel->run.wifi_state, WATCHER_WIFI_ID);
-    VIEW_ADD_WATCHED_VARIABLE(&pmodel->run.latest_release_request_state, WATCHER_UPDATE_ID);
-    VIEW_ADD_WATCHED_VARIABLE(&pmodel->run.latest_release_major, WATCHER_UPDATE_ID);
-    VIEW_ADD_WATCHED_VARIABLE(&pmodel->run.latest_release_minor, WATCHER_UPDATE_ID);
-    VIEW_ADD_WATCHED_VARIABLE(&pmodel->run.latest_release_patch, WATCHER_UPDATE_ID);
+    view_add_watched_field(MODEL_FIELD_SCANNING, WATCHER_WIFI_ID);
+    view_add_watched_field(MODEL_FIELD_WIFI_STATE, WATCHER_WIFI_ID);
+    view_add_watched_field(MODEL_FIELD_LATEST_RELEASE, WATCHER_UPDATE_ID);
+    view_add_watched_field(MODEL_FIELD_ALARMS, WATCHER_ALARMS_ID);
 
     pman_timer_resume(pdata->timer_time);
     pman_timer_resume(pdata->timer_alarms);
@@ -235,6 +280,19 @@ static void open_page(pman_handle_t handle, void *state) {
     lv_obj_set_style_text_color(lbl, STYLE_MAIN_COLOR, LV_STATE_DEFAULT);
     pdata->lbl_ampm = lbl;
 
+    for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+        lbl = lv_label_create(obj_screen);
+        lv_obj_set_style_text_font(lbl, STYLE_FONT_TINY, LV_STATE_DEFAULT);
+        lv_obj_set_style_text_color(lbl, STYLE_MAIN_COLOR, LV_STATE_DEFAULT);
+        lv_obj_set_style_text_align(lbl, LV_TEXT_ALIGN_CENTER, LV_STATE_DEFAULT);
+        lv_label_set_long_mode(lbl, LV_LABEL_LONG_DOT);
+        lv_obj_set_width(lbl, WORLD_CLOCK_WIDTH);
+        lv_obj_align(lbl, LV_ALIGN_BOTTOM_LEFT, 16 + i * WORLD_CLOCK_WIDTH, -12);
+        pdata->world_clock.lbl_zones[i] = lbl;
+    }
+    // The labels are new and empty
+    reset_world_clock(pdata);
+
     lv_obj_t *btn_flag = lv_btn_create(obj_screen);
     lv_obj_clear_flag(btn_flag, LV_OBJ_FLAG_SCROLLABLE);
     lv_obj_set_size(btn_flag, FLAG_WIDTH, FLAG_HEIGHT);
@@ -287,27 +345,6 @@ static void open_page(pman_handle_t handle, void *state) {
     lv_obj_set_style_text_font(calendar, STYLE_FONT_SMALL, LV_PART_MAIN | LV_STATE_DEFAULT);
     lv_obj_set_style_border_width(calendar, 0, LV_STATE_DEFAULT);
 
-    /*Highlight a few days*/
-    static lv_calendar_date_t highlighted_days[MAX_ALARMS];
-
-    uint8_t found = 0;
-    size_t  count = 0;
-    do {
-        size_t alarm_num = 0;
-        found            = model_get_nth_alarm(pmodel, &alarm_num, count);
-        if (found) {
-            time_t    timestamp           = model_get_alarm(pmodel, alarm_num).timestamp;
-            struct tm alarm_tm            = *localtime(&timestamp);
-            highlighted_days[count].year  = alarm_tm.tm_year + 1900;
-            highlighted_days[count].month = alarm_tm.tm_mon + 1;
-            highlighted_days[count].day   = alarm_tm.tm_mday;
-            count++;
-        }
-    } while (found);
-
-
-    lv_calendar_set_highlighted_dates(calendar, highlighted_days, count);
-
     lv_obj_t *calendar_header = lv_calendar_header_arrow_create(calendar);
     view_register_object_default_callback(calendar_header, CALENDAR_HEADER_ID);
     view_register_object_default_callback(calendar, CALENDAR_ID);
@@ -318,6 +355,9 @@ static void open_page(pman_handle_t handle, void *state) {
 
     pdata->alarms.calendar = calendar;
 
+    // The calendar is new, so it has no highlights yet; they are set by update_time
+    pdata->alarms.highlighted_year = 0;
+
     lv_obj_t *btn_today = lv_btn_create(obj_alarms);
     lv_obj_set_size(btn_today, 48, 48);
     lbl = lv_label_create(btn_today);
@@ -502,10 +542,49 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                             break;
                         }
 
+                        case CB_WORLD_CLOCK_ID: {
+                            model_updater_set_world_clock(
+                                updater, (lv_obj_get_state(pdata->settings.cb_world_clock) & LV_STATE_CHECKED) > 0);
+                            update_settings(pmodel, pdata);
+                            break;
+                        }
+
+                        case DROPDOWN_WORLD_CLOCK_ID: {
+                            // The first option is "None"
+                            lv_obj_t *dropdown = pdata->settings.dropdown_cities[obj_data->number];
+                            uint16_t  selected = lv_dropdown_get_selected(dropdown);
+                            model_updater_set_world_clock_city(updater, obj_data->number,
+                                                               selected > 0 ? selected - 1 : WORLD_CLOCK_NO_CITY);
+                            break;
+                        }
+
                         case CB_NIGHT_MODE_ID: {
-                            model_set_night_mode(model_updater_read(updater),
-                                                 (lv_obj_get_state(pdata->settings.cb_night_mode) & LV_STATE_CHECKED) >
-                                                     0);
+                            model_updater_set_night_mode(
+                                updater, (lv_obj_get_state(pdata->settings.cb_night_mode) & LV_STATE_CHECKED) > 0);
+                            update_settings(pmodel, pdata);
+                            break;
+                        }
+
+                        case CB_SOLAR_SCHEDULE_ID: {
+                            model_updater_set_solar_schedule(
+                                updater, (lv_obj_get_state(pdata->settings.cb_solar_schedule) & LV_STATE_CHECKED) > 0);
+                            update_settings(pmodel, pdata);
+                            break;
+                        }
+
+                        case SLIDER_LATITUDE_ID: {
+                            // Whole degrees are precise enough for the schedule
+                            model_updater_set_solar_location(updater,
+                                                             lv_slider_get_value(pdata->settings.slider_latitude) * 100,
+                                                             pmodel->config.solar_schedule.longitude);
+                            update_settings(pmodel, pdata);
+                            break;
+                        }
+
+                        case SLIDER_LONGITUDE_ID: {
+                            model_updater_set_solar_location(
+                                updater, pmodel->config.solar_schedule.latitude,
+                                lv_slider_get_value(pdata->settings.slider_longitude) * 100);
                             update_settings(pmodel, pdata);
                             break;
                         }
@@ -535,7 +614,7 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                             lv_calendar_date_t *date = lv_mem_alloc(sizeof(lv_calendar_date_t));
                             assert(date != NULL);
 
-                            time_t now_time = time(NULL);
+                            time_t now_time = clock_now();
 
                             if (lv_calendar_get_pressed_date(pdata->alarms.calendar, date) == LV_RES_OK) {
                                 struct tm then_tm = {
@@ -546,7 +625,7 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                                     .tm_min  = 59,
                                     .tm_sec  = 59,
                                 };
-                                time_t then_time = mktime(&then_tm);
+                                time_t then_time = civil_time_mktime(&then_tm);
                                 if (then_time >= now_time) {
                                     msg.stack_msg = PMAN_STACK_MSG_PUSH_PAGE_EXTRA(&page_alarms, date);
                                 }
@@ -579,8 +658,8 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                             lv_calendar_date_t *date = lv_mem_alloc(sizeof(lv_calendar_date_t));
                             assert(date != NULL);
 
-                            time_t    now_time = time(NULL);
-                            struct tm now_tm   = *localtime(&now_time);
+                            time_t    now_time = clock_now();
+                            struct tm now_tm   = civil_time_localtime(now_time);
 
                             date->day     = now_tm.tm_mday;
                             date->month   = now_tm.tm_mon + 1;
@@ -632,11 +711,11 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                         }
 
                         case BTN_TODAY_ID: {
-                            time_t     now                  = time(NULL);
-                            struct tm *tm_struct            = localtime(&now);
-                            pdata->alarms.showed_date.day   = tm_struct->tm_mday;
-                            pdata->alarms.showed_date.month = tm_struct->tm_mon + 1;
-                            pdata->alarms.showed_date.year  = tm_struct->tm_year + 1900;
+                            time_t    now                  = clock_now();
+                            struct tm tm_struct            = civil_time_localtime(now);
+                            pdata->alarms.showed_date.day   = tm_struct.tm_mday;
+                            pdata->alarms.showed_date.month = tm_struct.tm_mon + 1;
+                            pdata->alarms.showed_date.year  = tm_struct.tm_year + 1900;
 
                             update_time(pmodel, pdata);
                             break;
@@ -671,9 +750,17 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                         case WATCHER_UPDATE_ID:
                             update_info(pmodel, pdata);
                             break;
+                        case WATCHER_ALARMS_ID:
+                            update_alarms(pmodel, pdata, 0);
+                            update_highlighted_days(pmodel, pdata);
+                            break;
                     }
                     break;
                 }
+
+                case VIEW_EVENT_TAG_ALARM_DUE:
+                    show_alarm(pmodel, pdata, view_event->as.alarm_due.num);
+                    break;
             }
             break;
         }
@@ -705,21 +792,21 @@ static void destroy_page(void *state, void *extra) {
 
 
 static void update_time(model_t *pmodel, struct page_data *pdata) {
-    time_t     now       = time(NULL);
-    struct tm *tm_struct = localtime(&now);
+    time_t    now       = clock_now();
+    struct tm tm_struct = civil_time_localtime(now);
 
-    uint16_t hours = tm_struct->tm_hour;
+    uint16_t hours = tm_struct.tm_hour;
     if (!model_get_military_time(pmodel)) {
         hours = hours % 12;
         hours = hours == 0 ? 12 : hours;
     }
 
     lv_label_set_text_fmt(pdata->lbl_hours, "%02i", hours);
-    lv_label_set_text_fmt(pdata->lbl_minutes, "%02i", tm_struct->tm_min);
-    lv_label_set_text_fmt(pdata->lbl_seconds, ":%02i", tm_struct->tm_sec);
-    lv_label_set_text_fmt(pdata->lbl_date, "%02i/%02i/%02i", tm_struct->tm_mday, tm_struct->tm_mon + 1,
-                          tm_struct->tm_year % 100);
-    lv_label_set_text(pdata->lbl_ampm, tm_struct->tm_hour > 13 ? "PM" : "AM");
+    lv_label_set_text_fmt(pdata->lbl_minutes, "%02i", tm_struct.tm_min);
+    lv_label_set_text_fmt(pdata->lbl_seconds, ":%02i", tm_struct.tm_sec);
+    lv_label_set_text_fmt(pdata->lbl_date, "%02i/%02i/%02i", tm_struct.tm_mday, tm_struct.tm_mon + 1,
+                          tm_struct.tm_year % 100);
+    lv_label_set_text(pdata->lbl_ampm, tm_struct.tm_hour > 13 ? "PM" : "AM");
 
     lv_obj_align_to(pdata->lbl_hours, pdata->lbl_colon, LV_ALIGN_OUT_LEFT_MID, 0, 0);
     lv_obj_align_to(pdata->lbl_minutes, pdata->lbl_colon, LV_ALIGN_OUT_RIGHT_MID, 0, 0);
@@ -728,19 +815,21 @@ static void update_time(model_t *pmodel, struct page_data *pdata) {
     lv_obj_align_to(pdata->lbl_ampm, pdata->lbl_colon, LV_ALIGN_OUT_BOTTOM_MID, 0, 0);
 
     view_common_set_hidden(pdata->lbl_ampm, model_get_military_time(pmodel));
+    view_common_set_hidden(pdata->lbl_date, pmodel->config.world_clock.enabled);
+    update_world_clock(pmodel, pdata, now);
 
     lv_calendar_date_t today = *lv_calendar_get_today_date(pdata->alarms.calendar);
     // The current day changed
-    if (today.day != tm_struct->tm_mday || today.month != tm_struct->tm_mon + 1 ||
-        today.year != tm_struct->tm_year + 1900) {
-        lv_calendar_set_today_date(pdata->alarms.calendar, tm_struct->tm_year + 1900, tm_struct->tm_mon + 1,
-                                   tm_struct->tm_mday);
+    if (today.day != tm_struct.tm_mday || today.month != tm_struct.tm_mon + 1 ||
+        today.year != tm_struct.tm_year + 1900) {
+        lv_calendar_set_today_date(pdata->alarms.calendar, tm_struct.tm_year + 1900, tm_struct.tm_mon + 1,
+                                   tm_struct.tm_mday);
 
         // Also snap the calendar to the current date (if not in use)
         if (pdata->menu_state == MENU_STATE_CLOSED) {
-            pdata->alarms.showed_date.day   = tm_struct->tm_mday;
-            pdata->alarms.showed_date.month = tm_struct->tm_mon + 1;
-            pdata->alarms.showed_date.year  = tm_struct->tm_year + 1900;
+            pdata->alarms.showed_date.day   = tm_struct.tm_mday;
+            pdata->alarms.showed_date.month = tm_struct.tm_mon + 1;
+            pdata->alarms.showed_date.year  = tm_struct.tm_year + 1900;
         }
     }
 
@@ -749,9 +838,10 @@ static void update_time(model_t *pmodel, struct page_data *pdata) {
         lv_calendar_set_showed_date(pdata->alarms.calendar, pdata->alarms.showed_date.year,
                                     pdata->alarms.showed_date.month);
     }
+    update_highlighted_days(pmodel, pdata);
 
-    if (tm_struct->tm_mon + 1 == pdata->alarms.showed_date.month &&
-        tm_struct->tm_year + 1900 == pdata->alarms.showed_date.year) {
+    if (tm_struct.tm_mon + 1 == pdata->alarms.showed_date.month &&
+        tm_struct.tm_year + 1900 == pdata->alarms.showed_date.year) {
         view_common_set_hidden(pdata->alarms.btn_today, 1);
     } else {
         view_common_set_hidden(pdata->alarms.btn_today, 0);
@@ -802,6 +892,40 @@ static void update_settings(model_t *pmodel, struct page_data *pdata) {
             ESP_LOGI(TAG, "nm %i", pmodel->config.night_mode);
 
             view_common_set_hidden(pdata->settings.btn_night_mode, !pmodel->config.night_mode);
+
+            const solar_schedule_config_t *solar_schedule = &pmodel->config.solar_schedule;
+            if (solar_schedule->enabled) {
+                lv_obj_add_state(pdata->settings.cb_solar_schedule, LV_STATE_CHECKED);
+            } else {
+                lv_obj_clear_state(pdata->settings.cb_solar_schedule, LV_STATE_CHECKED);
+            }
+
+            lv_slider_set_value(pdata->settings.slider_latitude, solar_schedule->latitude / 100, LV_ANIM_OFF);
+            lv_label_set_text_fmt(pdata->settings.lbl_latitude, "%i.%02i %c", abs(solar_schedule->latitude) / 100,
+                                  abs(solar_schedule->latitude) % 100, solar_schedule->latitude < 0 ? 'S' : 'N');
+            lv_slider_set_value(pdata->settings.slider_longitude, solar_schedule->longitude / 100, LV_ANIM_OFF);
+            lv_label_set_text_fmt(pdata->settings.lbl_longitude, "%i.%02i %c", abs(solar_schedule->longitude) / 100,
+                                  abs(solar_schedule->longitude) % 100, solar_schedule->longitude < 0 ? 'W' : 'E');
+
+            view_common_set_hidden(lv_obj_get_parent(pdata->settings.slider_latitude), !solar_schedule->enabled);
+            view_common_set_hidden(lv_obj_get_parent(pdata->settings.slider_longitude), !solar_schedule->enabled);
+            break;
+        }
+
+        case PARAMETER_PAGE_WORLD_CLOCK: {
+            if (pmodel->config.world_clock.enabled) {
+                lv_obj_add_state(pdata->settings.cb_world_clock, LV_STATE_CHECKED);
+            } else {
+                lv_obj_clear_state(pdata->settings.cb_world_clock, LV_STATE_CHECKED);
+            }
+
+            for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+                // The first option is "None"
+                uint8_t city = pmodel->config.world_clock.cities[i];
+                lv_dropdown_set_selected(pdata->settings.dropdown_cities[i],
+                                         city != WORLD_CLOCK_NO_CITY ? city + 1 : 0);
+                view_common_set_hidden(pdata->settings.dropdown_cities[i], !pmodel->config.world_clock.enabled);
+            }
             break;
         }
     }
@@ -872,6 +996,61 @@ static void update_info(model_t *pmodel, struct page_data *pdata) {
 }
 
 
+/*
+ * Only an addition and a division per zone: the offsets are cached by the controller until the next DST transition
+ */
+static void update_world_clock(model_t *pmodel, struct page_data *pdata, time_t now) {
+    for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+        lv_obj_t   *lbl  = pdata->world_clock.lbl_zones[i];
+        const char *name = model_get_world_clock_name(pmodel, i);
+
+        if (!pmodel->config.world_clock.enabled || name == NULL) {
+            view_common_set_hidden(lbl, 1);
+            continue;
+        }
+
+        int32_t minutes = ((now + model_get_world_clock_offset(pmodel, i)) % (24 * 60 * 60)) / 60;
+        if (minutes != pdata->world_clock.minutes[i] || name != pdata->world_clock.names[i]) {
+            uint16_t hours = minutes / 60;
+            if (model_get_military_time(pmodel)) {
+                lv_label_set_text_fmt(lbl, "%s\n%02i:%02i", name, hours, minutes % 60);
+            } else {
+                lv_label_set_text_fmt(lbl, "%s\n%i:%02i %s", name, hours % 12 == 0 ? 12 : hours % 12, minutes % 60,
+                                      hours >= 12 ? "PM" : "AM");
+            }
+            pdata->world_clock.minutes[i] = minutes;
+            pdata->world_clock.names[i]   = name;
+        }
+        view_common_set_hidden(lbl, 0);
+    }
+}
+
+
+static void reset_world_clock(struct page_data *pdata) {
+    for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+        pdata->world_clock.minutes[i] = -1;
+        pdata->world_clock.names[i]   = NULL;
+    }
+}
+
+
+/*
+ * "None" followed by the city names, so that option n is city n - 1
+ */
+static const char *get_city_options(void) {
+    static char options[256] = {0};
+
+    if (options[0] == '\0') {
+        size_t len = snprintf(options, sizeof(options), "None");
+        for (size_t i = 0; i < world_clock_get_city_count() && len < sizeof(options); i++) {
+            len += snprintf(&options[len], sizeof(options) - len, "\n%s", world_clock_get_city(i)->name);
+        }
+    }
+
+    return options;
+}
+
+
 static void update_wifi_list(model_t *pmodel, struct page_data *pdata) {
     lv_obj_clean(pdata->wifi.list_networks);
     for (size_t i = 0; i < model_get_available_networks_count(pmodel); i++) {
@@ -885,23 +1064,33 @@ static void update_wifi_list(model_t *pmodel, struct page_data *pdata) {
 }
 
 
+/*
+ * Both lookups are binary searches on the alarm index, so the list is cheap to refresh every time
+ */
 static void update_alarms(model_t *pmodel, struct page_data *pdata, uint8_t next) {
-    size_t alarm_num = 0;
-
-    time_t    time_now = time(NULL);
-    struct tm tm_now   = *localtime(&time_now);
+    time_t   now        = clock_now();
+    size_t   alarm_num  = 0;
+    uint64_t occurrence = 0;
+
+    size_t in_progress = model_get_alarms_in_progress(pmodel, now, pdata->banner.alarms, MAX_BANNER_ITEMS - 1);
+
+    pdata->banner.count       = in_progress;
+    pdata->banner.in_progress = in_progress;
+    // Only the rest of today, like the highlighted calendar day
+    if (model_get_next_alarm_after(pmodel, now, &alarm_num, &occurrence) && occurrence < model_get_today_end(pmodel)) {
+        pdata->banner.alarms[pdata->banner.count++] = alarm_num;
+        pdata->banner.next_occurrence               = occurrence;
+    }
 
     if (next) {
-        pdata->nth_alarm_today++;
-        if (!model_get_nth_alarm_for_day(pmodel, &alarm_num, pdata->nth_alarm_today, tm_now.tm_mday, tm_now.tm_mon,
-                                         tm_now.tm_year)) {
-            pdata->nth_alarm_today = 0;
-        }
+        pdata->banner.nth++;
+    }
+    if (pdata->banner.nth >= pdata->banner.count) {
+        pdata->banner.nth = 0;
     }
 
-    if (model_get_nth_alarm_for_day(pmodel, &alarm_num, pdata->nth_alarm_today, tm_now.tm_mday, tm_now.tm_mon,
-                                    tm_now.tm_year)) {
-        lv_label_set_text(pdata->lbl_alarms, model_get_alarm(pmodel, alarm_num).description);
+    if (pdata->banner.count > 0) {
+        set_banner_text(pmodel, pdata, pdata->banner.nth);
         view_common_set_hidden(pdata->lbl_alarms, 0);
         view_common_set_hidden(pdata->btn_bell, 0);
         view_common_set_hidden(pdata->lbl_colon, 1);
@@ -913,6 +1102,74 @@ static void update_alarms(model_t *pmodel, struct page_data *pdata, uint8_t next
 }
 
 
+static void update_highlighted_days(model_t *pmodel, struct page_data *pdata) {
+    const lv_calendar_date_t *showed_date = lv_calendar_get_showed_date(pdata->alarms.calendar);
+    uint32_t                  generation  = model_get_field_generation(pmodel, MODEL_FIELD_ALARMS);
+
+    if (showed_date->month == pdata->alarms.highlighted_month && showed_date->year == pdata->alarms.highlighted_year &&
+        generation == pdata->alarms.highlighted_generation) {
+        return;
+    }
+
+    uint32_t days  = model_get_month_alarm_days(pmodel, showed_date->month - 1, showed_date->year - 1900);
+    size_t   count = 0;
+    for (uint16_t day = 1; day <= MAX_HIGHLIGHTED_DAYS; day++) {
+        if (days & (1UL << (day - 1))) {
+            pdata->alarms.highlighted_days[count].year  = showed_date->year;
+            pdata->alarms.highlighted_days[count].month = showed_date->month;
+            pdata->alarms.highlighted_days[count].day   = day;
+            count++;
+        }
+    }
+    lv_calendar_set_highlighted_dates(pdata->alarms.calendar, pdata->alarms.highlighted_days, count);
+
+    pdata->alarms.highlighted_month      = showed_date->month;
+    pdata->alarms.highlighted_year       = showed_date->year;
+    pdata->alarms.highlighted_generation = generation;
+}
+
+
+/*
+ * Brings the banner to an alarm, e.g. when it becomes due. An alarm without duration is neither in progress nor next
+ * once due, so it is shown by itself until the banner moves on
+ */
+static void show_alarm(model_t *pmodel, struct page_data *pdata, size_t alarm_num) {
+    update_alarms(pmodel, pdata, 0);
+
+    for (size_t i = 0; i < pdata->banner.count; i++) {
+        if (pdata->banner.alarms[i] == alarm_num) {
+            pdata->banner.nth = i;
+            set_banner_text(pmodel, pdata, i);
+            return;
+        }
+    }
+
+    lv_label_set_text(pdata->lbl_alarms, model_get_alarm_description(pmodel, alarm_num));
+    view_common_set_hidden(pdata->lbl_alarms, 0);
+    view_common_set_hidden(pdata->btn_bell, 0);
+    view_common_set_hidden(pdata->lbl_colon, 1);
+}
+
+
+static void set_banner_text(model_t *pmodel, struct page_data *pdata, size_t nth) {
+    const char *description = model_get_alarm_description(pmodel, pdata->banner.alarms[nth]);
+
+    if (nth < pdata->banner.in_progress) {
+        lv_label_set_text_fmt(pdata->lbl_alarms, "Now: %s", description);
+        return;
+    }
+
+    struct tm tm_struct = civil_time_localtime(pdata->banner.next_occurrence);
+    uint16_t  hours     = tm_struct.tm_hour;
+    if (!model_get_military_time(pmodel)) {
+        hours = hours % 12;
+        hours = hours == 0 ? 12 : hours;
+    }
+
+    lv_label_set_text_fmt(pdata->lbl_alarms, "%02i:%02i %s", hours, tm_struct.tm_min, description);
+}
+
+
 static void btns_value_changed_event_cb(lv_event_t *e) {
     lv_obj_t         *btns  = lv_event_get_target(e);
     struct page_data *pdata = lv_event_get_user_data(e);
@@ -925,7 +1182,7 @@ static void btns_value_changed_event_cb(lv_event_t *e) {
 
 
 static lv_obj_t *slider_parameter_create(lv_obj_t *parent, const char *description, lv_obj_t **lbl_value,
-                                         lv_obj_t **slider_value, uint16_t minimum, uint16_t maximum) {
+                                         lv_obj_t **slider_value, int16_t minimum, int16_t maximum) {
     lv_obj_t *row = lv_obj_create(parent);
     lv_obj_add_style(row, (lv_style_t *)&style_transparent_cont, LV_STATE_DEFAULT);
     lv_obj_add_style(row, (lv_style_t *)&style_padless_cont, LV_STATE_DEFAULT);
@@ -967,6 +1224,13 @@ static void create_parameter_page(model_t *pmodel, struct page_data *pdata) {
     pdata->settings.slider_standby_brightness = NULL;
     pdata->settings.slider_standby_delay      = NULL;
     pdata->settings.btn_night_mode            = NULL;
+    pdata->settings.cb_solar_schedule         = NULL;
+    pdata->settings.lbl_latitude              = NULL;
+    pdata->settings.lbl_longitude             = NULL;
+    pdata->settings.slider_latitude           = NULL;
+    pdata->settings.slider_longitude          = NULL;
+    pdata->settings.cb_world_clock            = NULL;
+    memset(pdata->settings.dropdown_cities, 0, sizeof(pdata->settings.dropdown_cities));
 
     switch (pdata->settings.page) {
         case PARAMETER_PAGE_BRIGHTNESS: {
@@ -1011,6 +1275,47 @@ static void create_parameter_page(model_t *pmodel, struct page_data *pdata) {
             view_register_object_default_callback(btn, BTN_NIGHT_MODE_ID);
             pdata->settings.btn_night_mode = btn;
 
+            checkbox = lv_checkbox_create(obj_parlist);
+            lv_obj_set_style_text_font(checkbox, STYLE_FONT_SMALL, LV_STATE_DEFAULT | LV_PART_MAIN);
+            lv_obj_set_style_text_font(checkbox, STYLE_FONT_SMALL, LV_STATE_DEFAULT | LV_PART_INDICATOR);
+            lv_obj_set_style_text_font(checkbox, STYLE_FONT_SMALL, LV_STATE_CHECKED | LV_PART_INDICATOR);
+            lv_checkbox_set_text(checkbox, "Follow the sun");
+            view_register_object_default_callback(checkbox, CB_SOLAR_SCHEDULE_ID);
+            pdata->settings.cb_solar_schedule = checkbox;
+
+            slider_parameter_create(obj_parlist, "Latitude", &pdata->settings.lbl_latitude,
+                                    &pdata->settings.slider_latitude, -90, 90);
+            view_register_object_default_callback(pdata->settings.slider_latitude, SLIDER_LATITUDE_ID);
+
+            slider_parameter_create(obj_parlist, "Longitude", &pdata->settings.lbl_longitude,
+                                    &pdata->settings.slider_longitude, -180, 180);
+            view_register_object_default_callback(pdata->settings.slider_longitude, SLIDER_LONGITUDE_ID);
+            break;
+        }
+
+        case PARAMETER_PAGE_WORLD_CLOCK: {
+            lv_obj_t *checkbox = lv_checkbox_create(obj_parlist);
+            lv_obj_set_style_text_font(checkbox, STYLE_FONT_SMALL, LV_STATE_DEFAULT | LV_PART_MAIN);
+            lv_obj_set_style_text_font(checkbox, STYLE_FONT_SMALL, LV_STATE_DEFAULT | LV_PART_INDICATOR);
+            lv_obj_set_style_text_font(checkbox, STYLE_FONT_SMALL, LV_STATE_CHECKED | LV_PART_INDICATOR);
+            lv_checkbox_set_text(checkbox, "World clock");
+            view_register_object_default_callback(checkbox, CB_WORLD_CLOCK_ID);
+            pdata->settings.cb_world_clock = checkbox;
+
+            lv_obj_t *row = lv_obj_create(obj_parlist);
+            lv_obj_add_style(row, (lv_style_t *)&style_transparent_cont, LV_STATE_DEFAULT);
+            lv_obj_add_style(row, (lv_style_t *)&style_padless_cont, LV_STATE_DEFAULT);
+            lv_obj_set_size(row, LV_PCT(100), 48);
+
+            for (size_t i = 0; i < WORLD_CLOCK_ZONES; i++) {
+                lv_obj_t *dropdown = lv_dropdown_create(row);
+                lv_obj_set_style_text_font(dropdown, STYLE_FONT_TINY, LV_STATE_DEFAULT);
+                lv_dropdown_set_options_static(dropdown, get_city_options());
+                lv_obj_set_width(dropdown, WORLD_CLOCK_WIDTH);
+                lv_obj_align(dropdown, LV_ALIGN_LEFT_MID, 8 + i * WORLD_CLOCK_WIDTH, 0);
+                view_register_object_default_callback_with_number(dropdown, DROPDOWN_WORLD_CLOCK_ID, i);
+                pdata->settings.dropdown_cities[i] = dropdown;
+            }
             break;
         }
 
@@ -1029,3 +1334,4 @@ const pman_page_t page_main = {
     .close         = close_page,
     .process_event = page_event,
 };
+
@@ -119,7 +119,7 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
 
     struct page_data *pdata   = state;
     model_updater_t   updater = pman_get_user_data(handle);
-    mut_model_t      *pmodel  = model_updater_read(updater);
+    model_t          *pmodel  = model_updater_read(updater);
 
     switch (event.tag) {
         case PMAN_EVENT_TAG_TIMER: {
@@ -151,7 +151,7 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                                     uint32_t start_hour = lv_roller_get_selected(pdata->roller_hour);
                                     uint32_t start_min  = lv_roller_get_selected(pdata->roller_minute) * 5;
 
-                                    pmodel->config.night_mode_start = start_hour * 3600 + start_min * 60;
+                                    model_updater_set_night_mode_start(updater, start_hour * 3600 + start_min * 60);
 
                                     pdata->page_state = PAGE_STATE_END;
 
@@ -163,7 +163,7 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                                     uint32_t end_hour = lv_roller_get_selected(pdata->roller_hour);
                                     uint32_t end_min  = lv_roller_get_selected(pdata->roller_minute) * 5;
 
-                                    pmodel->config.night_mode_end = end_hour * 3600 + end_min * 60;
+                                    model_updater_set_night_mode_end(updater, end_hour * 3600 + end_min * 60);
 
                                     msg.stack_msg = PMAN_STACK_MSG_BACK();
                                     break;
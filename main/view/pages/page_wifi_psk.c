@@ -215,13 +215,12 @@ static pman_msg_t page_event(pman_handle_t handle, void *state, pman_event_t eve
                             if (len < 8) {
                                 lv_obj_set_style_border_color(pdata->textarea, STYLE_RED, LV_STATE_DEFAULT);
                             } else {
-                                view_controller_msg_t *cmsg = view_controller_msg(
-                                    (view_controller_msg_t){.tag = VIEW_CONTROLLER_MESSAGE_TAG_CONNECT_TO});
-                                strcpy(cmsg->as.connect_to.ssid, pdata->ssid);
-                                strcpy(cmsg->as.connect_to.psk, string);
-                                ESP_LOGI(TAG, "Connection request %s %s", cmsg->as.connect_to.ssid,
-                                         cmsg->as.connect_to.psk);
-                                msg.user_msg  = cmsg;
+                                view_controller_msg_t cmsg = {.tag = VIEW_CONTROLLER_MESSAGE_TAG_CONNECT_TO};
+                                strcpy(cmsg.as.connect_to.ssid, pdata->ssid);
+                                strcpy(cmsg.as.connect_to.psk, string);
+                                ESP_LOGI(TAG, "Connection request %s %s", cmsg.as.connect_to.ssid,
+                                         cmsg.as.connect_to.psk);
+                                msg.user_msg  = view_controller_msg(cmsg);
                                 msg.stack_msg = PMAN_STACK_MSG_BACK();
                             }
                             break;
@@ -1,20 +1,18 @@
 #include <stdlib.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 #include "page_manager.h"
-#include "watcher.h"
 #include "config/app_config.h"
 #include "model/updater.h"
+#include "model/message_ring.h"
 #include "view.h"
 #include "theme/style.h"
 #include "theme/theme.h"
-#include "services/system_time.h"
 #include "esp_log.h"
 
 
 #define DISPLAY_HORIZONTAL_RESOLUTION LV_HOR_RES_MAX
 #define DISPLAY_VERTICAL_RESOLUTION   LV_VER_RES_MAX
 #define MAX_VIEW_EVENTS               32
+#define MAX_WATCHED_FIELDS            32
 #ifdef SIMULATED_APPLICATION
 #define BUFFER_SIZE (DISPLAY_HORIZONTAL_RESOLUTION * 200)
 #else
@@ -23,14 +21,24 @@
 #endif
 
 
-static void view_watcher_cb(void *old_value, const void *memory, uint16_t size, void *user_ptr, void *arg);
 static void close_page_global_cb(void *user_ptr, void *page_state);
 
 
-static const char    *TAG         = "View";
-static pman_t         pman        = {0};
-static QueueHandle_t  event_queue = NULL;
-static watcher_t      watcher;
+static const char    *TAG            = "View";
+static pman_t         pman           = {0};
+static message_ring_t event_ring     = {0};
+static uint32_t       dropped_events = 0;
+// Counts the pages closed, so that events meant for a page are not handed to the next one
+static uint32_t       page_closures  = 0;
+static model_t       *view_model     = NULL;
+
+// Model fields the current page wants to be notified about, grouped by watcher code
+static struct {
+    uint32_t mask;
+    int      code;
+} watched_fields[MAX_WATCHED_FIELDS] = {0};
+static size_t   num_watched_fields = 0;
+static uint32_t watched_generation = 0;
 
 
 void view_init(model_updater_t updater, pman_user_msg_cb_t controller_cb,
@@ -38,11 +46,13 @@ void view_init(model_updater_t updater, pman_user_msg_cb_t controller_cb,
                void (*read_cb)(struct _lv_indev_drv_t *indev_drv, lv_indev_data_t *data)) {
     (void)TAG;
 
-    event_queue = xQueueCreate(MAX_VIEW_EVENTS, sizeof(view_event_t));
+    static view_event_t event_buffer[MAX_VIEW_EVENTS];
+    message_ring_init(&event_ring, event_buffer, sizeof(event_buffer[0]), MAX_VIEW_EVENTS);
 
     lv_init();
 
-    watcher_init(&watcher, NULL);
+    view_model         = model_updater_read(updater);
+    watched_generation = model_get_generation(view_model);
 
     /*A static or global variable to store the buffers*/
     static lv_disp_draw_buf_t disp_buf;
@@ -104,40 +114,71 @@ void view_register_object_default_callback_with_number(lv_obj_t *obj, int id, in
 
 
 void view_manage(void) {
-    watcher_watch(&watcher, get_millis());
+    // Everything is collected before handling, since an event may close the page and reset the watchers
+    view_event_t events[MAX_VIEW_EVENTS + MAX_WATCHED_FIELDS];
+    size_t       count = message_ring_pop_batch(&event_ring, events, MAX_VIEW_EVENTS);
+
+    // Watchers bypass the ring: fields sharing a code are grouped, so each code is notified once per change
+    uint32_t changes = model_get_changes(view_model, &watched_generation);
+    if (changes) {
+        for (size_t i = 0; i < num_watched_fields; i++) {
+            if (changes & watched_fields[i].mask) {
+                events[count++] = (view_event_t){.tag                  = VIEW_EVENT_TAG_VARIABLE_WATCHER,
+                                                 .as.page_watcher.code = watched_fields[i].code};
+            }
+        }
+    }
 
-    view_event_t event = {0};
-    while (xQueueReceive(event_queue, &event, 0)) {
-        pman_event(&pman, (pman_event_t){.tag = PMAN_EVENT_TAG_USER, .as = {.user = &event}});
+    uint32_t closures = page_closures;
+    for (size_t i = 0; i < count && closures == page_closures; i++) {
+        pman_event(&pman, (pman_event_t){.tag = PMAN_EVENT_TAG_USER, .as = {.user = &events[i]}});
     }
 }
 
 
+/*
+ * Must only be called by the controller task
+ */
 void view_event(view_event_t event) {
-    xQueueSend(event_queue, &event, 0);
+    if (!message_ring_push(&event_ring, &event)) {
+        dropped_events++;
+        ESP_LOGW(TAG, "Too many events, dropping %i", event.tag);
+    }
 }
 
 
-void view_add_watched_variable(void *ptr, size_t size, int code) {
-    assert(watcher.entries.num < MAX_VIEW_EVENTS - 1);
-    watcher_add_entry(&watcher, ptr, size, view_watcher_cb, (void *)(uintptr_t)code);
+/*
+ * Events lost because the ring was full
+ */
+uint32_t view_get_dropped_events(void) {
+    return dropped_events;
 }
 
 
-static void view_watcher_cb(void *old_value, const void *memory, uint16_t size, void *user_ptr, void *arg) {
-    (void)old_value;
-    (void)memory;
-    (void)size;
-    (void)user_ptr;
-    view_event((view_event_t){.tag = VIEW_EVENT_TAG_VARIABLE_WATCHER, .as.page_watcher.code = (uintptr_t)arg});
+/*
+ * Fields sharing the same code produce a single event per change
+ */
+void view_add_watched_field(model_field_t field, int code) {
+    for (size_t i = 0; i < num_watched_fields; i++) {
+        if (watched_fields[i].code == code) {
+            watched_fields[i].mask |= MODEL_FIELD_MASK(field);
+            return;
+        }
+    }
+
+    assert(num_watched_fields < MAX_WATCHED_FIELDS);
+    watched_fields[num_watched_fields].mask = MODEL_FIELD_MASK(field);
+    watched_fields[num_watched_fields].code = code;
+    num_watched_fields++;
 }
 
 
 static void close_page_global_cb(void *user_ptr, void *page_state) {
     (void)user_ptr;
     (void)page_state;
-    xQueueReset(event_queue);
+    message_ring_clear(&event_ring);
+    page_closures++;
 
-    watcher_destroy(&watcher);
-    watcher_init(&watcher, NULL);
+    num_watched_fields = 0;
+    watched_generation = model_get_generation(view_model);
 }
@@ -0,0 +1,31 @@
+#ifndef VIEW_EVENT_H_INCLUDED
+#define VIEW_EVENT_H_INCLUDED
+
+
+#include <stdlib.h>
+
+
+typedef enum {
+    VIEW_EVENT_TAG_WIFI_SCAN_DONE,
+    VIEW_EVENT_TAG_VARIABLE_WATCHER,
+    VIEW_EVENT_TAG_ALARM_DUE,
+} view_event_tag_t;
+
+typedef struct {
+    view_event_tag_t tag;
+    union {
+        struct {
+            int code;
+        } page_watcher;
+        struct {
+            size_t num;
+        } alarm_due;
+    } as;
+} view_event_t;
+
+
+// Only from the controller task
+void view_event(view_event_t event);
+
+
+#endif
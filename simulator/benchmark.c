@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "model/message_ring.h"
+#include "view/view.h"
+#include "benchmark.h"
+#include "esp_log.h"
+
+
+#define BENCHMARK_ROUNDS 100000
+#define BENCHMARK_BURST  8
+
+
+static void     benchmark_view_events(void);
+static uint64_t monotonic_nanos(void);
+
+
+static const char *TAG = "Benchmark";
+
+
+/*
+ * SIMULATOR_BENCHMARK=1 times the view event ring against the FreeRTOS queue it replaced, then the simulator starts
+ * normally
+ */
+void benchmark_run(void) {
+    if (getenv("SIMULATOR_BENCHMARK") != NULL) {
+        benchmark_view_events();
+    }
+}
+
+
+/*
+ * Bursts like the ones view_manage drains every iteration
+ */
+static void benchmark_view_events(void) {
+    static view_event_t buffer[32];
+    view_event_t        events[BENCHMARK_BURST];
+    view_event_t        event = {.tag = VIEW_EVENT_TAG_ALARM_DUE};
+    message_ring_t      ring  = {0};
+    message_ring_init(&ring, buffer, sizeof(buffer[0]), 32);
+    QueueHandle_t queue = xQueueCreate(32, sizeof(view_event_t));
+
+    uint64_t start = monotonic_nanos();
+    for (size_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (size_t i = 0; i < BENCHMARK_BURST; i++) {
+            event.as.alarm_due.num = i;
+            message_ring_push(&ring, &event);
+        }
+        message_ring_pop_batch(&ring, events, BENCHMARK_BURST);
+    }
+    uint64_t ring_nanos = monotonic_nanos() - start;
+
+    start = monotonic_nanos();
+    for (size_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (size_t i = 0; i < BENCHMARK_BURST; i++) {
+            event.as.alarm_due.num = i;
+            xQueueSend(queue, &event, 0);
+        }
+        size_t count = 0;
+        while (xQueueReceive(queue, &events[count], 0)) {
+            count++;
+        }
+    }
+    uint64_t queue_nanos = monotonic_nanos() - start;
+    vQueueDelete(queue);
+
+    ESP_LOGI(TAG, "View events in bursts of %i: %llu ns each through the ring, %llu ns through a FreeRTOS queue",
+             BENCHMARK_BURST, (unsigned long long)(ring_nanos / (BENCHMARK_ROUNDS * BENCHMARK_BURST)),
+             (unsigned long long)(queue_nanos / (BENCHMARK_ROUNDS * BENCHMARK_BURST)));
+}
+
+
+static uint64_t monotonic_nanos(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,8 @@
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+
+void benchmark_run(void);
+
+
+#endif
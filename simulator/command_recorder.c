@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "model/command_log.h"
+#include "command_recorder.h"
+#include "esp_log.h"
+
+
+#define COMMAND_LOG_SIZE (16 * 1024)
+
+
+static void replay_file(model_updater_t updater, const char *path);
+
+
+static const char *TAG = "CommandRecorder";
+
+static uint8_t       command_log_buffer[COMMAND_LOG_SIZE];
+static uint8_t       file_buffer[COMMAND_LOG_SIZE];
+static command_log_t command_log = {0};
+static const char   *record_path = NULL;
+
+
+/*
+ * SIMULATOR_REPLAY=path applies a session saved with SIMULATOR_RECORD=path, which records every change made through
+ * the updater from now on. Must be called once the model is loaded
+ */
+void command_recorder_init(model_updater_t updater) {
+    command_log_init(&command_log, command_log_buffer, sizeof(command_log_buffer));
+    if (getenv("SIMULATOR_REPLAY") != NULL) {
+        replay_file(updater, getenv("SIMULATOR_REPLAY"));
+    }
+
+    record_path = getenv("SIMULATOR_RECORD");
+    if (record_path != NULL) {
+        model_updater_set_command_log(updater, &command_log);
+    }
+}
+
+
+/*
+ * Writes the session recorded so far, if any
+ */
+void command_recorder_save(void) {
+    if (record_path == NULL) {
+        return;
+    }
+
+    size_t len  = command_log_copy(&command_log, file_buffer, sizeof(file_buffer));
+    FILE  *file = fopen(record_path, "wb");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "Unable to open %s", record_path);
+        return;
+    }
+    fwrite(file_buffer, 1, len, file);
+    fclose(file);
+}
+
+
+static void replay_file(model_updater_t updater, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "Unable to open %s", path);
+        return;
+    }
+    size_t len = fread(file_buffer, 1, sizeof(file_buffer), file);
+    fclose(file);
+
+    // Recording starts after the replay, so the buffer is free
+    command_log_t log = {0};
+    command_log_init(&log, command_log_buffer, sizeof(command_log_buffer));
+    command_log_restore(&log, file_buffer, len);
+    ESP_LOGI(TAG, "Replayed %zu commands from %s", model_updater_replay(updater, &log, NULL), path);
+}
@@ -0,0 +1,12 @@
+#ifndef COMMAND_RECORDER_H_INCLUDED
+#define COMMAND_RECORDER_H_INCLUDED
+
+
+#include "model/updater.h"
+
+
+void command_recorder_init(model_updater_t updater);
+void command_recorder_save(void);
+
+
+#endif
@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <time.h>
+#include "sdl/sdl.h"
+#include "controller/gui.h"
+#include "display_account.h"
+#include "esp_log.h"
+
+
+// Address window and memory write commands the ST7796S driver sends before the pixels of every flush
+#define FLUSH_COMMAND_BYTES 11
+
+
+static uint8_t  enabled(void);
+static uint64_t monotonic_nanos(void);
+
+
+static const char *TAG = "DisplayAccount";
+
+// Cost of the loop while the display is lit and while it is dark, to tell what dark mode saves
+static struct {
+    uint64_t wall_nanos;
+    uint64_t cpu_nanos;
+    uint64_t spi_bytes;
+} display_accounts[2] = {0};
+
+
+/*
+ * Counts the bytes the flush would send to the panel over SPI
+ */
+void display_account_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p) {
+    sdl_display_flush(disp_drv, area, color_p);
+    if (!enabled()) {
+        return;
+    }
+
+    uint64_t pixels = (uint64_t)lv_area_get_width(area) * (uint64_t)lv_area_get_height(area);
+    display_accounts[controller_gui_is_dark()].spi_bytes += FLUSH_COMMAND_BYTES + pixels * LV_COLOR_DEPTH / 8;
+}
+
+
+/*
+ * Compares an hour spent lit with an hour spent dark, from everything measured since the start
+ */
+void display_account_report(void) {
+    if (!enabled()) {
+        return;
+    }
+
+    const double hour   = 3600e9;
+    double       lit    = (double)display_accounts[0].wall_nanos;
+    double       dark   = (double)display_accounts[1].wall_nanos;
+    if (lit == 0 || dark == 0) {
+        ESP_LOGI(TAG, "Display: %s the whole time", lit == 0 ? "dark" : "lit");
+        return;
+    }
+
+    double lit_cpu  = display_accounts[0].cpu_nanos * hour / lit / 1e9;
+    double dark_cpu = display_accounts[1].cpu_nanos * hour / dark / 1e9;
+    double lit_spi  = display_accounts[0].spi_bytes * hour / lit / 1e6;
+    double dark_spi = display_accounts[1].spi_bytes * hour / dark / 1e6;
+    ESP_LOGI(TAG, "Display: dark %.0f%% of the time; per hour lit %.1f s of CPU and %.1f MB of SPI, dark %.1f s and "
+                  "%.1f MB, saving %.1f s and %.1f MB",
+             dark * 100 / (lit + dark), lit_cpu, lit_spi, dark_cpu, dark_spi, lit_cpu - dark_cpu, lit_spi - dark_spi);
+}
+
+
+/*
+ * Charges an iteration of the main loop, wait included, to the state the display was in when it began
+ */
+void display_account_loop(uint8_t dark, uint64_t cpu_nanos) {
+    static uint64_t account_start = 0;
+    if (!enabled()) {
+        return;
+    }
+
+    uint64_t now = monotonic_nanos();
+    if (account_start > 0) {
+        display_accounts[dark].wall_nanos += now - account_start;
+        display_accounts[dark].cpu_nanos += cpu_nanos;
+    }
+    account_start = now;
+}
+
+
+/*
+ * SIMULATOR_DISPLAY_ACCOUNT=1 charges CPU time, wall time and the bytes flushed to the display to the lit and dark
+ * states, and reports their cost per hour
+ */
+static uint8_t enabled(void) {
+    static int cached = -1;
+    if (cached < 0) {
+        cached = getenv("SIMULATOR_DISPLAY_ACCOUNT") != NULL;
+    }
+    return (uint8_t)cached;
+}
+
+
+static uint64_t monotonic_nanos(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
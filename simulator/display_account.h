@@ -0,0 +1,14 @@
+#ifndef DISPLAY_ACCOUNT_H_INCLUDED
+#define DISPLAY_ACCOUNT_H_INCLUDED
+
+
+#include <stdint.h>
+#include "lvgl.h"
+
+
+void display_account_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+void display_account_loop(uint8_t dark, uint64_t cpu_nanos);
+void display_account_report(void);
+
+
+#endif
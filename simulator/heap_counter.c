@@ -0,0 +1,60 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "view/view.h"
+#include "heap_counter.h"
+#include "esp_log.h"
+
+
+/*
+ * The linker redirects the allocations of everything built from source here (see LINKFLAGS in SConstruct); shared
+ * libraries such as SDL are not counted
+ */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+
+static const char *TAG = "HeapCounter";
+
+static atomic_ulong allocations = 0;
+
+
+void *__wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+
+void *__wrap_calloc(size_t num, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_calloc(num, size);
+}
+
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+
+unsigned long heap_counter_get_allocations(void) {
+    return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+
+
+/*
+ * With SIMULATOR_HEAP_REPORT=1, logs the allocations since the last report together with the use of the controller
+ * message pool: messages come from static slots, so touches alone should not allocate
+ */
+void heap_counter_report(void) {
+    static unsigned long reported = 0;
+    if (getenv("SIMULATOR_HEAP_REPORT") == NULL) {
+        return;
+    }
+
+    unsigned long               current   = heap_counter_get_allocations();
+    view_controller_msg_stats_t msg_stats = view_controller_msg_get_stats();
+    ESP_LOGI(TAG, "Heap: %lu allocations; controller messages: %zu in flight at most, %u dropped", current - reported,
+             msg_stats.high_water, (unsigned)msg_stats.exhausted);
+    reported = current;
+}
@@ -0,0 +1,9 @@
+#ifndef HEAP_COUNTER_H_INCLUDED
+#define HEAP_COUNTER_H_INCLUDED
+
+
+unsigned long heap_counter_get_allocations(void);
+void          heap_counter_report(void);
+
+
+#endif
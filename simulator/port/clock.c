@@ -0,0 +1,105 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include "services/clock.h"
+
+
+static int64_t real_millis(void);
+static int64_t elapsed_millis(void);
+static void    rebase(int64_t wall_ms);
+
+
+/*
+ * Virtual clock: both wall and monotonic time advance `speed` times faster than the host clock from the last origin.
+ * Jumps move the wall clock only, like an SNTP step does on the device.
+ * Every task reads it, so the origins and the speed are only accessed under `lock`; the helpers below expect it held
+ */
+static pthread_mutex_t lock           = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t         initialized    = 0;
+static uint32_t        speed          = 1;
+static int64_t         real_origin_ms = 0;
+static int64_t         wall_origin_ms = 0;
+static int64_t         mono_origin_ms = 0;
+
+
+time_t clock_now(void) {
+    return (time_t)(clock_now_millis() / 1000);
+}
+
+
+int64_t clock_now_millis(void) {
+    pthread_mutex_lock(&lock);
+    // Sets the origins the first time
+    int64_t elapsed_ms = elapsed_millis();
+    int64_t now_ms     = wall_origin_ms + elapsed_ms;
+    pthread_mutex_unlock(&lock);
+    return now_ms;
+}
+
+
+unsigned long clock_millis(void) {
+    pthread_mutex_lock(&lock);
+    int64_t elapsed_ms = elapsed_millis();
+    int64_t millis     = mono_origin_ms + elapsed_ms;
+    pthread_mutex_unlock(&lock);
+    return (unsigned long)millis;
+}
+
+
+unsigned long clock_to_real_millis(unsigned long millis) {
+    return millis / clock_get_speed();
+}
+
+
+void clock_set_speed(uint32_t new_speed) {
+    assert(new_speed > 0);
+    pthread_mutex_lock(&lock);
+    rebase(wall_origin_ms + elapsed_millis());
+    speed = new_speed;
+    pthread_mutex_unlock(&lock);
+    printf("Virtual clock running at %ux\n", (unsigned)new_speed);
+}
+
+
+void clock_jump_to(time_t timestamp) {
+    pthread_mutex_lock(&lock);
+    rebase((int64_t)timestamp * 1000);
+    pthread_mutex_unlock(&lock);
+    printf("Virtual clock moved to %lli\n", (long long)timestamp);
+}
+
+
+uint32_t clock_get_speed(void) {
+    pthread_mutex_lock(&lock);
+    uint32_t current = speed;
+    pthread_mutex_unlock(&lock);
+    return current;
+}
+
+
+static void rebase(int64_t wall_ms) {
+    int64_t mono_ms = mono_origin_ms + elapsed_millis();
+    real_origin_ms  = real_millis();
+    wall_origin_ms  = wall_ms;
+    mono_origin_ms  = mono_ms;
+}
+
+
+static int64_t elapsed_millis(void) {
+    if (!initialized) {
+        struct timeval tv = {0};
+        gettimeofday(&tv, NULL);
+        initialized    = 1;
+        real_origin_ms = real_millis();
+        wall_origin_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    }
+    return (real_millis() - real_origin_ms) * speed;
+}
+
+
+static int64_t real_millis(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #define ESP_LOGI(tag, format, ...) printf("%s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("%s: " format "\n", tag, ##__VA_ARGS__)
 #define ESP_LOGE(tag, format, ...) printf("%s: " format "\n", tag, ##__VA_ARGS__)
 
-#endif
\ No newline at end of file
+#endif
@@ -1,17 +1,24 @@
 #include "services/github.h"
 
 
-uint8_t github_manage(mut_model_t *pmodel) {
-    (void)pmodel;
+uint8_t github_manage(github_event_t *event) {
+    (void)event;
     return 0;
 }
 
 
-void github_request_latest_release(mut_model_t *pmodel) {
-    (void)pmodel;
+uint8_t github_is_busy(void) {
+    return 0;
+}
+
+
+uint8_t github_request_latest_release(github_event_t *event) {
+    (void)event;
+    return 0;
 }
 
 
-void github_ota(mut_model_t *pmodel) {
-    (void)pmodel;
+uint8_t github_ota(github_event_t *event) {
+    (void)event;
+    return 0;
 }
@@ -1,4 +1,11 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include "services/server.h"
+#include <esp_log.h>
+
+
+static const char *TAG = "Server";
+
 
 void server_init() {}
 
@@ -6,3 +13,32 @@ void server_init() {}
 firmware_update_state_t server_firmware_update_state() {
     return (firmware_update_state_t){.tag = FIRMWARE_UPDATE_STATE_TAG_NONE};
 }
+
+
+/*
+ * Stands in for PUT /alarms: the JSON file named by SIMULATOR_ALARM_IMPORT is imported once, at the first loop
+ */
+uint8_t server_take_alarm_import(alarm_import_t *import) {
+    static uint8_t done = 0;
+    const char    *path = getenv("SIMULATOR_ALARM_IMPORT");
+    if (done || path == NULL) {
+        return 0;
+    }
+    done = 1;
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "Cannot open %s", path);
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long  size = ftell(file);
+    char *json = size > 0 ? malloc(size) : NULL;
+    fseek(file, 0, SEEK_SET);
+    size_t length = json != NULL ? fread(json, 1, size, file) : 0;
+    fclose(file);
+
+    int res = json != NULL ? alarm_import_parse(import, json, length) : -1;
+    free(json);
+    return res == 0;
+}
@@ -11,11 +11,13 @@
 #define DATABASE_FILE ".simulator_db.json"
 
 
-static char database_read[10000] = {0};
+// While a transaction is open the database stays in memory and is written once on commit
+static cJSON *transaction = NULL;
 
 
 static cJSON *read_database();
 static void   write_database(cJSON *json);
+static void   release_database(cJSON *json);
 static int    load_number(double *value, char *key);
 static int    save_number(double value, char *key);
 
@@ -108,14 +110,15 @@ int storage_load_blob(void *value, size_t len, char *key) {
     cJSON *encoded = cJSON_GetObjectItemCaseSensitive(json, key);
     if (!cJSON_IsString(encoded)) {
         printf("Mi aspettavo una stringa (b64) per %s\n", key);
-        cJSON_free(encoded);
-        cJSON_free(json);
+        release_database(json);
         return -1;
     } else {
-        unsigned char *decoded = b64_decode_ex((const char *)encoded->valuestring, strlen(encoded->valuestring), NULL);
-        memcpy(value, decoded, len);
-        cJSON_free(encoded);
-        cJSON_free(json);
+        size_t         decoded_len = 0;
+        unsigned char *decoded =
+            b64_decode_ex((const char *)encoded->valuestring, strlen(encoded->valuestring), &decoded_len);
+        // Blobs may be shorter than the buffer, like NVS allows
+        memcpy(value, decoded, decoded_len < len ? decoded_len : len);
+        release_database(json);
         free(decoded);
         return 0;
     }
@@ -131,12 +134,31 @@ void storage_save_blob(void *value, size_t len, char *key) {
     } else {
         write_database(json);
     }
-    cJSON_free(json);
+    release_database(json);
     free(encoded);
 }
 
 
+void storage_begin_transaction(void) {
+    assert(transaction == NULL);
+    transaction = read_database();
+}
+
+
+void storage_commit_transaction(void) {
+    assert(transaction != NULL);
+    cJSON *json = transaction;
+    transaction = NULL;
+    write_database(json);
+    cJSON_Delete(json);
+}
+
+
 static cJSON *read_database() {
+    if (transaction != NULL) {
+        return transaction;
+    }
+
     FILE *f = fopen(DATABASE_FILE, "r");
     if (f == NULL) {
         printf("Database file non trovato\n");
@@ -147,13 +169,22 @@ static cJSON *read_database() {
     long fsize = ftell(f);
     fseek(f, 0, SEEK_SET); /* same as rewind(f); */
 
-    fread(database_read, 1, fsize, f);
+    char *database_read = malloc(fsize + 1);
+    assert(database_read != NULL);
+    database_read[fread(database_read, 1, fsize, f)] = '\0';
     fclose(f);
-    return cJSON_Parse(database_read);
+
+    cJSON *json = cJSON_Parse(database_read);
+    free(database_read);
+    return json != NULL ? json : cJSON_Parse("{}");
 }
 
 
 static void write_database(cJSON *json) {
+    if (transaction != NULL) {
+        return;
+    }
+
     FILE *f = fopen(DATABASE_FILE, "w");
     if (f == NULL) {
         printf("Non sono riuscito a scrivere il database\n");
@@ -167,17 +198,23 @@ static void write_database(cJSON *json) {
 }
 
 
+static void release_database(cJSON *json) {
+    if (json != transaction) {
+        cJSON_Delete(json);
+    }
+}
+
+
 static int load_number(double *value, char *key) {
     cJSON *json   = read_database();
     cJSON *number = cJSON_GetObjectItemCaseSensitive(json, key);
     if (!cJSON_IsNumber(number)) {
         printf("Mi aspettavo un numero per %s\n", key);
-        cJSON_free(number);
-        cJSON_free(json);
+        release_database(json);
         return -1;
     } else {
-        cJSON_free(json);
         *value = number->valuedouble;
+        release_database(json);
         return 0;
     }
 }
@@ -187,11 +224,11 @@ static int save_number(double value, char *key) {
     cJSON_DeleteItemFromObjectCaseSensitive(json, key);
     if (cJSON_AddNumberToObject(json, key, value) == NULL) {
         printf("Non sono riuscito ad aggiungere %s\n", key);
-        cJSON_free(json);
+        release_database(json);
         return -1;
     } else {
         write_database(json);
-        cJSON_free(json);
+        release_database(json);
         return 0;
     }
 }
@@ -1,6 +1,60 @@
 #include "peripherals/tft.h"
+#include "services/clock.h"
+#include "esp_log.h"
 
 
+static uint32_t interpolate(unsigned long now);
+
+
+static const char *TAG = "Tft";
+
+// The fade in progress, as the LEDC hardware would run it
+static uint32_t      fade_from     = TFT_BACKLIGHT_DUTY_MAX;
+static uint32_t      fade_to       = TFT_BACKLIGHT_DUTY_MAX;
+static unsigned long fade_start_ms = 0;
+static unsigned long fade_ms       = 0;
+
+
+/*
+ * Logs the backlight timeline instead of driving it: every change, where the duty was and when a fade ends
+ */
 void tft_backlight_set(uint8_t percentage) {
+    unsigned long now = clock_millis();
+    fade_from         = tft_backlight_duty(percentage);
+    fade_to           = fade_from;
+    fade_start_ms     = now;
+    fade_ms           = 0;
+    ESP_LOGI(TAG, "Backlight at %lu ms: set to %u%% (duty %u)", now, percentage, (unsigned)fade_to);
 }
 
+
+void tft_backlight_fade(uint8_t percentage, uint32_t millis) {
+    unsigned long now  = clock_millis();
+    uint32_t      duty = tft_backlight_duty(percentage);
+    if (duty == fade_to) {
+        return;
+    }
+
+    fade_from     = interpolate(now);
+    fade_to       = duty;
+    fade_start_ms = now;
+    fade_ms       = millis;
+    ESP_LOGI(TAG, "Backlight at %lu ms: fade from duty %u to %u%% (duty %u), ends at %lu ms", now,
+             (unsigned)fade_from, percentage, (unsigned)fade_to, now + fade_ms);
+}
+
+
+void tft_display_sleep(uint8_t sleep) {
+    ESP_LOGI(TAG, "Panel at %lu ms: sleep %s", clock_millis(), sleep ? "in" : "out");
+}
+
+
+static uint32_t interpolate(unsigned long now) {
+    unsigned long elapsed = now - fade_start_ms;
+    if (elapsed >= fade_ms) {
+        return fade_to;
+    }
+
+    int64_t delta = (int64_t)fade_to - (int64_t)fade_from;
+    return (uint32_t)((int64_t)fade_from + (delta * (int64_t)elapsed) / (int64_t)fade_ms);
+}
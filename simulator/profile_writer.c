@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "config/app_config.h"
+#include "controller/loop_profiler.h"
+#include "profile_writer.h"
+#include "esp_log.h"
+
+
+#if APP_CONFIG_LOOP_PROFILER
+static void write_profile(const char *path);
+
+
+static const char *TAG = "ProfileWriter";
+#endif
+
+
+/*
+ * SIMULATOR_PROFILE=path saves the latest timings of the loop phases as JSON; the profiler itself is enabled by
+ * APP_CONFIG_LOOP_PROFILER
+ */
+void profile_writer_save(void) {
+#if APP_CONFIG_LOOP_PROFILER
+    if (getenv("SIMULATOR_PROFILE") != NULL) {
+        write_profile(getenv("SIMULATOR_PROFILE"));
+    }
+#endif
+}
+
+
+#if APP_CONFIG_LOOP_PROFILER
+static void write_profile(const char *path) {
+    loop_profiler_report_t report = {0};
+    if (!loop_profiler_get_report(&report)) {
+        return;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "Unable to open %s", path);
+        return;
+    }
+
+    fprintf(file, "{\n  \"period_ns\": %llu,\n  \"phases\": {\n", (unsigned long long)report.period);
+    for (size_t i = 0; i < LOOP_PROFILER_PHASE_NUM; i++) {
+        const loop_profiler_stats_t *stats = &report.phases[i];
+        fprintf(file,
+                "    \"%s\": {\"count\": %u, \"p50_ns\": %u, \"p99_ns\": %u, \"max_ns\": %u, \"total_ns\": %llu}%s\n",
+                loop_profiler_phase_name(i), (unsigned)stats->count, (unsigned)stats->p50, (unsigned)stats->p99,
+                (unsigned)stats->max, (unsigned long long)stats->total, i + 1 < LOOP_PROFILER_PHASE_NUM ? "," : "");
+    }
+    fprintf(file, "  }\n}\n");
+    fclose(file);
+}
+#endif
@@ -0,0 +1,8 @@
+#ifndef PROFILE_WRITER_H_INCLUDED
+#define PROFILE_WRITER_H_INCLUDED
+
+
+void profile_writer_save(void);
+
+
+#endif
@@ -1,3 +1,5 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include "FreeRTOS.h"
 #include "model/updater.h"
@@ -6,39 +8,119 @@
 #include "sdl/sdl.h"
 
 #include "model/model.h"
+#include "model/civil_time.h"
+#include "config/app_config.h"
+#include "services/clock.h"
 #include "view/view.h"
 #include "controller/controller.h"
 #include "controller/gui.h"
 #include "controller/persistance.h"
+#include "controller/wakeup.h"
+#include "heap_counter.h"
+#include "command_recorder.h"
+#include "benchmark.h"
+#include "profile_writer.h"
+#include "display_account.h"
+
+
+// How often the CPU time spent in the main loop is reported
+#define CPU_REPORT_PERIOD_SECONDS 10
 
 
 static const char *TAG = "Main";
 
 
+static uint64_t thread_cpu_nanos(void);
+static uint64_t monotonic_nanos(void);
+
+
 void app_main(void *arg) {
     (void)arg;
 
     mut_model_t model = {0};
 
+    setenv("TZ", APP_CONFIG_TIMEZONE, 1);
+    tzset();
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+
+    // e.g. SIMULATOR_CLOCK_START=1700000000 SIMULATOR_CLOCK_SPEED=600 runs a week in about 17 minutes
+    if (getenv("SIMULATOR_CLOCK_START") != NULL) {
+        clock_jump_to((time_t)strtoll(getenv("SIMULATOR_CLOCK_START"), NULL, 10));
+    }
+    if (getenv("SIMULATOR_CLOCK_SPEED") != NULL && atoi(getenv("SIMULATOR_CLOCK_SPEED")) > 0) {
+        clock_set_speed(atoi(getenv("SIMULATOR_CLOCK_SPEED")));
+    }
+
+    benchmark_run();
+
     lv_init();
     sdl_init();
 
     model_updater_t updater = model_updater_init(&model);
-    persistance_load(&model);
-    view_init(updater, controller_process_message, sdl_display_flush, sdl_mouse_read);
-    controller_init(updater);
+    persistance_load(updater);
 
+    command_recorder_init(updater);
 
-    struct tm tm = {.tm_mday = 8, .tm_mon = 8, .tm_year = 123};
-    model.config.num_alarms = 1;
-    model.config.alarms[0].timestamp = mktime(&tm);
+    view_init(updater, controller_process_message, display_account_flush, sdl_mouse_read);
+    controller_init(updater);
 
     ESP_LOGI(TAG, "Begin main loop");
+    uint64_t cpu_nanos = 0;
+    // Wall time of an iteration, i.e. how long input and rendering wait for the loop
+    uint64_t frame_nanos  = 0;
+    uint64_t frame_max    = 0;
+    uint32_t loops        = 0;
+    time_t   report_start = time(NULL);
     for (;;) {
-        controller_manage(updater);
+        uint8_t       dark        = controller_gui_is_dark();
+        uint64_t      start       = thread_cpu_nanos();
+        uint64_t      frame_start = monotonic_nanos();
+        unsigned long wait        = controller_manage(updater);
+        uint64_t      frame       = monotonic_nanos() - frame_start;
+        uint64_t      cpu         = thread_cpu_nanos() - start;
+        cpu_nanos += cpu;
+        frame_nanos += frame;
+        frame_max = frame > frame_max ? frame : frame_max;
+        loops++;
+
+        time_t elapsed = time(NULL) - report_start;
+        if (elapsed >= CPU_REPORT_PERIOD_SECONDS) {
+            uint64_t period_nanos = (uint64_t)elapsed * 1000000000ULL;
+            ESP_LOGI(TAG, "Main loop: %u iterations/s, %llu ns of CPU time each, %u%% idle, simulated time %lli",
+                     (unsigned)(loops / elapsed), (unsigned long long)(cpu_nanos / loops),
+                     (unsigned)(100 - (cpu_nanos * 100) / period_nanos), (long long)clock_now());
+            ESP_LOGI(TAG, "Frame latency: %llu us on average, %llu us at most",
+                     (unsigned long long)(frame_nanos / loops / 1000), (unsigned long long)(frame_max / 1000));
+            heap_counter_report();
+            ESP_LOGI(TAG, "View events: %u dropped", (unsigned)view_get_dropped_events());
+            display_account_report();
+            cpu_nanos    = 0;
+            frame_nanos  = 0;
+            frame_max    = 0;
+            loops        = 0;
+            report_start = time(NULL);
+
+            command_recorder_save();
+            profile_writer_save();
+        }
 
-        vTaskDelay(pdMS_TO_TICKS(5));
+        wakeup_wait(wait);
+        display_account_loop(dark, cpu);
     }
 
     vTaskDelete(NULL);
 }
+
+
+static uint64_t thread_cpu_nanos(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+static uint64_t monotonic_nanos(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
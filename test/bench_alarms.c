@@ -0,0 +1,219 @@
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "fake_clock.h"
+#include "test.h"
+
+
+#define CHANGES 200000
+#define LISTS   2000
+#define QUERIES 1000000
+// Work of the passes over the whole table, in alarms visited, so that every size takes about the same time
+#define VISITS 20000000UL
+
+
+static void     fill(model_updater_t updater, model_t *pmodel, size_t count, time_t now);
+static double   bench_set_alarm_time(model_updater_t updater, model_t *pmodel, time_t now);
+static double   bench_rebuild(mut_model_t *pmodel, time_t now);
+static double   bench_day(model_t *pmodel, time_t now, size_t *count);
+static double   bench_next_alarm(model_t *pmodel, time_t now);
+static double   bench_next_alarm_scan(model_t *pmodel, time_t now);
+static double   bench_nth_today(model_t *pmodel);
+static double   bench_today_count(model_t *pmodel);
+static double   bench_in_progress(model_t *pmodel, time_t now);
+static double   bench_reuse(model_updater_t updater, model_t *pmodel, time_t now);
+static uint32_t next_random(void);
+
+
+static const size_t sizes[] = {64, 1000, 10000};
+static uint32_t     seed    = 12345;
+// Keeps the results of the queries alive
+static volatile size_t sink = 0;
+
+
+/*
+ * Microseconds per change of a single alarm and per query at a few table sizes, with the alarms spread over a month.
+ * A scan of the whole table for the next alarm, as the queries did before the index, is timed alongside.
+ * The Makefile raises APP_CONFIG_ALARM_STORE_BUDGET so that the largest table fits
+ */
+int main(void) {
+    static struct model models[sizeof(sizes) / sizeof(sizes[0])];
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+    time_t now        = 1711627200;     // 2024-03-28 12:00 UTC
+    fake_clock_millis = (int64_t)now * 1000;
+    civil_time_prepare_local(now);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        mut_model_t    *pmodel  = &models[i];
+        model_updater_t updater = model_updater_init(pmodel);
+        fill(updater, pmodel, sizes[i], now);
+
+        printf("%zu alarms, %zu today\n", (size_t)pmodel->config.num_alarms, model_get_today_alarms_count(pmodel));
+        printf("  %-28s %9.3f us\n", "model_updater_set_alarm_time", bench_set_alarm_time(updater, pmodel, now));
+        printf("  %-28s %9.3f us\n", "full index pass", bench_rebuild(pmodel, now));
+        size_t count = 0;
+        double day   = bench_day(pmodel, now, &count);
+        printf("  %-28s %9.3f us (%zu alarms)\n", "model_get_day_alarms", day, count);
+        printf("  %-28s %9.3f us\n", "model_get_next_alarm_after", bench_next_alarm(pmodel, now));
+        printf("  %-28s %9.3f us\n", "next alarm by a scan", bench_next_alarm_scan(pmodel, now));
+        printf("  %-28s %9.3f us\n", "model_get_nth_today_alarm", bench_nth_today(pmodel));
+        printf("  %-28s %9.3f us\n", "model_get_today_alarms_count", bench_today_count(pmodel));
+        printf("  %-28s %9.3f us\n", "model_get_alarms_in_progress", bench_in_progress(pmodel, now));
+        // Last, as it changes the alarms
+        printf("  %-28s %9.3f us\n", "expire or delete, then add", bench_reuse(updater, pmodel, now));
+    }
+    return 0;
+}
+
+
+static void fill(model_updater_t updater, model_t *pmodel, size_t count, time_t now) {
+    while (pmodel->config.num_alarms < count) {
+        time_t    timestamp = now - 86400 + next_random() % (30 * 86400);
+        struct tm tm        = civil_time_localtime(timestamp);
+        int       alarm_num = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+        if (alarm_num < 0) {
+            printf("Alarm table full at %zu alarms\n", (size_t)pmodel->config.num_alarms);
+            break;
+        }
+        model_updater_set_alarm_time(updater, alarm_num, timestamp);
+        model_updater_set_alarm_duration(updater, alarm_num, next_random() % 4 == 0 ? 120 : 0);
+        // Without descriptions, so that the table takes the whole budget
+        model_updater_set_alarm_description(updater, alarm_num, "");
+    }
+}
+
+
+static double bench_set_alarm_time(model_updater_t updater, model_t *pmodel, time_t now) {
+    double start = test_seconds();
+    for (size_t i = 0; i < CHANGES; i++) {
+        size_t alarm_num = next_random() % pmodel->config.num_alarms;
+        // Mostly small moves, as when the time of an alarm is edited, and some across the month
+        time_t timestamp = next_random() % 4 == 0 ? now + next_random() % (30 * 86400)
+                                                  : pmodel->config.alarms[alarm_num].timestamp + 60;
+        model_updater_set_alarm_time(updater, alarm_num, timestamp);
+    }
+    return (test_seconds() - start) * 1e6 / CHANGES;
+}
+
+
+static double bench_rebuild(mut_model_t *pmodel, time_t now) {
+    size_t rebuilds = VISITS / pmodel->config.num_alarms;
+    double start    = test_seconds();
+    for (size_t i = 0; i < rebuilds; i++) {
+        model_rebuild_today_alarms(pmodel, now);
+    }
+    return (test_seconds() - start) * 1e6 / rebuilds;
+}
+
+
+static double bench_day(model_t *pmodel, time_t now, size_t *count) {
+    static size_t alarms[UINT16_MAX];
+    struct tm     tm    = civil_time_localtime(now + 86400);
+    double        start = test_seconds();
+    for (size_t i = 0; i < LISTS; i++) {
+        *count = model_get_day_alarms(pmodel, tm.tm_mday, tm.tm_mon, tm.tm_year, alarms, UINT16_MAX);
+    }
+    return (test_seconds() - start) * 1e6 / LISTS;
+}
+
+
+static double bench_next_alarm(model_t *pmodel, time_t now) {
+    double start = test_seconds();
+    for (size_t i = 0; i < QUERIES; i++) {
+        size_t   alarm_num  = 0;
+        uint64_t occurrence = 0;
+        model_get_next_alarm_after(pmodel, now + next_random() % (30 * 86400), &alarm_num, &occurrence);
+        sink += alarm_num;
+    }
+    return (test_seconds() - start) * 1e6 / QUERIES;
+}
+
+
+/*
+ * The earliest occurrence after the timestamp, checking every alarm
+ */
+static double bench_next_alarm_scan(model_t *pmodel, time_t now) {
+    size_t queries = VISITS / pmodel->config.num_alarms;
+    double start   = test_seconds();
+    for (size_t i = 0; i < queries; i++) {
+        uint64_t timestamp = now + next_random() % (30 * 86400);
+        uint64_t best      = UINT64_MAX;
+        size_t   alarm_num = 0;
+        for (size_t num = 0; num < pmodel->config.num_alarms; num++) {
+            uint64_t occurrence = pmodel->run.occurrences[num];
+            if (occurrence > timestamp && occurrence < best) {
+                best      = occurrence;
+                alarm_num = num;
+            }
+        }
+        sink += alarm_num;
+    }
+    return (test_seconds() - start) * 1e6 / queries;
+}
+
+
+static double bench_nth_today(model_t *pmodel) {
+    size_t today = model_get_today_alarms_count(pmodel);
+    double start = test_seconds();
+    for (size_t i = 0; i < QUERIES; i++) {
+        size_t alarm_num = 0;
+        model_get_nth_today_alarm(pmodel, &alarm_num, today > 0 ? next_random() % today : 0);
+        sink += alarm_num;
+    }
+    return (test_seconds() - start) * 1e6 / QUERIES;
+}
+
+
+static double bench_today_count(model_t *pmodel) {
+    double start = test_seconds();
+    for (size_t i = 0; i < QUERIES; i++) {
+        sink += model_get_today_alarms_count(pmodel);
+    }
+    return (test_seconds() - start) * 1e6 / QUERIES;
+}
+
+
+/*
+ * As the main page asks for the running events, at random times of the month
+ */
+static double bench_in_progress(model_t *pmodel, time_t now) {
+    size_t alarms[16];
+    double start = test_seconds();
+    for (size_t i = 0; i < QUERIES; i++) {
+        sink += model_get_alarms_in_progress(pmodel, now + next_random() % (30 * 86400), alarms, 16);
+    }
+    return (test_seconds() - start) * 1e6 / QUERIES;
+}
+
+
+/*
+ * An alarm expires or gets deleted and a new one takes its slot, as in a table kept full over months: both changes
+ * move an alarm across the index
+ */
+static double bench_reuse(model_updater_t updater, model_t *pmodel, time_t now) {
+    double start = test_seconds();
+    for (size_t i = 0; i < CHANGES; i++) {
+        size_t alarm_num = next_random() % pmodel->config.num_alarms;
+        if (next_random() % 2 == 0) {
+            model_updater_delete_alarm(updater, alarm_num);
+        } else {
+            model_updater_set_alarm_time(updater, alarm_num, now - 2 * 86400);
+        }
+
+        time_t    timestamp = now + 3600 + next_random() % (30 * 86400);
+        struct tm tm        = civil_time_localtime(timestamp);
+        int       added     = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+        if (added >= 0) {
+            model_updater_set_alarm_time(updater, added, timestamp);
+        }
+    }
+    return (test_seconds() - start) * 1e6 / CHANGES;
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
@@ -0,0 +1,156 @@
+#include <string.h>
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "fake_clock.h"
+#include "test.h"
+
+
+#define PASSES  1000000
+#define WATCHED 56
+// Alarms watched by their contents
+#define ALARMS 8
+
+
+// A watched part of the model, as both the view and the observer keep them
+typedef struct {
+    const void   *memory;
+    size_t        size;
+    uint8_t      *copy;
+    model_field_t field;
+} watched_t;
+
+
+static void   watch(model_t *pmodel);
+static double bench(model_updater_t updater, model_t *pmodel, size_t (*pass)(model_t *), size_t period,
+                    size_t *notified);
+static size_t pass_memcmp(model_t *pmodel);
+static size_t pass_generation(model_t *pmodel);
+
+
+static watched_t watched[WATCHED];
+static uint32_t  generation = 0;
+
+
+/*
+ * Nanoseconds per loop to find the changes among 56 watched entries: copying and comparing their memory, as the
+ * watcher did, against the generation counters. Idle, then with a change every 64 loops
+ */
+int main(void) {
+    static struct model model;
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+    time_t now        = 1711627200;     // 2024-03-28 12:00 UTC
+    fake_clock_millis = (int64_t)now * 1000;
+    civil_time_prepare_local(now);
+
+    model_updater_t updater = model_updater_init(&model);
+    for (size_t i = 0; i < ALARMS; i++) {
+        struct tm tm = civil_time_localtime(now + i * 86400);
+        model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+    }
+    watch(&model);
+
+    printf("%u watched entries\n", WATCHED);
+    size_t memcmp_notified = 0, generation_notified = 0;
+    double idle_memcmp     = bench(updater, &model, pass_memcmp, 0, &memcmp_notified);
+    double idle_generation = bench(updater, &model, pass_generation, 0, &generation_notified);
+    printf("%-28s %7.2f ns (%zu notified)\n", "memcmp, idle", idle_memcmp, memcmp_notified);
+    printf("%-28s %7.2f ns (%zu notified)\n", "generation, idle", idle_generation, generation_notified);
+
+    double busy_memcmp     = bench(updater, &model, pass_memcmp, 64, &memcmp_notified);
+    double busy_generation = bench(updater, &model, pass_generation, 64, &generation_notified);
+    printf("%-28s %7.2f ns (%zu notified)\n", "memcmp, change every 64", busy_memcmp, memcmp_notified);
+    printf("%-28s %7.2f ns (%zu notified)\n", "generation, change every 64", busy_generation, generation_notified);
+    return 0;
+}
+
+
+/*
+ * The tracked fields in turn, as several pages and the observer watching the same parts of the model
+ */
+static void watch(model_t *pmodel) {
+    static uint8_t copies[WATCHED * sizeof(alarm_t) * ALARMS];
+    const struct {
+        const void   *memory;
+        size_t        size;
+        model_field_t field;
+    } fields[] = {
+        {&pmodel->config.military_time, sizeof(pmodel->config.military_time), MODEL_FIELD_MILITARY_TIME},
+        {&pmodel->config.normal_brightness, sizeof(pmodel->config.normal_brightness), MODEL_FIELD_NORMAL_BRIGHTNESS},
+        {&pmodel->config.standby_brightness, sizeof(pmodel->config.standby_brightness),
+         MODEL_FIELD_STANDBY_BRIGHTNESS},
+        {&pmodel->config.standby_delay_seconds, sizeof(pmodel->config.standby_delay_seconds),
+         MODEL_FIELD_STANDBY_DELAY},
+        {&pmodel->config.night_mode, sizeof(pmodel->config.night_mode), MODEL_FIELD_NIGHT_MODE},
+        {&pmodel->config.night_mode_start, sizeof(pmodel->config.night_mode_start), MODEL_FIELD_NIGHT_MODE_START},
+        {&pmodel->config.night_mode_end, sizeof(pmodel->config.night_mode_end), MODEL_FIELD_NIGHT_MODE_END},
+        {&pmodel->config.num_alarms, sizeof(pmodel->config.num_alarms), MODEL_FIELD_NUM_ALARMS},
+        {pmodel->config.alarms, sizeof(alarm_t) * ALARMS, MODEL_FIELD_ALARMS},
+        {&pmodel->run.wifi_state, sizeof(pmodel->run.wifi_state), MODEL_FIELD_WIFI_STATE},
+        {&pmodel->run.scanning, sizeof(pmodel->run.scanning), MODEL_FIELD_SCANNING},
+        {pmodel->run.ap_list, sizeof(pmodel->run.ap_list[0]) * 4, MODEL_FIELD_AP_LIST},
+        {&pmodel->run.latest_release_major, sizeof(uint16_t) * 3, MODEL_FIELD_LATEST_RELEASE},
+        {&pmodel->run.client_firmware_update_state, sizeof(firmware_update_state_t),
+         MODEL_FIELD_FIRMWARE_UPDATE_STATE},
+        {&pmodel->run.night.active, sizeof(pmodel->run.night.active), MODEL_FIELD_NIGHT_MODE_ACTIVE},
+        {&pmodel->config.world_clock, sizeof(pmodel->config.world_clock), MODEL_FIELD_WORLD_CLOCK},
+        {&pmodel->config.solar_schedule, sizeof(pmodel->config.solar_schedule), MODEL_FIELD_SOLAR_SCHEDULE},
+    };
+
+    uint8_t *copy = copies;
+    for (size_t i = 0; i < WATCHED; i++) {
+        size_t field      = i % (sizeof(fields) / sizeof(fields[0]));
+        watched[i].memory = fields[field].memory;
+        watched[i].size   = fields[field].size;
+        watched[i].copy   = copy;
+        watched[i].field  = fields[field].field;
+        memcpy(copy, fields[field].memory, fields[field].size);
+        copy += fields[field].size;
+    }
+    generation = model_get_generation(pmodel);
+}
+
+
+/*
+ * Runs `pass` PASSES times, changing the normal brightness every `period` passes if not 0. Returns the nanoseconds
+ * per pass, changes included
+ */
+static double bench(model_updater_t updater, model_t *pmodel, size_t (*pass)(model_t *), size_t period,
+                    size_t *notified) {
+    *notified    = 0;
+    double start = test_seconds();
+    for (size_t i = 0; i < PASSES; i++) {
+        if (period > 0 && i % period == 0) {
+            model_updater_set_normal_brightness(updater, pmodel->config.normal_brightness == 50 ? 60 : 50);
+        }
+        *notified += pass(pmodel);
+    }
+    return (test_seconds() - start) * 1e9 / PASSES;
+}
+
+
+static size_t pass_memcmp(model_t *pmodel) {
+    (void)pmodel;
+    size_t notified = 0;
+    for (size_t i = 0; i < WATCHED; i++) {
+        if (memcmp(watched[i].copy, watched[i].memory, watched[i].size) != 0) {
+            memcpy(watched[i].copy, watched[i].memory, watched[i].size);
+            notified++;
+        }
+    }
+    return notified;
+}
+
+
+static size_t pass_generation(model_t *pmodel) {
+    size_t   notified = 0;
+    uint32_t changes  = model_get_changes(pmodel, &generation);
+    if (changes) {
+        for (size_t i = 0; i < WATCHED; i++) {
+            if (changes & MODEL_FIELD_MASK(watched[i].field)) {
+                notified++;
+            }
+        }
+    }
+    return notified;
+}
@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include "model/civil_time.h"
+#include "test.h"
+
+
+#define ZONE       "UTC-1CEST,M3.5.0,M10.5.0/3"
+#define FIRST_YEAR 2020
+#define SAMPLES    2000000
+// Odd step in seconds, so that the samples stay within the two years the zone caches
+#define STEP 13
+
+
+static double bench_civil_time_from_epoch(const civil_time_zone_t *zone, int64_t first);
+static double bench_localtime_r(int64_t first);
+static double bench_civil_time_to_epoch(const civil_time_zone_t *zone, int64_t first);
+static double bench_mktime(int64_t first);
+
+
+// Keeps the results alive, so that the conversions are not optimized out
+static volatile int64_t sink = 0;
+
+
+/*
+ * Nanoseconds per conversion of civil_time against the glibc functions it replaces, in the configured zone
+ */
+int main(void) {
+    civil_time_zone_t zone = {0};
+    if (civil_time_zone_parse(&zone, ZONE) != 0) {
+        printf("Invalid zone %s\n", ZONE);
+        return 1;
+    }
+    setenv("TZ", ZONE, 1);
+    tzset();
+
+    int64_t first = civil_time_days_from_civil(FIRST_YEAR, 1, 1) * 86400;
+    civil_time_zone_prepare(&zone, first);
+
+    printf("%-24s %7.1f ns\n", "civil_time_from_epoch", bench_civil_time_from_epoch(&zone, first));
+    printf("%-24s %7.1f ns\n", "localtime_r", bench_localtime_r(first));
+    printf("%-24s %7.1f ns\n", "civil_time_to_epoch", bench_civil_time_to_epoch(&zone, first));
+    printf("%-24s %7.1f ns\n", "mktime", bench_mktime(first));
+    return 0;
+}
+
+
+static double bench_civil_time_from_epoch(const civil_time_zone_t *zone, int64_t first) {
+    double start = test_seconds();
+    for (int64_t i = 0; i < SAMPLES; i++) {
+        struct tm tm = civil_time_from_epoch(zone, first + i * STEP);
+        sink += tm.tm_min;
+    }
+    return (test_seconds() - start) * 1e9 / SAMPLES;
+}
+
+
+static double bench_localtime_r(int64_t first) {
+    double start = test_seconds();
+    for (int64_t i = 0; i < SAMPLES; i++) {
+        time_t    timestamp = (time_t)(first + i * STEP);
+        struct tm tm        = {0};
+        localtime_r(&timestamp, &tm);
+        sink += tm.tm_min;
+    }
+    return (test_seconds() - start) * 1e9 / SAMPLES;
+}
+
+
+static double bench_civil_time_to_epoch(const civil_time_zone_t *zone, int64_t first) {
+    struct tm base  = civil_time_from_epoch(zone, first);
+    double    start = test_seconds();
+    for (int64_t i = 0; i < SAMPLES; i++) {
+        struct tm tm = base;
+        tm.tm_isdst  = -1;
+        tm.tm_min += (int)(i % 100000);
+        sink += civil_time_to_epoch(zone, &tm);
+    }
+    return (test_seconds() - start) * 1e9 / SAMPLES;
+}
+
+
+static double bench_mktime(int64_t first) {
+    time_t    timestamp = (time_t)first;
+    struct tm base      = {0};
+    localtime_r(&timestamp, &base);
+    double start = test_seconds();
+    for (int64_t i = 0; i < SAMPLES; i++) {
+        struct tm tm = base;
+        tm.tm_isdst  = -1;
+        tm.tm_min += (int)(i % 100000);
+        sink += mktime(&tm);
+    }
+    return (test_seconds() - start) * 1e9 / SAMPLES;
+}
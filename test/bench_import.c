@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "controller/persistance.h"
+#include "fake_clock.h"
+#include "fake_storage.h"
+#include "test.h"
+
+
+#define RECORDS 500
+
+
+static double   import_one_by_one(model_updater_t updater, const alarm_record_t *records, size_t count);
+static double   import_batch(model_updater_t updater, const alarm_record_t *records, size_t count);
+static void     save_num_alarms(model_t *pmodel);
+static uint8_t  same_alarms(model_t *first, model_t *second);
+static uint32_t next_random(void);
+
+
+static uint32_t seed = 12345;
+
+
+/*
+ * 500 alarms imported as the alarm page adds them, each saved along with the number of alarms, and as PUT /alarms
+ * does, in a batch saved in a single transaction. Storage is in memory, so the times are those of the model and the
+ * commits are counted: on the device every commit is a write to flash
+ */
+int main(void) {
+    static struct model one_by_one, batch, loaded;
+    static char         descriptions[RECORDS][32];
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+    time_t now        = 1711627200;     // 2024-03-28 12:00 UTC
+    fake_clock_millis = (int64_t)now * 1000;
+    civil_time_prepare_local(now);
+
+    alarm_record_t records[RECORDS];
+    for (size_t i = 0; i < RECORDS; i++) {
+        snprintf(descriptions[i], sizeof(descriptions[i]), "Imported %zu", i);
+        records[i] = (alarm_record_t){
+            .timestamp   = now + 3600 + (next_random() % (30 * 24 * 60)) * 60,
+            .recurrence  = i % 10 == 0 ? ALARM_RECURRENCE_DAILY : ALARM_RECURRENCE_NONE,
+            .duration    = next_random() % 4 == 0 ? 60 : 0,
+            .description = descriptions[i],
+        };
+    }
+
+    fake_storage_clear();
+    double               one_by_one_us    = import_one_by_one(model_updater_init(&one_by_one), records, RECORDS);
+    fake_storage_stats_t one_by_one_stats = fake_storage_stats;
+
+    fake_storage_clear();
+    double               batch_us    = import_batch(model_updater_init(&batch), records, RECORDS);
+    fake_storage_stats_t batch_stats = fake_storage_stats;
+
+    // What the batch left in storage is what the next boot finds
+    persistance_load(model_updater_init(&loaded));
+
+    TEST_CHECK(one_by_one.config.num_alarms == RECORDS && batch.config.num_alarms == RECORDS,
+               "%u and %u alarms imported", one_by_one.config.num_alarms, batch.config.num_alarms);
+    TEST_CHECK(same_alarms(&one_by_one, &batch), "the imports differ");
+    TEST_CHECK(same_alarms(&batch, &loaded), "the batch was not saved as imported");
+    TEST_CHECK(one_by_one_stats.commits == 2 * RECORDS, "%zu commits one by one", one_by_one_stats.commits);
+    TEST_CHECK(batch_stats.commits == 1 && batch_stats.saves == RECORDS + 1, "%zu commits and %zu saves in a batch",
+               batch_stats.commits, batch_stats.saves);
+
+    printf("%-12s %9.1f us %5zu saves %5zu commits\n", "one by one", one_by_one_us, one_by_one_stats.saves,
+           one_by_one_stats.commits);
+    printf("%-12s %9.1f us %5zu saves %5zu commits\n", "batch", batch_us, batch_stats.saves, batch_stats.commits);
+    return test_report("import");
+}
+
+
+/*
+ * As the alarm page: a new alarm on the day, then its fields, saved right away like the count the observer keeps
+ */
+static double import_one_by_one(model_updater_t updater, const alarm_record_t *records, size_t count) {
+    model_t *pmodel = model_updater_read(updater);
+    double   start  = test_seconds();
+
+    for (size_t i = 0; i < count; i++) {
+        struct tm tm        = civil_time_localtime(records[i].timestamp);
+        int       alarm_num = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+        if (alarm_num < 0) {
+            break;
+        }
+        model_updater_set_alarm_time(updater, alarm_num, records[i].timestamp);
+        model_updater_set_alarm_recurrence(updater, alarm_num, records[i].recurrence, records[i].weekdays);
+        model_updater_set_alarm_duration(updater, alarm_num, records[i].duration);
+        model_updater_set_alarm_description(updater, alarm_num, records[i].description);
+        persistance_save_alarm(pmodel, alarm_num);
+        save_num_alarms(pmodel);
+    }
+
+    return (test_seconds() - start) * 1e6;
+}
+
+
+/*
+ * As the controller imports the alarms of PUT /alarms
+ */
+static double import_batch(model_updater_t updater, const alarm_record_t *records, size_t count) {
+    model_t *pmodel = model_updater_read(updater);
+    double   start  = test_seconds();
+
+    model_updater_begin_alarm_batch(updater);
+    for (size_t i = 0; i < count; i++) {
+        model_updater_batch_add_alarm(updater, &records[i]);
+    }
+    const uint16_t *alarms   = NULL;
+    size_t          imported = model_updater_commit_alarm_batch(updater, &alarms);
+
+    persistance_begin_transaction();
+    for (size_t i = 0; i < imported; i++) {
+        persistance_save_alarm(pmodel, alarms[i]);
+    }
+    save_num_alarms(pmodel);
+    persistance_commit_transaction();
+
+    return (test_seconds() - start) * 1e6;
+}
+
+
+static void save_num_alarms(model_t *pmodel) {
+    persistance_save_variable(&pmodel->config.num_alarms, sizeof(pmodel->config.num_alarms),
+                              PERSISTANCE_ALARM_NUM_KEY);
+}
+
+
+/*
+ * The same alarms in the same slots
+ */
+static uint8_t same_alarms(model_t *first, model_t *second) {
+    if (first->config.num_alarms != second->config.num_alarms) {
+        return 0;
+    }
+    for (size_t num = 0; num < first->config.num_alarms; num++) {
+        alarm_t a = model_get_alarm(first, num);
+        alarm_t b = model_get_alarm(second, num);
+        if (a.timestamp != b.timestamp || a.recurrence != b.recurrence || a.weekdays != b.weekdays ||
+            a.duration != b.duration ||
+            strcmp(model_get_alarm_description(first, num), model_get_alarm_description(second, num)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
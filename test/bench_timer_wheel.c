@@ -0,0 +1,81 @@
+#include <limits.h>
+#include "controller/timer_wheel.h"
+#include "test.h"
+
+
+#define JOBS        4096
+#define RESTARTS    4000000
+// One hour of main loop iterations, waking up at every timeout
+#define LOOP_MS     (60UL * 60 * 1000)
+#define MAX_PERIOD  (10UL * 60 * 1000)
+
+
+static double                bench_restart(void);
+static double                bench_loop(size_t *iterations, size_t *runs);
+static uint32_t              next_random(void);
+static timer_wheel_outcome_t job_cb(void *arg);
+
+
+static timer_wheel_t     wheel;
+static timer_wheel_job_t jobs[JOBS];
+static uint32_t          seed = 12345;
+
+
+/*
+ * Nanoseconds per operation with JOBS jobs armed: restarting a job (what the touch driver does to the standby job at
+ * every touch) and one iteration of a loop that dispatches and then asks for the timeout
+ */
+int main(void) {
+    size_t iterations = 0, runs = 0;
+    printf("%-28s %7.1f ns\n", "timer_wheel_start", bench_restart());
+    double loop = bench_loop(&iterations, &runs);
+    printf("%-28s %7.1f ns (%zu iterations, %zu jobs run)\n", "dispatch + get_timeout", loop, iterations, runs);
+    return 0;
+}
+
+
+static double bench_restart(void) {
+    timer_wheel_init(&wheel, 0);
+    for (size_t i = 0; i < JOBS; i++) {
+        timer_wheel_job_init(&jobs[i], job_cb, NULL, 0, 0, 0, 0);
+        timer_wheel_start(&wheel, &jobs[i], 1 + next_random() % MAX_PERIOD, 0);
+    }
+
+    double start = test_seconds();
+    for (size_t i = 0; i < RESTARTS; i++) {
+        timer_wheel_start(&wheel, &jobs[i % JOBS], 1 + (i * 7919) % MAX_PERIOD, i / 1000);
+    }
+    return (test_seconds() - start) * 1e9 / RESTARTS;
+}
+
+
+static double bench_loop(size_t *iterations, size_t *runs) {
+    timer_wheel_init(&wheel, 0);
+    for (size_t i = 0; i < JOBS; i++) {
+        timer_wheel_job_init(&jobs[i], job_cb, NULL, 1000 + next_random() % MAX_PERIOD, 100, 0, 0);
+        timer_wheel_start(&wheel, &jobs[i], next_random() % MAX_PERIOD, 0);
+    }
+
+    unsigned long now   = 0;
+    double        start = test_seconds();
+    while (now < LOOP_MS) {
+        *runs += timer_wheel_dispatch(&wheel, now);
+        now += timer_wheel_get_timeout(&wheel, now);
+        (*iterations)++;
+    }
+    return (test_seconds() - start) * 1e9 / *iterations;
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+
+static timer_wheel_outcome_t job_cb(void *arg) {
+    (void)arg;
+    return TIMER_WHEEL_JOB_DONE;
+}
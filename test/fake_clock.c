@@ -0,0 +1,26 @@
+#include "services/clock.h"
+#include "fake_clock.h"
+
+
+int64_t  fake_clock_millis = 0;
+uint32_t fake_clock_speed  = 1;
+
+
+time_t clock_now(void) {
+    return (time_t)(fake_clock_millis / 1000);
+}
+
+
+int64_t clock_now_millis(void) {
+    return fake_clock_millis;
+}
+
+
+unsigned long clock_millis(void) {
+    return (unsigned long)fake_clock_millis;
+}
+
+
+unsigned long clock_to_real_millis(unsigned long millis) {
+    return millis / fake_clock_speed;
+}
@@ -0,0 +1,14 @@
+#ifndef FAKE_CLOCK_H_INCLUDED
+#define FAKE_CLOCK_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// What services/clock.h reads in the host tests, in milliseconds since the epoch
+extern int64_t fake_clock_millis;
+// How many times faster than real time it runs, see clock_to_real_millis
+extern uint32_t fake_clock_speed;
+
+
+#endif
@@ -0,0 +1,141 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peripherals/storage.h"
+#include "fake_storage.h"
+
+
+#define MAX_KEYS 4096
+
+
+// Keys and values as NVS keeps them, every value as a blob
+static struct {
+    char    key[16];
+    size_t   len;
+    uint8_t *value;
+} entries[MAX_KEYS];
+static size_t  num_entries      = 0;
+static uint8_t transaction_open = 0;
+
+fake_storage_stats_t fake_storage_stats = {0};
+
+
+static int  load(void *value, size_t len, const char *key);
+static void save(const void *value, size_t len, const char *key);
+
+
+void fake_storage_clear(void) {
+    for (size_t i = 0; i < num_entries; i++) {
+        free(entries[i].value);
+        entries[i].value = NULL;
+    }
+    num_entries        = 0;
+    transaction_open   = 0;
+    fake_storage_stats = (fake_storage_stats_t){0};
+}
+
+
+void storage_init(void) {}
+
+
+int storage_load_uint8(uint8_t *value, char *key) {
+    return load(value, sizeof(*value), key);
+}
+
+
+void storage_save_uint8(uint8_t *value, char *key) {
+    save(value, sizeof(*value), key);
+}
+
+
+int storage_load_uint16(uint16_t *value, char *key) {
+    return load(value, sizeof(*value), key);
+}
+
+
+void storage_save_uint16(uint16_t *value, char *key) {
+    save(value, sizeof(*value), key);
+}
+
+
+int storage_load_uint32(uint32_t *value, char *key) {
+    return load(value, sizeof(*value), key);
+}
+
+
+void storage_save_uint32(uint32_t *value, char *key) {
+    save(value, sizeof(*value), key);
+}
+
+
+int storage_load_uint64(uint64_t *value, char *key) {
+    return load(value, sizeof(*value), key);
+}
+
+
+void storage_save_uint64(uint64_t *value, char *key) {
+    save(value, sizeof(*value), key);
+}
+
+
+int storage_load_blob(void *value, size_t len, char *key) {
+    return load(value, len, key);
+}
+
+
+void storage_save_blob(void *value, size_t len, char *key) {
+    save(value, len, key);
+}
+
+
+void storage_begin_transaction(void) {
+    assert(!transaction_open);
+    transaction_open = 1;
+}
+
+
+void storage_commit_transaction(void) {
+    assert(transaction_open);
+    transaction_open = 0;
+    fake_storage_stats.commits++;
+}
+
+
+/*
+ * Like NVS, a missing key leaves the value untouched and is not an error, a value larger than the buffer is
+ */
+static int load(void *value, size_t len, const char *key) {
+    fake_storage_stats.loads++;
+    for (size_t i = 0; i < num_entries; i++) {
+        if (strcmp(entries[i].key, key) == 0) {
+            if (len < entries[i].len) {
+                return -1;
+            }
+            memcpy(value, entries[i].value, entries[i].len);
+            return 0;
+        }
+    }
+    return 0;
+}
+
+
+static void save(const void *value, size_t len, const char *key) {
+    assert(strlen(key) < sizeof(entries[0].key));
+    size_t i = 0;
+    while (i < num_entries && strcmp(entries[i].key, key) != 0) {
+        i++;
+    }
+    if (i == num_entries) {
+        assert(num_entries < MAX_KEYS);
+        strcpy(entries[num_entries++].key, key);
+    }
+    entries[i].value = realloc(entries[i].value, len > 0 ? len : 1);
+    assert(entries[i].value != NULL);
+    memcpy(entries[i].value, value, len);
+    entries[i].len = len;
+
+    fake_storage_stats.saves++;
+    if (!transaction_open) {
+        fake_storage_stats.commits++;
+    }
+}
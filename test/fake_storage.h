@@ -0,0 +1,21 @@
+#ifndef FAKE_STORAGE_H_INCLUDED
+#define FAKE_STORAGE_H_INCLUDED
+
+
+#include <stdlib.h>
+
+
+// Counted by the in-memory storage of the host tests, in place of peripherals/storage.c
+typedef struct {
+    size_t loads;       // Values read, missing keys included
+    size_t saves;       // Values written
+    size_t commits;     // Writes to flash: one per save outside a transaction, one per transaction
+} fake_storage_stats_t;
+
+
+extern fake_storage_stats_t fake_storage_stats;
+
+void fake_storage_clear(void);
+
+
+#endif
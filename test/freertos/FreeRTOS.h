@@ -0,0 +1,23 @@
+#ifndef FREERTOS_H_INCLUDED
+#define FREERTOS_H_INCLUDED
+
+// Just enough of FreeRTOS for the modules under test, running on threads of the host
+
+#include <stdint.h>
+
+
+typedef uint32_t      TickType_t;
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+
+// As CONFIG_FREERTOS_HZ in sdkconfig
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+
+#endif
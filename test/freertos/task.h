@@ -0,0 +1,12 @@
+#ifndef TASK_H_INCLUDED
+#define TASK_H_INCLUDED
+
+
+#include <sched.h>
+
+
+// Ticks are not simulated, a delay only lets the other threads run
+#define vTaskDelay(ticks) ((void)(ticks), sched_yield())
+
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef TIMERS_H_INCLUDED
+#define TIMERS_H_INCLUDED
+
+
+#include "FreeRTOS.h"
+
+
+struct timer;
+typedef struct timer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+// A one shot timer, armed by xTimerChangePeriod; the test decides when its ticks elapse and runs the callback
+typedef struct {
+    TimerCallbackFunction_t callback;
+    TickType_t              period;
+    uint8_t                 armed;
+} StaticTimer_t;
+
+
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t reload, void *id,
+                                 TimerCallbackFunction_t callback, StaticTimer_t *buffer);
+BaseType_t    xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t wait);
+
+
+#endif
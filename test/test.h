@@ -0,0 +1,47 @@
+#ifndef TEST_H_INCLUDED
+#define TEST_H_INCLUDED
+
+
+#include <stdio.h>
+#include <time.h>
+
+
+// Failures past this many are counted but not printed
+#define TEST_MAX_REPORTED 20
+
+
+static unsigned test_checks   = 0;
+static unsigned test_failures = 0;
+
+
+/*
+ * Minimal checks for the host tests: a failure is reported with its location and the program goes on, so that a
+ * sweep shows how many cases are wrong rather than only the first one
+ */
+#define TEST_CHECK(condition, ...)                                                                                     \
+    do {                                                                                                               \
+        test_checks++;                                                                                                 \
+        if (!(condition)) {                                                                                            \
+            if (test_failures++ < TEST_MAX_REPORTED) {                                                                 \
+                printf("%s:%i: %s: ", __FILE__, __LINE__, #condition);                                                 \
+                printf(__VA_ARGS__);                                                                                   \
+                printf("\n");                                                                                          \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+
+static inline int test_report(const char *name) {
+    printf("%s: %u checks, %u failed\n", name, test_checks, test_failures);
+    return test_failures > 0;
+}
+
+
+static inline double test_seconds(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+#endif
@@ -0,0 +1,250 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "freertos/timers.h"
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "controller/alarm_scheduler.h"
+#include "controller/standby.h"
+#include "controller/wakeup.h"
+#include "view/view_event.h"
+#include "fake_clock.h"
+#include "test.h"
+
+
+#define DAYS         7
+#define SINGLES      60
+#define MAX_EXPECTED 256
+
+
+typedef struct {
+    size_t  num;
+    int64_t due_ms;
+} due_t;
+
+
+static void     run(uint32_t speed);
+static int      add_alarm(model_updater_t updater, time_t timestamp, alarm_recurrence_t recurrence, uint8_t weekdays);
+static size_t   expected_alarms(model_t *pmodel, time_t start, due_t *expected);
+static int      due_precedes(const void *first, const void *second);
+static time_t   local(int year, int month, int day, int hour, int minute);
+static uint32_t next_random(void);
+
+
+static StaticTimer_t *timer          = NULL;
+static int64_t        timer_armed_ms = 0;     // Wall clock time at which the timer was last armed
+static due_t          notified[MAX_EXPECTED];
+static size_t         notified_count = 0;
+static size_t         pokes          = 0;
+static uint32_t       seed           = 12345;
+
+
+/*
+ * A week of alarms rung by the scheduler with the clock running at a few speeds. The only wakeups are those of the
+ * one shot timer, which expires after its ticks of real time: every alarm must be notified once, in order, never
+ * before it is due and within two ticks of the clock after
+ */
+int main(void) {
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+    run(1);
+    run(60);
+    run(3600);
+    return test_report("alarm_scheduler");
+}
+
+
+static void run(uint32_t speed) {
+    static struct model models[3];
+    static size_t       runs  = 0;
+    mut_model_t        *model = &models[runs++];
+
+    // A week without DST changes, from Monday
+    time_t start      = local(2024, 5, 6, 0, 0) + 30;
+    seed              = 12345;
+    notified_count    = 0;
+    pokes             = 0;
+    fake_clock_speed  = speed;
+    fake_clock_millis = (int64_t)start * 1000;
+    civil_time_prepare_local(start);
+
+    model_updater_t updater = model_updater_init(model);
+    for (size_t i = 0; i < SINGLES; i++) {
+        // On whole minutes, so that some alarms start together
+        add_alarm(updater, start + (next_random() % (DAYS * 24 * 60)) * 60, ALARM_RECURRENCE_NONE, 0);
+    }
+    add_alarm(updater, local(2024, 5, 6, 7, 0), ALARM_RECURRENCE_DAILY, 0);
+    add_alarm(updater, local(2024, 5, 6, 7, 0), ALARM_RECURRENCE_WEEKDAYS, 0);
+    add_alarm(updater, local(2024, 5, 11, 22, 15), ALARM_RECURRENCE_WEEKLY, 0x41);     // Saturday and Sunday
+    add_alarm(updater, local(2024, 5, 5, 23, 59), ALARM_RECURRENCE_DAILY, 0);
+
+    due_t  expected[MAX_EXPECTED];
+    size_t expected_count = expected_alarms(model, start, expected);
+
+    // The scheduler logs every alarm
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null  = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+
+    double  begin   = test_seconds();
+    int64_t end_ms  = ((int64_t)start + DAYS * 86400) * 1000;
+    size_t  wakeups = 0;
+    model_updater_refresh_today(updater);
+    alarm_scheduler_init(model);
+    while (timer != NULL && timer->armed) {
+        int64_t expiry_ms = timer_armed_ms + (int64_t)timer->period * portTICK_PERIOD_MS * speed;
+        if (expiry_ms >= end_ms) {
+            break;
+        }
+        fake_clock_millis = expiry_ms;
+        timer->armed      = 0;
+        timer->callback((TimerHandle_t)timer);
+        wakeups++;
+
+        // As the controller loop
+        model_updater_refresh_today(updater);
+        alarm_scheduler_manage(model);
+    }
+    double elapsed = test_seconds() - begin;
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(null);
+    close(saved);
+
+    size_t  mismatched = 0;
+    int64_t max_late   = 0;
+    for (size_t i = 0; i < expected_count && i < notified_count; i++) {
+        int64_t late = notified[i].due_ms - expected[i].due_ms;
+        if (notified[i].num != expected[i].num || late < 0 || late >= 2 * portTICK_PERIOD_MS * (int64_t)speed) {
+            if (mismatched++ == 0) {
+                TEST_CHECK(0, "speed %u: alarm %zu due at %lli notified as alarm %zu at %lli", speed,
+                           expected[i].num, (long long)expected[i].due_ms, notified[i].num,
+                           (long long)notified[i].due_ms);
+            }
+        }
+        if (late > max_late) {
+            max_late = late;
+        }
+    }
+    TEST_CHECK(mismatched == 0, "speed %u: %zu alarms notified wrong", speed, mismatched);
+    TEST_CHECK(notified_count == expected_count, "speed %u: %zu alarms notified, %zu expected", speed,
+               notified_count, expected_count);
+    TEST_CHECK(pokes == notified_count, "speed %u: standby poked %zu times", speed, pokes);
+    printf("speed %5u: %zu alarms in %zu wakeups, at most %lli ms late, %.1f ms\n", speed, notified_count, wakeups,
+           (long long)max_late, elapsed * 1e3);
+}
+
+
+static int add_alarm(model_updater_t updater, time_t timestamp, alarm_recurrence_t recurrence, uint8_t weekdays) {
+    struct tm tm        = civil_time_localtime(timestamp);
+    int       alarm_num = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+    if (alarm_num >= 0) {
+        model_updater_set_alarm_time(updater, alarm_num, timestamp);
+        model_updater_set_alarm_recurrence(updater, alarm_num, recurrence, weekdays);
+    }
+    return alarm_num;
+}
+
+
+/*
+ * Every occurrence within the week after `start`, by time and then by number
+ */
+static size_t expected_alarms(model_t *pmodel, time_t start, due_t *expected) {
+    size_t count = 0;
+    for (size_t num = 0; num < pmodel->config.num_alarms; num++) {
+        const alarm_t *alarm = &pmodel->config.alarms[num];
+        if (alarm->recurrence == ALARM_RECURRENCE_NONE) {
+            if (alarm->timestamp > (uint64_t)start) {
+                expected[count++] = (due_t){.num = num, .due_ms = (int64_t)alarm->timestamp * 1000};
+            }
+            continue;
+        }
+
+        struct tm alarm_tm = civil_time_localtime(alarm->timestamp);
+        for (int day = 0; day < DAYS; day++) {
+            time_t    at     = local(2024, 5, 6 + day, alarm_tm.tm_hour, alarm_tm.tm_min);
+            struct tm day_tm = civil_time_localtime(at);
+            if (at > start && at >= (time_t)alarm->timestamp && model_alarm_occurs_on(alarm, &day_tm)) {
+                expected[count++] = (due_t){.num = num, .due_ms = (int64_t)at * 1000};
+            }
+        }
+    }
+    qsort(expected, count, sizeof(due_t), due_precedes);
+    return count;
+}
+
+
+static int due_precedes(const void *first, const void *second) {
+    const due_t *a = first, *b = second;
+    if (a->due_ms != b->due_ms) {
+        return a->due_ms < b->due_ms ? -1 : 1;
+    }
+    return a->num < b->num ? -1 : a->num > b->num;
+}
+
+
+static time_t local(int year, int month, int day, int hour, int minute) {
+    struct tm tm = {
+        .tm_year  = year - 1900,
+        .tm_mon   = month - 1,
+        .tm_mday  = day,
+        .tm_hour  = hour,
+        .tm_min   = minute,
+        .tm_isdst = -1,
+    };
+    return civil_time_mktime(&tm);
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+
+/*
+ * What the scheduler reaches outside of the model
+ */
+
+
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t reload, void *id,
+                                 TimerCallbackFunction_t callback, StaticTimer_t *buffer) {
+    (void)name;
+    (void)reload;
+    (void)id;
+    buffer->callback = callback;
+    buffer->period   = period;
+    buffer->armed    = 0;
+    timer            = buffer;
+    return (TimerHandle_t)buffer;
+}
+
+
+BaseType_t xTimerChangePeriod(TimerHandle_t handle, TickType_t period, TickType_t wait) {
+    (void)wait;
+    StaticTimer_t *changed = (StaticTimer_t *)handle;
+    changed->period        = period;
+    changed->armed         = 1;
+    timer_armed_ms         = fake_clock_millis;
+    return pdPASS;
+}
+
+
+void view_event(view_event_t event) {
+    if (event.tag == VIEW_EVENT_TAG_ALARM_DUE && notified_count < MAX_EXPECTED) {
+        notified[notified_count++] = (due_t){.num = event.as.alarm_due.num, .due_ms = fake_clock_millis};
+    }
+}
+
+
+void standby_poke(void) {
+    pokes++;
+}
+
+
+void wakeup_notify(void) {}
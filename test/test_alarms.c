@@ -0,0 +1,667 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "fake_clock.h"
+#include "test.h"
+
+
+#define MAX_LISTED    64
+#define RANDOM_CHANGES 5000
+#define DUE_ALARMS     200
+#define REUSE_CYCLES   3000
+
+
+static uint32_t seed = 12345;
+
+
+static void    check_in_progress(void);
+static void    check_delete(void);
+static void    check_index(void);
+static void    check_index_consistent(model_t *pmodel);
+static void    check_queries(model_t *pmodel, uint64_t timestamp);
+static void    set_now(time_t timestamp);
+static time_t  local(int year, int month, int day, int hour, int minute);
+static int     add_event(model_updater_t updater, time_t timestamp, uint16_t minutes);
+static void    check_day_rules(void);
+static void    check_batch_import(void);
+static void    check_changes(void);
+static void    check_due(void);
+static void    check_slot_reuse(void);
+static uint8_t same_alarms_but(model_t *pmodel, const alarm_t *alarms, const uint32_t *occurrences, size_t skipped);
+static size_t  list_day(model_t *pmodel, int year, int month, int day, size_t *alarms);
+static size_t  list_day_reference(model_t *pmodel, int year, int month, int day, size_t *alarms);
+static size_t  arena_in_use(model_t *pmodel);
+static uint32_t next_random(void);
+
+
+int main(void) {
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+    check_in_progress();
+    check_delete();
+    check_index();
+    check_day_rules();
+    check_batch_import();
+    check_changes();
+    check_due();
+    check_slot_reuse();
+    return test_report("alarms");
+}
+
+
+/*
+ * An event is active until the day it ends: it is listed on every day it spans, it is not in the expired prefix and
+ * its slot is not reused
+ */
+static void check_in_progress(void) {
+    static struct model model;
+    set_now(local(2024, 3, 10, 12, 0));
+    model_updater_t updater = model_updater_init(&model);
+
+    int running  = add_event(updater, local(2024, 3, 9, 20, 0), 24 * 60);
+    int later    = add_event(updater, local(2024, 3, 10, 15, 0), 0);
+    int tonight  = add_event(updater, local(2024, 3, 10, 22, 0), 4 * 60);
+    int tomorrow = add_event(updater, local(2024, 3, 11, 8, 0), 0);
+    // Last, or the next one would take its slot
+    int over     = add_event(updater, local(2024, 3, 7, 9, 0), 60);
+
+    size_t alarms[MAX_LISTED] = {0};
+    size_t count              = list_day(&model, 2024, 3, 10, alarms);
+    TEST_CHECK(count == 3 && alarms[0] == (size_t)running && alarms[1] == (size_t)later &&
+                   alarms[2] == (size_t)tonight,
+               "%zu alarms today", count);
+    count = list_day(&model, 2024, 3, 11, alarms);
+    TEST_CHECK(count == 2 && alarms[0] == (size_t)tonight && alarms[1] == (size_t)tomorrow, "%zu alarms tomorrow",
+               count);
+    TEST_CHECK(list_day(&model, 2024, 3, 9, alarms) == 0, "alarms listed yesterday");
+
+    TEST_CHECK(model_is_alarm_expired(&model, over) && !model_is_alarm_expired(&model, running),
+               "expired alarms");
+    TEST_CHECK(model_get_expired_alarms(&model) == 1, "%zu expired alarms", model_get_expired_alarms(&model));
+    size_t free_slot = 0;
+    TEST_CHECK(model_get_free_alarm_slot(&model, &free_slot) && free_slot == (size_t)over, "free slot %zu",
+               free_slot);
+
+    // The running event started before the expired one ended, so it shields it from the prefix
+    model_updater_set_alarm_time(updater, running, local(2024, 3, 7, 8, 0));
+    model_updater_set_alarm_duration(updater, running, 4 * 24 * 60);
+    TEST_CHECK(model_get_expired_alarms(&model) == 0, "%zu expired alarms", model_get_expired_alarms(&model));
+    count = list_day(&model, 2024, 3, 10, alarms);
+    TEST_CHECK(count == 3 && alarms[0] == (size_t)running, "%zu alarms today", count);
+
+    // Once every event is over the earliest one is reused first
+    set_now(local(2024, 3, 12, 12, 0));
+    model_updater_refresh_today(updater);
+    TEST_CHECK(model_is_alarm_expired(&model, running), "event over");
+    TEST_CHECK(model_get_expired_alarms(&model) == 5, "%zu expired alarms", model_get_expired_alarms(&model));
+    TEST_CHECK(list_day(&model, 2024, 3, 12, alarms) == 0, "alarms listed after they ended");
+    int reused = add_event(updater, local(2024, 3, 13, 8, 0), 0);
+    TEST_CHECK(reused == running, "alarm added as %i", reused);
+}
+
+
+/*
+ * A deleted alarm gives its description back to the arena right away, and its slot is the next one reused
+ */
+static void check_delete(void) {
+    static struct model model;
+    set_now(local(2024, 3, 10, 12, 0));
+    model_updater_t updater = model_updater_init(&model);
+
+    char description[MAX_DESCRIPTION_LEN + 1] = {0};
+    memset(description, 'x', MAX_DESCRIPTION_LEN);
+    int kept    = add_event(updater, local(2024, 3, 11, 8, 0), 0);
+    int deleted = add_event(updater, local(2024, 3, 12, 8, 0), 0);
+    model_updater_set_alarm_description(updater, kept, description);
+    model_updater_set_alarm_description(updater, deleted, description);
+
+    size_t in_use = arena_in_use(&model);
+    model_updater_delete_alarm(updater, deleted);
+    TEST_CHECK(arena_in_use(&model) == in_use - string_arena_entry_size(MAX_DESCRIPTION_LEN),
+               "%zu bytes in use after deleting from %zu", arena_in_use(&model), in_use);
+    TEST_CHECK(strcmp(model_get_alarm_description(&model, kept), description) == 0, "description of another alarm");
+
+    // Another long description fits in the space released, without growing the arena
+    size_t capacity = model.config.descriptions.capacity;
+    int    added    = add_event(updater, local(2024, 3, 13, 8, 0), 0);
+    model_updater_set_alarm_description(updater, added, description);
+    TEST_CHECK(added == deleted, "alarm added as %i", added);
+    TEST_CHECK(model.config.descriptions.capacity == capacity, "arena grew from %zu to %u", capacity,
+               model.config.descriptions.capacity);
+    TEST_CHECK(strcmp(model_get_alarm_description(&model, kept), description) == 0 &&
+                   strcmp(model_get_alarm_description(&model, added), description) == 0,
+               "descriptions lost in the compaction");
+}
+
+
+/*
+ * Random changes to single alarms, moving them by small and large distances in the index, across a few days: the
+ * index must stay ordered and the running maximum of the ends exact
+ */
+static void check_index(void) {
+    static struct model model;
+    time_t              now = local(2024, 3, 28, 12, 0);
+    set_now(now);
+    model_updater_t updater = model_updater_init(&model);
+
+    for (size_t i = 0; i < 300; i++) {
+        add_event(updater, now + (int64_t)(next_random() % (20 * 86400)) - 86400, next_random() % 3 == 0 ? 90 : 0);
+    }
+    check_index_consistent(&model);
+
+    for (size_t i = 0; i < RANDOM_CHANGES; i++) {
+        size_t alarm_num = next_random() % model.config.num_alarms;
+        switch (next_random() % 8) {
+            case 0:
+                add_event(updater, now + (int64_t)(next_random() % (20 * 86400)), 0);
+                break;
+            case 1:
+                model_updater_delete_alarm(updater, alarm_num);
+                break;
+            case 2:
+                // Multi-day events move the running maximum far ahead
+                model_updater_set_alarm_duration(updater, alarm_num, next_random() % (5 * 24 * 60));
+                break;
+            case 3:
+                model_updater_set_alarm_duration(updater, alarm_num, 0);
+                break;
+            case 4:
+                model_updater_set_alarm_recurrence(updater, alarm_num, next_random() % ALARM_RECURRENCE_NUM,
+                                                   1 + next_random() % 127);
+                break;
+            case 5:
+                // Nudged, as when editing the time of an alarm
+                model_updater_set_alarm_time(updater, alarm_num,
+                                             model.config.alarms[alarm_num].timestamp + next_random() % 7200);
+                break;
+            case 6:
+                // Across the DST change of the 31st
+                now += next_random() % 7200;
+                set_now(now);
+                model_updater_refresh_today(updater);
+                break;
+            default:
+                model_updater_set_alarm_time(updater, alarm_num,
+                                             now + (int64_t)(next_random() % (20 * 86400)) - 2 * 86400);
+                break;
+        }
+        check_index_consistent(&model);
+        check_queries(&model, now + (int64_t)(next_random() % (4 * 86400)) - 2 * 86400);
+    }
+}
+
+
+/*
+ * More recurring alarms on a day than the query merges at a time, among single ones and multi-day events: the list
+ * must match every alarm checked on its own
+ */
+static void check_day_rules(void) {
+    static struct model model;
+    time_t              now = local(2024, 3, 28, 12, 0);
+    set_now(now);
+    model_updater_t updater = model_updater_init(&model);
+
+    for (size_t i = 0; i < 40; i++) {
+        int alarm_num = add_event(updater, now + (int64_t)(next_random() % (10 * 86400)) - 86400,
+                                  next_random() % 4 == 0 ? 26 * 60 : 30);
+        if (i % 2 == 0) {
+            model_updater_set_alarm_recurrence(updater, alarm_num, i % 4 == 0 ? ALARM_RECURRENCE_DAILY
+                                                                               : ALARM_RECURRENCE_WEEKDAYS,
+                                               0);
+        }
+    }
+
+    // Across the DST change of the 31st
+    for (int day = 27; day <= 31 + 10; day++) {
+        size_t alarms[MAX_LISTED]   = {0};
+        size_t expected[MAX_LISTED] = {0};
+        int    month                = day > 31 ? 4 : 3;
+        int    mday                 = day > 31 ? day - 31 : day;
+        size_t count                = list_day(&model, 2024, month, mday, alarms);
+        size_t expected_count       = list_day_reference(&model, 2024, month, mday, expected);
+
+        TEST_CHECK(count == expected_count && memcmp(alarms, expected, count * sizeof(size_t)) == 0,
+                   "2024-%02i-%02i: %zu alarms listed, %zu expected", month, mday, count, expected_count);
+    }
+}
+
+
+/*
+ * An import fills the expired slots first and then grows the table, skips invalid records and notifies the alarms
+ * once
+ */
+static void check_batch_import(void) {
+    static struct model model;
+    time_t              now = local(2024, 3, 10, 12, 0);
+    set_now(now);
+    model_updater_t updater = model_updater_init(&model);
+
+    int expired = add_event(updater, local(2024, 3, 11, 8, 0), 0);
+    int kept    = add_event(updater, local(2024, 3, 13, 8, 0), 0);
+    set_now(local(2024, 3, 12, 12, 0));
+    model_updater_refresh_today(updater);
+
+    const alarm_record_t records[] = {
+        {.timestamp = local(2024, 3, 14, 9, 0), .duration = 60, .description = "First"},
+        // Over already, not valid
+        {.timestamp = local(2024, 3, 10, 9, 0), .description = "Past"},
+        {.timestamp = local(2024, 3, 13, 7, 0), .recurrence = ALARM_RECURRENCE_DAILY, .description = "Daily"},
+        // Weekly without days, not valid
+        {.timestamp = local(2024, 3, 15, 9, 0), .recurrence = ALARM_RECURRENCE_WEEKLY, .description = "Never"},
+        {.timestamp = local(2024, 3, 13, 9, 0), .description = "Second"},
+    };
+
+    size_t   num_alarms = model.config.num_alarms;
+    uint32_t generation = model_get_field_generation(&model, MODEL_FIELD_ALARMS);
+    model_updater_begin_alarm_batch(updater);
+    for (size_t i = 0; i < sizeof(records) / sizeof(records[0]); i++) {
+        int alarm_num = model_updater_batch_add_alarm(updater, &records[i]);
+        TEST_CHECK((alarm_num >= 0) == (i % 2 == 0), "record %zu imported as %i", i, alarm_num);
+        if (i == 0) {
+            TEST_CHECK(alarm_num == expired, "expired slot %i not reused by %i", expired, alarm_num);
+        }
+    }
+    const uint16_t *alarms   = NULL;
+    size_t          imported = model_updater_commit_alarm_batch(updater, &alarms);
+
+    TEST_CHECK(imported == 3, "%zu alarms imported", imported);
+    TEST_CHECK(model.config.num_alarms == num_alarms + 2, "%u alarms after the import", model.config.num_alarms);
+    TEST_CHECK(model_get_field_generation(&model, MODEL_FIELD_ALARMS) == generation + 1,
+               "alarms notified %u times", model_get_field_generation(&model, MODEL_FIELD_ALARMS) - generation);
+    check_index_consistent(&model);
+
+    // In time order, the daily alarm before the existing one
+    size_t listed[MAX_LISTED] = {0};
+    size_t count              = list_day(&model, 2024, 3, 13, listed);
+    TEST_CHECK(count == 3 && strcmp(model_get_alarm_description(&model, listed[0]), "Daily") == 0 &&
+                   listed[1] == (size_t)kept && strcmp(model_get_alarm_description(&model, listed[2]), "Second") == 0,
+               "%zu alarms on the 13th", count);
+    TEST_CHECK(imported > 0 && strcmp(model_get_alarm_description(&model, alarms[0]), "First") == 0,
+               "descriptions of the import");
+}
+
+
+/*
+ * Every reader keeps its own generation: it is told of each field changed since it last looked, once, while setting
+ * a field to the value it already has is no change. The counters are compared across the wraparound
+ */
+static void check_changes(void) {
+    static struct model model;
+    set_now(local(2024, 3, 28, 12, 0));
+    model_updater_t updater = model_updater_init(&model);
+
+    uint32_t view       = model_get_generation(&model);
+    uint32_t controller = view;
+    TEST_CHECK(model_get_changes(&model, &view) == 0, "changes without any update");
+
+    model_updater_set_military_time(updater, !model.config.military_time);
+    model_updater_set_normal_brightness(updater, model.config.normal_brightness == 50 ? 60 : 50);
+    uint32_t changes = model_get_changes(&model, &view);
+    TEST_CHECK(changes ==
+                   (MODEL_FIELD_MASK(MODEL_FIELD_MILITARY_TIME) | MODEL_FIELD_MASK(MODEL_FIELD_NORMAL_BRIGHTNESS)),
+               "changes 0x%X", changes);
+    TEST_CHECK(model_get_changes(&model, &view) == 0, "changes reported twice");
+
+    uint32_t generation = model_get_generation(&model);
+    model_updater_set_military_time(updater, model.config.military_time);
+    model_updater_set_normal_brightness(updater, model.config.normal_brightness + 1);
+    TEST_CHECK(model_get_generation(&model) == generation, "generation bumped by unchanged values");
+
+    add_event(updater, local(2024, 3, 29, 8, 0), 0);
+    changes = model_get_changes(&model, &view);
+    TEST_CHECK((changes & MODEL_FIELD_MASK(MODEL_FIELD_ALARMS)) &&
+                   !(changes & MODEL_FIELD_MASK(MODEL_FIELD_MILITARY_TIME)),
+               "changes 0x%X after adding an alarm", changes);
+    changes = model_get_changes(&model, &controller);
+    TEST_CHECK((changes & MODEL_FIELD_MASK(MODEL_FIELD_ALARMS)) &&
+                   (changes & MODEL_FIELD_MASK(MODEL_FIELD_MILITARY_TIME)),
+               "changes 0x%X for the second reader", changes);
+
+    // A few changes away from the wraparound, with the counters of the other fields just behind it
+    model.run.generation = UINT32_MAX - 2;
+    for (size_t i = 0; i < MODEL_FIELD_NUM; i++) {
+        model.run.generations[i] = model.run.generation - i;
+    }
+    view = model.run.generation;
+    for (size_t i = 0; i < 5; i++) {
+        model_updater_set_night_mode(updater, !model.config.night_mode);
+    }
+    changes = model_get_changes(&model, &view);
+    TEST_CHECK(changes == MODEL_FIELD_MASK(MODEL_FIELD_NIGHT_MODE), "changes 0x%X across the wraparound", changes);
+    TEST_CHECK(view == model_get_generation(&model) && view < 5, "generation %u after the wraparound", view);
+}
+
+
+/*
+ * Like the scheduler: many alarms share the same minute, and walking the index from a second that was already checked
+ * up to the next wakeup must meet every alarm due in between once, in order, including those due together
+ */
+static void check_due(void) {
+    static struct model model;
+    time_t              now = local(2024, 3, 28, 12, 0);
+    set_now(now);
+    model_updater_t updater = model_updater_init(&model);
+
+    for (size_t i = 0; i < DUE_ALARMS; i++) {
+        add_event(updater, now + (int64_t)(next_random() % 240) * 60, 0);
+    }
+    for (size_t i = 0; i < 20; i++) {
+        model_updater_delete_alarm(updater, next_random() % model.config.num_alarms);
+    }
+
+    for (size_t i = 0; i < 500; i++) {
+        uint64_t checked = now + (int64_t)(next_random() % 250) * 60 - 300 + (next_random() % 2) * 30;
+        uint64_t until   = checked + next_random() % 3600;
+
+        // By occurrence, then by number, as they ring
+        size_t expected[DUE_ALARMS] = {0};
+        size_t expected_count       = 0;
+        for (size_t num = 0; num < model.config.num_alarms; num++) {
+            uint64_t occurrence = model.run.occurrences[num];
+            if (occurrence > checked && occurrence <= until) {
+                size_t position = expected_count++;
+                while (position > 0 && model.run.occurrences[expected[position - 1]] > occurrence) {
+                    expected[position] = expected[position - 1];
+                    position--;
+                }
+                expected[position] = num;
+            }
+        }
+
+        size_t   next_num        = 0;
+        uint64_t next_occurrence = 0;
+        uint8_t  found           = model_get_next_alarm_after(&model, checked, &next_num, &next_occurrence);
+        if (expected_count > 0) {
+            TEST_CHECK(found && next_num == expected[0] && next_occurrence == model.run.occurrences[expected[0]],
+                       "alarm %zu next after %llu", next_num, (unsigned long long)checked);
+        }
+
+        size_t   walked[DUE_ALARMS] = {0};
+        size_t   walked_count       = 0;
+        size_t   alarm_num          = SIZE_MAX;
+        uint64_t occurrence         = checked;
+        while (model_get_following_alarm(&model, &alarm_num, &occurrence) && occurrence <= until &&
+               walked_count < DUE_ALARMS) {
+            walked[walked_count++] = alarm_num;
+        }
+        TEST_CHECK(walked_count == expected_count && memcmp(walked, expected, walked_count * sizeof(size_t)) == 0,
+                   "%zu alarms due after %llu, %zu expected", walked_count, (unsigned long long)checked,
+                   expected_count);
+    }
+}
+
+
+/*
+ * A full table where alarms keep expiring or being deleted while new ones are added, as over months of use: the slot
+ * reused is always the first of the index, the table never grows, and an add with no free slot fails without touching
+ * any alarm
+ */
+static void check_slot_reuse(void) {
+    static struct model model;
+    static alarm_t      alarms[UINT16_MAX];
+    static uint32_t     occurrences[UINT16_MAX];
+    time_t              now = local(2024, 3, 28, 12, 0);
+    set_now(now);
+    model_updater_t updater = model_updater_init(&model);
+
+    // The adds warn of the table full, the checks print in between
+    int saved = dup(STDOUT_FILENO);
+    int null  = open("/dev/null", O_WRONLY);
+
+    fflush(stdout);
+    dup2(null, STDOUT_FILENO);
+    while (add_event(updater, now + 3600 + (int64_t)(next_random() % (20 * 86400)), 0) >= 0) {}
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    size_t full = model.config.num_alarms;
+
+    size_t refused = 0, reused = 0;
+    for (size_t i = 0; i < REUSE_CYCLES; i++) {
+        if (next_random() % 3 != 0) {
+            size_t alarm_num = next_random() % full;
+            if (next_random() % 2 == 0) {
+                model_updater_delete_alarm(updater, alarm_num);
+            } else {
+                model_updater_set_alarm_time(updater, alarm_num, now - 2 * 86400 - next_random() % 86400);
+            }
+        }
+
+        size_t  free_num = 0;
+        uint8_t is_free  = model_get_free_alarm_slot(&model, &free_num);
+        TEST_CHECK(!is_free || free_num == model.run.alarm_index[0], "free slot %zu, %u first in the index", free_num,
+                   model.run.alarm_index[0]);
+        memcpy(alarms, model.config.alarms, full * sizeof(alarm_t));
+        memcpy(occurrences, model.run.occurrences, full * sizeof(uint32_t));
+
+        fflush(stdout);
+        dup2(null, STDOUT_FILENO);
+        int added = add_event(updater, now + 3600 + (int64_t)(next_random() % (20 * 86400)), 0);
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        if (is_free) {
+            TEST_CHECK(added == (int)free_num, "alarm added as %i instead of %zu", added, free_num);
+            reused++;
+        } else {
+            TEST_CHECK(added == -1, "alarm added as %i to a full table", added);
+            refused++;
+        }
+        TEST_CHECK(model.config.num_alarms == full, "%u alarms in a table of %zu", model.config.num_alarms, full);
+        TEST_CHECK(same_alarms_but(&model, alarms, occurrences, is_free ? free_num : SIZE_MAX),
+                   "alarms overwritten adding %i", added);
+        check_index_consistent(&model);
+    }
+
+    close(null);
+    close(saved);
+    TEST_CHECK(reused > 0 && refused > 0, "%zu slots reused, %zu adds refused", reused, refused);
+}
+
+
+/*
+ * Every alarm but `skipped` as saved in `alarms` and `occurrences`. Descriptions move in the arena, so only the
+ * scheduling fields are compared
+ */
+static uint8_t same_alarms_but(model_t *pmodel, const alarm_t *alarms, const uint32_t *occurrences, size_t skipped) {
+    for (size_t num = 0; num < pmodel->config.num_alarms; num++) {
+        const alarm_t *alarm = &pmodel->config.alarms[num];
+        if (num != skipped && (alarm->timestamp != alarms[num].timestamp ||
+                               alarm->recurrence != alarms[num].recurrence ||
+                               alarm->weekdays != alarms[num].weekdays || alarm->duration != alarms[num].duration ||
+                               pmodel->run.occurrences[num] != occurrences[num])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static void check_index_consistent(model_t *pmodel) {
+    static uint8_t seen[UINT16_MAX];
+    size_t         count   = pmodel->config.num_alarms;
+    uint32_t       max_end = 0;
+    uint8_t        sorted = 1, complete = 1, ends = 1;
+    memset(seen, 0, count);
+
+    for (size_t i = 0; i < count; i++) {
+        uint16_t alarm_num = pmodel->run.alarm_index[i];
+        if (alarm_num >= count || seen[alarm_num]) {
+            complete = 0;
+            break;
+        }
+        seen[alarm_num] = 1;
+
+        if (i > 0) {
+            uint16_t previous = pmodel->run.alarm_index[i - 1];
+            sorted &= pmodel->run.occurrences[previous] < pmodel->run.occurrences[alarm_num] ||
+                      (pmodel->run.occurrences[previous] == pmodel->run.occurrences[alarm_num] &&
+                       previous < alarm_num);
+        }
+
+        uint64_t end = model_get_alarm_end(pmodel, alarm_num);
+        if (end > max_end) {
+            max_end = end;
+        }
+        ends &= pmodel->run.max_ends[i] == max_end;
+    }
+
+    TEST_CHECK(complete, "index is not a permutation of the alarms");
+    TEST_CHECK(sorted, "index out of order");
+    TEST_CHECK(ends, "running maximum of the ends out of date");
+    TEST_CHECK(pmodel->run.today.first == model_alarm_index_lower_bound(pmodel, pmodel->run.today.start) &&
+                   pmodel->run.today.count == model_alarm_index_lower_bound(pmodel, pmodel->run.today.end) -
+                                                  pmodel->run.today.first,
+               "range of today out of date");
+}
+
+
+/*
+ * The alarms of today and those in progress at `timestamp`, against a scan of every alarm in the order of the index
+ */
+static void check_queries(model_t *pmodel, uint64_t timestamp) {
+    static size_t listed[UINT16_MAX];
+    static size_t expected[UINT16_MAX];
+    size_t        expected_count = 0;
+
+    for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
+        uint16_t num = pmodel->run.alarm_index[i];
+        if (pmodel->run.occurrences[num] <= timestamp && model_get_alarm_end(pmodel, num) > timestamp) {
+            expected[expected_count++] = num;
+        }
+    }
+    size_t count = model_get_alarms_in_progress(pmodel, timestamp, listed, UINT16_MAX);
+    TEST_CHECK(count == expected_count && memcmp(listed, expected, count * sizeof(size_t)) == 0,
+               "%zu alarms in progress at %llu, %zu expected", count, (unsigned long long)timestamp, expected_count);
+
+    expected_count = 0;
+    for (size_t i = 0; i < pmodel->config.num_alarms; i++) {
+        uint16_t num = pmodel->run.alarm_index[i];
+        if (pmodel->run.occurrences[num] >= model_get_today_start(pmodel) &&
+            pmodel->run.occurrences[num] < model_get_today_end(pmodel)) {
+            expected[expected_count++] = num;
+        }
+    }
+    count         = model_get_today_alarms_count(pmodel);
+    uint8_t equal = count == expected_count;
+    for (size_t nth = 0; equal && nth < count; nth++) {
+        size_t alarm_num = 0;
+        equal            = model_get_nth_today_alarm(pmodel, &alarm_num, nth) && alarm_num == expected[nth];
+    }
+    TEST_CHECK(equal, "%zu alarms today, %zu expected", count, expected_count);
+}
+
+
+static void set_now(time_t timestamp) {
+    fake_clock_millis = (int64_t)timestamp * 1000;
+    civil_time_prepare_local(timestamp);
+}
+
+
+static time_t local(int year, int month, int day, int hour, int minute) {
+    struct tm tm = {
+        .tm_year  = year - 1900,
+        .tm_mon   = month - 1,
+        .tm_mday  = day,
+        .tm_hour  = hour,
+        .tm_min   = minute,
+        .tm_isdst = -1,
+    };
+    return civil_time_mktime(&tm);
+}
+
+
+/*
+ * Like the alarm page: a new event on the day, then its time and duration
+ */
+static int add_event(model_updater_t updater, time_t timestamp, uint16_t minutes) {
+    struct tm tm        = civil_time_localtime(timestamp);
+    int       alarm_num = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+    if (alarm_num >= 0) {
+        model_updater_set_alarm_time(updater, alarm_num, timestamp);
+        model_updater_set_alarm_duration(updater, alarm_num, minutes);
+    }
+    return alarm_num;
+}
+
+
+static size_t list_day(model_t *pmodel, int year, int month, int day, size_t *alarms) {
+    return model_get_day_alarms(pmodel, day, month - 1, year - 1900, alarms, MAX_LISTED);
+}
+
+
+/*
+ * Every alarm checked on its own: the indexed ones that overlap the day and the rules repeating on it, sorted by
+ * time with the indexed ones first
+ */
+static size_t list_day_reference(model_t *pmodel, int year, int month, int day, size_t *alarms) {
+    uint64_t times[MAX_LISTED]   = {0};
+    uint8_t  repeats[MAX_LISTED] = {0};
+    size_t   count               = 0;
+
+    struct tm day_tm = {.tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day, .tm_isdst = -1};
+    uint64_t  from   = civil_time_mktime(&day_tm);
+    uint64_t  end    = local(year, month, day + 1, 0, 0);
+    if (from < model_get_today_start(pmodel)) {
+        from = model_get_today_start(pmodel);
+    }
+
+    for (size_t num = 0; num < pmodel->config.num_alarms && count < MAX_LISTED; num++) {
+        const alarm_t *alarm      = &pmodel->config.alarms[num];
+        uint64_t       occurrence = pmodel->run.occurrences[num];
+        if (from < end && occurrence < end && model_get_alarm_end(pmodel, num) >= from) {
+            alarms[count]  = num;
+            times[count]   = occurrence;
+            repeats[count] = 0;
+            count++;
+        }
+        if (from < end && count < MAX_LISTED && alarm->recurrence != ALARM_RECURRENCE_NONE && occurrence < from &&
+            model_alarm_occurs_on(alarm, &day_tm)) {
+            struct tm alarm_tm = civil_time_localtime(alarm->timestamp);
+            struct tm at_tm    = day_tm;
+            at_tm.tm_hour      = alarm_tm.tm_hour;
+            at_tm.tm_min       = alarm_tm.tm_min;
+            at_tm.tm_sec       = alarm_tm.tm_sec;
+            at_tm.tm_isdst     = -1;
+            alarms[count]      = num;
+            times[count]       = civil_time_mktime(&at_tm);
+            repeats[count]     = 1;
+            count++;
+        }
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        for (size_t j = i; j > 0; j--) {
+            uint8_t swap = times[j] < times[j - 1] ||
+                           (times[j] == times[j - 1] && (repeats[j] < repeats[j - 1] ||
+                                                         (repeats[j] == repeats[j - 1] && alarms[j] < alarms[j - 1])));
+            if (!swap) {
+                break;
+            }
+            uint64_t time   = times[j];
+            uint8_t  repeat = repeats[j];
+            size_t   alarm  = alarms[j];
+            times[j]        = times[j - 1];
+            repeats[j]      = repeats[j - 1];
+            alarms[j]       = alarms[j - 1];
+            times[j - 1]    = time;
+            repeats[j - 1]  = repeat;
+            alarms[j - 1]   = alarm;
+        }
+    }
+
+    return count;
+}
+
+
+static size_t arena_in_use(model_t *pmodel) {
+    return (size_t)pmodel->config.descriptions.size - pmodel->config.descriptions.garbage;
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+#include "model/civil_time.h"
+#include "test.h"
+
+
+#define FIRST_YEAR 1990
+#define LAST_YEAR  2040
+// A day and a bit, so that the samples drift through every time of the day
+#define SWEEP_STEP 86413
+// Every transition is swept more densely, as that is where the conversions can go wrong
+#define TRANSITION_MARGIN 7200
+#define TRANSITION_STEP   239
+
+
+static void check_zone(const char *posix_tz);
+static void check_sample(civil_time_zone_t *zone, int64_t timestamp);
+static void check_from_epoch(const civil_time_zone_t *zone, int64_t timestamp);
+static void check_to_epoch(const civil_time_zone_t *zone, struct tm tm);
+static void check_transitions(civil_time_zone_t *zone);
+static int  is_repeated(const struct tm *tm);
+
+
+static const char *zones[] = {
+    "UTC-1CEST,M3.5.0,M10.5.0/3",       // The configured one
+    "EST5EDT,M3.2.0,M11.1.0",           // Default transition times
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",     // DST across the new year
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1", // Quoted names and negative transition times
+    "NPT-5:45",                         // No DST, offset in minutes
+    "UTC0",
+};
+
+
+/*
+ * Compares the conversions with glibc localtime_r and mktime, which read the same POSIX TZ string
+ */
+int main(void) {
+    for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+        check_zone(zones[i]);
+    }
+    return test_report("civil_time");
+}
+
+
+static void check_zone(const char *posix_tz) {
+    civil_time_zone_t zone = {0};
+    TEST_CHECK(civil_time_zone_parse(&zone, posix_tz) == 0, "%s", posix_tz);
+
+    setenv("TZ", posix_tz, 1);
+    tzset();
+
+    int64_t first = civil_time_days_from_civil(FIRST_YEAR, 1, 1) * 86400;
+    int64_t last  = civil_time_days_from_civil(LAST_YEAR, 1, 1) * 86400;
+    for (int64_t timestamp = first; timestamp < last; timestamp += SWEEP_STEP) {
+        check_sample(&zone, timestamp);
+    }
+
+    check_transitions(&zone);
+}
+
+
+static void check_sample(civil_time_zone_t *zone, int64_t timestamp) {
+    // Like the model, which prepares the zone when the day changes
+    civil_time_zone_prepare(zone, timestamp);
+    check_from_epoch(zone, timestamp);
+
+    struct tm tm = civil_time_from_epoch(zone, timestamp);
+    check_to_epoch(zone, tm);
+    tm.tm_isdst = -1;
+    check_to_epoch(zone, tm);
+    // Out of range fields, as the pages produce when stepping days and months
+    tm.tm_mday += 40;
+    tm.tm_hour -= 30;
+    tm.tm_mon += 13;
+    check_to_epoch(zone, tm);
+}
+
+
+static void check_from_epoch(const civil_time_zone_t *zone, int64_t timestamp) {
+    time_t    libc_timestamp = (time_t)timestamp;
+    struct tm expected       = {0};
+    localtime_r(&libc_timestamp, &expected);
+    struct tm actual = civil_time_from_epoch(zone, timestamp);
+
+    TEST_CHECK(actual.tm_year == expected.tm_year && actual.tm_mon == expected.tm_mon &&
+                   actual.tm_mday == expected.tm_mday && actual.tm_hour == expected.tm_hour &&
+                   actual.tm_min == expected.tm_min && actual.tm_sec == expected.tm_sec &&
+                   actual.tm_wday == expected.tm_wday && actual.tm_yday == expected.tm_yday &&
+                   actual.tm_isdst == expected.tm_isdst,
+               "%s at %lli: %04i-%02i-%02i %02i:%02i:%02i dst %i, glibc %04i-%02i-%02i %02i:%02i:%02i dst %i",
+               getenv("TZ"), (long long)timestamp, actual.tm_year + 1900, actual.tm_mon + 1, actual.tm_mday,
+               actual.tm_hour, actual.tm_min, actual.tm_sec, actual.tm_isdst, expected.tm_year + 1900,
+               expected.tm_mon + 1, expected.tm_mday, expected.tm_hour, expected.tm_min, expected.tm_sec,
+               expected.tm_isdst);
+}
+
+
+static void check_to_epoch(const civil_time_zone_t *zone, struct tm tm) {
+    struct tm libc_tm  = tm;
+    time_t    expected = mktime(&libc_tm);
+    if (tm.tm_isdst < 0 && is_repeated(&libc_tm)) {
+        // glibc reads the repeated hour with the offset of its previous call; civil_time always reads daylight time
+        libc_tm.tm_isdst = 1;
+        expected         = mktime(&libc_tm);
+    }
+    int64_t actual = civil_time_to_epoch(zone, &tm);
+
+    TEST_CHECK(actual == (int64_t)expected && tm.tm_isdst == libc_tm.tm_isdst && tm.tm_mday == libc_tm.tm_mday &&
+                   tm.tm_hour == libc_tm.tm_hour,
+               "%s: %04i-%02i-%02i %02i:%02i dst %i: %lli, glibc %lli", getenv("TZ"), tm.tm_year + 1900,
+               tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_isdst, (long long)actual, (long long)expected);
+}
+
+
+/*
+ * Whether the normalized local time occurs twice, once in daylight and once in standard time
+ */
+static int is_repeated(const struct tm *tm) {
+    struct tm standard = *tm, daylight = *tm;
+    standard.tm_isdst  = 0;
+    daylight.tm_isdst  = 1;
+    time_t standard_timestamp = mktime(&standard), daylight_timestamp = mktime(&daylight);
+
+    return standard_timestamp != daylight_timestamp && standard.tm_isdst == 0 && daylight.tm_isdst == 1 &&
+           standard.tm_hour == tm->tm_hour && daylight.tm_hour == tm->tm_hour;
+}
+
+
+/*
+ * Every transition must change the offset, and nothing in between may; the hours around it are sampled densely
+ */
+static void check_transitions(civil_time_zone_t *zone) {
+    civil_time_zone_t copy      = *zone;
+    int64_t           timestamp = civil_time_days_from_civil(FIRST_YEAR, 1, 1) * 86400;
+    int64_t           last      = civil_time_days_from_civil(LAST_YEAR, 1, 1) * 86400;
+    unsigned          count     = 0;
+
+    while (timestamp < last) {
+        civil_time_zone_prepare(&copy, timestamp);
+        int64_t next = civil_time_zone_next_transition(&copy, timestamp);
+        if (next == INT64_MAX) {
+            TEST_CHECK(!copy.has_dst, "%s: no transition after %lli", getenv("TZ"), (long long)timestamp);
+            return;
+        } else if (next >= last) {
+            break;
+        }
+
+        time_t    before = (time_t)(next - 1), after = (time_t)next;
+        struct tm before_tm = {0}, after_tm = {0};
+        localtime_r(&before, &before_tm);
+        localtime_r(&after, &after_tm);
+        if (before_tm.tm_isdst != after_tm.tm_isdst) {
+            count++;
+            for (int64_t sample = next - TRANSITION_MARGIN; sample < next + TRANSITION_MARGIN;
+                 sample += TRANSITION_STEP) {
+                check_sample(zone, sample);
+            }
+        } else {
+            // Only allowed when the zone was prepared for a year that has no transitions left
+            TEST_CHECK(next == timestamp + 86400, "%s: no change at %lli", getenv("TZ"), (long long)next);
+        }
+        timestamp = next;
+    }
+
+    // Two a year
+    TEST_CHECK(count == 2 * (LAST_YEAR - FIRST_YEAR), "%s: %u transitions", getenv("TZ"), count);
+}
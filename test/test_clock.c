@@ -0,0 +1,91 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "services/clock.h"
+#include "test.h"
+
+
+#define CHANGES 2000
+#define READERS 3
+
+
+// Kept by every reader, the checks themselves run on the main thread
+typedef struct {
+    size_t reads;
+    size_t monotonic_back;
+    size_t wall_back;
+} reader_result_t;
+
+
+static void *reader(void *arg);
+
+
+static atomic_int done = 0;
+
+
+/*
+ * The simulator clock is read by every task while the main one changes its speed and moves it forward: neither the
+ * monotonic nor the wall time may ever go back for a reader
+ */
+int main(void) {
+    pthread_t       readers[READERS];
+    reader_result_t results[READERS] = {0};
+    for (size_t i = 0; i < READERS; i++) {
+        pthread_create(&readers[i], NULL, reader, &results[i]);
+    }
+
+    // Every change is logged by the port
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null  = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+
+    time_t target = clock_now() + 3600;
+    for (size_t i = 0; i < CHANGES; i++) {
+        if (i % 2 == 0) {
+            clock_set_speed(1 + i % 1000);
+        } else {
+            target += 60;
+            clock_jump_to(target);
+        }
+    }
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(null);
+    close(saved);
+    atomic_store(&done, 1);
+
+    size_t total = 0;
+    for (size_t i = 0; i < READERS; i++) {
+        pthread_join(readers[i], NULL);
+        TEST_CHECK(results[i].monotonic_back == 0, "reader %zu: monotonic time went back %zu times", i,
+                   results[i].monotonic_back);
+        TEST_CHECK(results[i].wall_back == 0, "reader %zu: wall time went back %zu times", i, results[i].wall_back);
+        total += results[i].reads;
+    }
+
+    TEST_CHECK(clock_get_speed() == 1 + (CHANGES - 2) % 1000, "speed %u", clock_get_speed());
+    TEST_CHECK(clock_now() >= target, "clock at %lli before %lli", (long long)clock_now(), (long long)target);
+    printf("%zu reads\n", total);
+    return test_report("clock");
+}
+
+
+static void *reader(void *arg) {
+    reader_result_t *result = arg;
+    unsigned long    last   = clock_millis();
+    int64_t          wall   = clock_now_millis();
+
+    while (!atomic_load(&done)) {
+        unsigned long millis = clock_millis();
+        int64_t       now_ms = clock_now_millis();
+        result->reads++;
+        result->monotonic_back += millis < last;
+        result->wall_back += now_ms < wall;
+        last = millis;
+        wall = now_ms;
+    }
+    return NULL;
+}
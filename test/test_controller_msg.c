@@ -0,0 +1,55 @@
+#include <string.h>
+#include "view/controller_msg.h"
+#include "test.h"
+
+
+#define SLOTS 4
+
+
+/*
+ * Every slot can be in flight at once, one more is dropped and counted, and a released slot is taken again with the
+ * content of the new message
+ */
+int main(void) {
+    view_controller_msg_t *msgs[SLOTS] = {0};
+    for (size_t i = 0; i < SLOTS; i++) {
+        view_controller_msg_t save = {.tag = VIEW_CONTROLLER_MESSAGE_TAG_SAVE_ALARM, .as.save_alarm.num = i};
+        msgs[i]                    = view_controller_msg(save);
+        TEST_CHECK(msgs[i] != NULL, "slot %zu not given", i);
+    }
+    for (size_t i = 0; i < SLOTS; i++) {
+        TEST_CHECK(msgs[i] != NULL && msgs[i]->tag == VIEW_CONTROLLER_MESSAGE_TAG_SAVE_ALARM &&
+                       msgs[i]->as.save_alarm.num == i,
+                   "message %zu overwritten", i);
+    }
+
+    TEST_CHECK(view_controller_msg((view_controller_msg_t){.tag = VIEW_CONTROLLER_MESSAGE_TAG_RESET}) == NULL,
+               "message past the last slot");
+    view_controller_msg_stats_t stats = view_controller_msg_get_stats();
+    TEST_CHECK(stats.high_water == SLOTS && stats.exhausted == 1, "high water %zu, %u exhausted", stats.high_water,
+               stats.exhausted);
+
+    view_controller_msg_release(msgs[2]);
+    view_controller_msg_t connect = {.tag = VIEW_CONTROLLER_MESSAGE_TAG_CONNECT_TO};
+    strcpy(connect.as.connect_to.ssid, "network");
+    strcpy(connect.as.connect_to.psk, "password");
+    view_controller_msg_t *reused = view_controller_msg(connect);
+    TEST_CHECK(reused == msgs[2] && strcmp(reused->as.connect_to.psk, "password") == 0, "released slot not reused");
+    TEST_CHECK(msgs[1]->as.save_alarm.num == 1 && msgs[3]->as.save_alarm.num == 3, "other slots overwritten");
+
+    // One message at a time, as pman delivers them, never needs more than a slot
+    for (size_t i = 0; i < SLOTS; i++) {
+        view_controller_msg_release(i == 2 ? reused : msgs[i]);
+    }
+    view_controller_msg_t ota = {.tag = VIEW_CONTROLLER_MESSAGE_TAG_OTA};
+    for (size_t i = 0; i < 1000; i++) {
+        view_controller_msg_t *msg = view_controller_msg(ota);
+        TEST_CHECK(msg == msgs[0], "message %zu in another slot", i);
+        view_controller_msg_release(msg);
+    }
+    stats = view_controller_msg_get_stats();
+    TEST_CHECK(stats.high_water == SLOTS && stats.exhausted == 1, "high water %zu, %u exhausted", stats.high_water,
+               stats.exhausted);
+
+    return test_report("controller_msg");
+}
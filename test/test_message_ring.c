@@ -0,0 +1,134 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include "model/message_ring.h"
+#include "test.h"
+
+
+#define MESSAGES 2000000
+#define CAPACITY 8
+#define BATCH    5
+
+
+// Not a power of two in size, every field derives from the sequence number
+typedef struct {
+    uint32_t sequence;
+    uint32_t hash;
+    uint16_t low;
+    uint8_t  tag;
+} message_t;
+
+
+static void      check_bounds(void);
+static void     *producer(void *arg);
+static message_t make_message(uint32_t sequence);
+
+
+static atomic_size_t full = 0;
+
+
+int main(void) {
+    check_bounds();
+
+    message_t      buffer[CAPACITY];
+    message_ring_t ring;
+    message_ring_init(&ring, buffer, sizeof(message_t), CAPACITY);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, &ring);
+
+    // Single and batched pops alternate, so that both meet the producer in every position of the ring
+    uint32_t next      = 0;
+    size_t   corrupted = 0;
+    size_t   reordered = 0;
+    size_t   batches   = 0;
+    while (next < MESSAGES) {
+        message_t items[BATCH];
+        size_t    count = 0;
+        if (next % 3 == 0) {
+            count = message_ring_pop_batch(&ring, items, BATCH);
+            batches += count > 1;
+        } else {
+            count = message_ring_pop(&ring, &items[0]);
+        }
+        if (count == 0) {
+            sched_yield();
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            message_t expected = make_message(items[i].sequence);
+            if (items[i].hash != expected.hash || items[i].low != expected.low || items[i].tag != expected.tag) {
+                corrupted++;
+            }
+            if (items[i].sequence != next) {
+                reordered++;
+            }
+            next = items[i].sequence + 1;
+        }
+    }
+    pthread_join(thread, NULL);
+
+    message_t item;
+    TEST_CHECK(corrupted == 0, "%zu corrupted messages", corrupted);
+    TEST_CHECK(reordered == 0, "%zu messages out of order", reordered);
+    TEST_CHECK(!message_ring_pop(&ring, &item), "message left after the last one");
+    printf("%u messages, %zu batches, producer found the ring full %zu times\n", MESSAGES, batches,
+           atomic_load(&full));
+    return test_report("message_ring");
+}
+
+
+/*
+ * A full ring rejects a message without losing the others, an empty one returns nothing, clearing drops what is
+ * pending
+ */
+static void check_bounds(void) {
+    message_t      buffer[CAPACITY];
+    message_ring_t ring;
+    message_ring_init(&ring, buffer, sizeof(message_t), CAPACITY);
+
+    message_t item = {0};
+    TEST_CHECK(!message_ring_pop(&ring, &item), "message from an empty ring");
+
+    uint32_t pushed = 0;
+    while (message_ring_push(&ring, &(message_t){.sequence = pushed})) {
+        pushed++;
+    }
+    TEST_CHECK(pushed == CAPACITY, "%u messages fit", pushed);
+
+    message_t items[CAPACITY * 2];
+    size_t    count = message_ring_pop_batch(&ring, items, CAPACITY * 2);
+    TEST_CHECK(count == CAPACITY && items[0].sequence == 0 && items[CAPACITY - 1].sequence == CAPACITY - 1,
+               "%zu messages in a batch", count);
+
+    message_ring_push(&ring, &item);
+    message_ring_push(&ring, &item);
+    message_ring_clear(&ring);
+    TEST_CHECK(message_ring_pop_batch(&ring, items, CAPACITY) == 0, "messages left after clearing");
+    TEST_CHECK(message_ring_push(&ring, &item), "push after clearing");
+}
+
+
+static void *producer(void *arg) {
+    message_ring_t *ring = arg;
+
+    for (uint32_t sequence = 0; sequence < MESSAGES; sequence++) {
+        message_t message = make_message(sequence);
+        while (!message_ring_push(ring, &message)) {
+            atomic_fetch_add_explicit(&full, 1, memory_order_relaxed);
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+
+static message_t make_message(uint32_t sequence) {
+    return (message_t){
+        .sequence = sequence,
+        .hash     = sequence * 2654435761U,
+        .low      = (uint16_t)~sequence,
+        .tag      = (uint8_t)(sequence >> 3),
+    };
+}
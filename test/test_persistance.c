@@ -0,0 +1,278 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "controller/persistance.h"
+#include "peripherals/storage.h"
+#include "fake_clock.h"
+#include "fake_storage.h"
+#include "test.h"
+
+
+#define DAY          86400
+#define BOOTS        16
+#define OVERFLOW_RUN 400
+
+
+static model_updater_t boot(time_t now, size_t *loads, double *seconds);
+static void            session(model_updater_t updater, time_t now);
+static int             add_alarm(model_updater_t updater, time_t timestamp, const char *description);
+static void            save_variables(model_t *pmodel);
+static void            save_alarm(model_t *pmodel, size_t alarm_num);
+static void            save_num_alarms(model_t *pmodel);
+static uint8_t         same_config(model_t *first, model_t *second);
+static void            quiet(void);
+static void            loud(void);
+
+
+static int saved_stdout = -1;
+
+
+/*
+ * The configuration found at boot, from the checkpoint and the journal or key by key, against the model it was saved
+ * from: after a session saved as the controller and the observer do, after the journal fills up, with a damaged
+ * checkpoint or journal and when the journal does not replay as recorded
+ */
+int main(void) {
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+    time_t start = 1711627200;     // 2024-03-28 12:00 UTC
+    size_t loads        = 0;
+    double checkpoint_s = 0, keys_s = 0;
+
+    // The first boot finds nothing and leaves a checkpoint for the next
+    fake_storage_clear();
+    model_updater_t updater = boot(start, &loads, &keys_s);
+    model_t        *first   = model_updater_read(updater);
+    TEST_CHECK(first->config.num_alarms == 0, "%u alarms on the first boot", first->config.num_alarms);
+    model_updater_t again = boot(start, &loads, &checkpoint_s);
+    TEST_CHECK(loads == 3, "%zu loads after the first boot", loads);
+    TEST_CHECK(same_config(first, model_updater_read(again)), "the first checkpoint differs");
+
+    // A session, then the same configuration from three blobs
+    updater = again;
+    session(updater, start);
+    model_t *saved = model_updater_read(updater);
+    updater        = boot(start + 60, &loads, &checkpoint_s);
+    TEST_CHECK(loads == 3, "%zu loads from the checkpoint", loads);
+    TEST_CHECK(same_config(saved, model_updater_read(updater)), "the journal did not restore the session");
+
+    // Commands past the size of the journal
+    saved             = model_updater_read(updater);
+    fake_clock_millis = (int64_t)(start + 120) * 1000;
+    size_t  commits    = fake_storage_stats.commits;
+    size_t  alarm_num  = 0;
+    uint8_t brightness = saved->config.normal_brightness;
+    quiet();
+    for (size_t i = 0; i < OVERFLOW_RUN; i++) {
+        alarm_num = i % saved->config.num_alarms;
+        model_updater_set_alarm_time(updater, alarm_num, saved->config.alarms[alarm_num].timestamp + 60);
+        save_alarm(saved, alarm_num);
+        brightness = brightness == 50 ? 60 : 50;
+        model_updater_set_normal_brightness(updater, brightness);
+        persistance_save_variable(&saved->config.normal_brightness, sizeof(saved->config.normal_brightness),
+                                  PERSISTANCE_NORMAL_BRIGHTNESS_KEY);
+    }
+    loud();
+    // One commit per save, the journal or the new checkpoint goes along with it
+    TEST_CHECK(fake_storage_stats.commits - commits == 2 * OVERFLOW_RUN, "%zu commits for %u saves",
+               fake_storage_stats.commits - commits, 2 * OVERFLOW_RUN);
+    updater = boot(start + 180, &loads, &checkpoint_s);
+    TEST_CHECK(loads == 3, "%zu loads after the journal filled up", loads);
+    TEST_CHECK(same_config(saved, model_updater_read(updater)), "the configuration was lost with the full journal");
+
+    // A damaged checkpoint body, then a journal of another checkpoint: both fall back to the keys
+    saved                = model_updater_read(updater);
+    uint8_t garbage[128] = {0};
+    storage_save_blob(garbage, sizeof(garbage), "CKPTBODY");
+    updater = boot(start + 240, &loads, &keys_s);
+    TEST_CHECK(loads > 3, "%zu loads with a damaged checkpoint", loads);
+    TEST_CHECK(same_config(saved, model_updater_read(updater)), "the keys differ from the damaged checkpoint");
+    updater = boot(start + 240, &loads, &checkpoint_s);
+    TEST_CHECK(loads == 3, "%zu loads after the checkpoint was written again", loads);
+
+    saved = model_updater_read(updater);
+    storage_save_blob(garbage, 6, "JOURNAL");
+    updater = boot(start + 300, &loads, &keys_s);
+    TEST_CHECK(loads > 3, "%zu loads with the journal of another checkpoint", loads);
+    TEST_CHECK(same_config(saved, model_updater_read(updater)), "the keys differ from the foreign journal");
+
+    // Ten days later, once the deleted slot is taken, a new alarm takes the slot of an expired one; with the clock
+    // back where it was, the replay would add it at the end
+    fake_clock_millis = (int64_t)(start + 10 * DAY) * 1000;
+    model_updater_refresh_today(updater);
+    saved = model_updater_read(updater);
+    quiet();
+    for (size_t i = 0; i < 2; i++) {
+        alarm_num = add_alarm(updater, start + 11 * DAY, "Reused");
+        save_alarm(saved, alarm_num);
+        save_num_alarms(saved);
+    }
+    loud();
+    TEST_CHECK(alarm_num + 1 < saved->config.num_alarms, "alarm %zu added after %u", alarm_num,
+               saved->config.num_alarms);
+    updater = boot(start + 360, &loads, &keys_s);
+    TEST_CHECK(loads > 3, "%zu loads with a diverging journal", loads);
+    TEST_CHECK(same_config(saved, model_updater_read(updater)), "the diverging journal was applied");
+
+    printf("boot from the checkpoint %.1f us, from every key %.1f us (%u alarms)\n", checkpoint_s * 1e6,
+           keys_s * 1e6, saved->config.num_alarms);
+    return test_report("persistance");
+}
+
+
+/*
+ * Loads the configuration into a new model, as after a restart at `now`
+ */
+static model_updater_t boot(time_t now, size_t *loads, double *seconds) {
+    static struct model models[BOOTS];
+    static size_t       boots  = 0;
+    mut_model_t        *pmodel = &models[boots++];
+
+    fake_clock_millis = (int64_t)now * 1000;
+    civil_time_prepare_local(now);
+    model_updater_t updater = model_updater_init(pmodel);
+    size_t          before  = fake_storage_stats.loads;
+
+    quiet();
+    double begin = test_seconds();
+    persistance_load(updater);
+    *seconds = test_seconds() - begin;
+    loud();
+
+    *loads = fake_storage_stats.loads - before;
+    model_updater_refresh_today(updater);
+    return updater;
+}
+
+
+/*
+ * Every persisted part of the configuration changed through the updater, saved as it changes
+ */
+static void session(model_updater_t updater, time_t now) {
+    model_t *pmodel = model_updater_read(updater);
+
+    quiet();
+    model_updater_set_normal_brightness(updater, 80);
+    model_updater_set_standby_brightness(updater, 10);
+    model_updater_set_standby_delay(updater, 45);
+    model_updater_set_night_mode(updater, 1);
+    model_updater_set_night_mode_start(updater, 23 * 3600);
+    model_updater_set_night_mode_end(updater, 6 * 3600 + 30 * 60);
+    model_updater_set_world_clock_city(updater, 0, 1);
+    model_updater_set_solar_location(updater, 4550, 920);
+    save_variables(pmodel);
+
+    for (size_t i = 0; i < 12; i++) {
+        char description[32] = {0};
+        snprintf(description, sizeof(description), "Session %zu", i);
+        int alarm_num = add_alarm(updater, now + DAY + i * 7 * 3600, description);
+        if (i % 3 == 0) {
+            model_updater_set_alarm_recurrence(updater, alarm_num, ALARM_RECURRENCE_WEEKLY, 0x22);
+        }
+        if (i % 4 == 0) {
+            model_updater_set_alarm_duration(updater, alarm_num, 90);
+        }
+        save_alarm(pmodel, alarm_num);
+        save_num_alarms(pmodel);
+    }
+    model_updater_delete_alarm(updater, 5);
+    save_alarm(pmodel, 5);
+    model_updater_set_alarm_time(updater, 7, now + 3 * DAY);
+    save_alarm(pmodel, 7);
+    loud();
+}
+
+
+static int add_alarm(model_updater_t updater, time_t timestamp, const char *description) {
+    struct tm tm        = civil_time_localtime(timestamp);
+    int       alarm_num = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+    if (alarm_num >= 0) {
+        model_updater_set_alarm_time(updater, alarm_num, timestamp);
+        model_updater_set_alarm_description(updater, alarm_num, description);
+    }
+    return alarm_num;
+}
+
+
+/*
+ * As the observer, which saves only what changed; all of it here
+ */
+static void save_variables(model_t *pmodel) {
+    persistance_save_variable(&pmodel->config.normal_brightness, sizeof(pmodel->config.normal_brightness),
+                              PERSISTANCE_NORMAL_BRIGHTNESS_KEY);
+    persistance_save_variable(&pmodel->config.standby_brightness, sizeof(pmodel->config.standby_brightness),
+                              PERSISTANCE_STANDBY_BRIGHTNESS_KEY);
+    persistance_save_variable(&pmodel->config.standby_delay_seconds, sizeof(pmodel->config.standby_delay_seconds),
+                              PERSISTANCE_STANDBY_DELAY_KEY);
+    persistance_save_variable(&pmodel->config.night_mode, sizeof(pmodel->config.night_mode),
+                              PERSISTANCE_NIGHT_MODE_KEY);
+    persistance_save_variable(&pmodel->config.night_mode_start, sizeof(pmodel->config.night_mode_start),
+                              PERSISTANCE_NIGHT_MODE_START_KEY);
+    persistance_save_variable(&pmodel->config.night_mode_end, sizeof(pmodel->config.night_mode_end),
+                              PERSISTANCE_NIGHT_MODE_END_KEY);
+    persistance_save_variable(&pmodel->config.world_clock, sizeof(pmodel->config.world_clock),
+                              PERSISTANCE_WORLD_CLOCK_KEY);
+    persistance_save_variable(&pmodel->config.solar_schedule, sizeof(pmodel->config.solar_schedule),
+                              PERSISTANCE_SOLAR_SCHEDULE_KEY);
+}
+
+
+/*
+ * As the controller on SAVE_ALARM
+ */
+static void save_alarm(model_t *pmodel, size_t alarm_num) {
+    persistance_save_alarm(pmodel, alarm_num);
+}
+
+
+static void save_num_alarms(model_t *pmodel) {
+    persistance_save_variable(&pmodel->config.num_alarms, sizeof(pmodel->config.num_alarms),
+                              PERSISTANCE_ALARM_NUM_KEY);
+}
+
+
+/*
+ * The persisted configuration, alarms in the same slots
+ */
+static uint8_t same_config(model_t *first, model_t *second) {
+#define SAME(field) (first->config.field == second->config.field)
+    if (!SAME(normal_brightness) || !SAME(standby_brightness) || !SAME(standby_delay_seconds) || !SAME(night_mode) ||
+        !SAME(night_mode_start) || !SAME(night_mode_end) || !SAME(military_time) || !SAME(num_alarms) ||
+        memcmp(&first->config.world_clock, &second->config.world_clock, sizeof(first->config.world_clock)) != 0 ||
+        memcmp(&first->config.solar_schedule, &second->config.solar_schedule, sizeof(first->config.solar_schedule)) !=
+            0) {
+        return 0;
+    }
+#undef SAME
+    for (size_t num = 0; num < first->config.num_alarms; num++) {
+        alarm_t x = model_get_alarm(first, num);
+        alarm_t y = model_get_alarm(second, num);
+        if (x.timestamp != y.timestamp || x.recurrence != y.recurrence || x.weekdays != y.weekdays ||
+            x.duration != y.duration ||
+            strcmp(model_get_alarm_description(first, num), model_get_alarm_description(second, num)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/*
+ * Saves and loads log every key
+ */
+static void quiet(void) {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int null     = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+}
+
+
+static void loud(void) {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
@@ -0,0 +1,97 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "model/model.h"
+#include "controller/snapshot.h"
+#include "test.h"
+
+
+#define PUBLISHES 200000
+#define READERS   3
+
+
+// Kept by every reader, the checks themselves run on the main thread
+typedef struct {
+    size_t   reads;
+    size_t   torn;
+    size_t   backwards;
+    uint32_t torn_state;
+} reader_result_t;
+
+
+static void *reader(void *arg);
+
+
+static atomic_int done = 0;
+
+
+/*
+ * One writer publishes states whose fields all derive from a counter while readers check that every snapshot they
+ * get belongs to a single state, and that states never go back
+ */
+int main(void) {
+    static struct model model;
+    model_init(&model);
+
+    pthread_t       readers[READERS];
+    reader_result_t results[READERS] = {0};
+    for (size_t i = 0; i < READERS; i++) {
+        pthread_create(&readers[i], NULL, reader, &results[i]);
+    }
+
+    for (uint32_t k = 1; k <= PUBLISHES; k++) {
+        model.config.night_mode_start = k;
+        model.config.night_mode_end   = ~k;
+        model.config.num_alarms       = k & 0xFFFF;
+        model.run.ip_addr             = k * 2654435761U;
+        snprintf(model.run.ssid, sizeof(model.run.ssid), "ssid-%u", k);
+        model_touch(&model, MODEL_FIELD_NIGHT_MODE_START);
+        snapshot_publish(&model);
+    }
+    atomic_store(&done, 1);
+
+    size_t total = 0;
+    for (size_t i = 0; i < READERS; i++) {
+        pthread_join(readers[i], NULL);
+        TEST_CHECK(results[i].torn == 0, "reader %zu: %zu torn snapshots, like state %u", i, results[i].torn,
+                   results[i].torn_state);
+        TEST_CHECK(results[i].backwards == 0, "reader %zu: went back %zu times", i, results[i].backwards);
+        total += results[i].reads;
+    }
+
+    model_snapshot_t snapshot = {0};
+    snapshot_read(&snapshot);
+    TEST_CHECK(snapshot.night_mode_start == PUBLISHES, "last state %u not seen", snapshot.night_mode_start);
+    printf("%zu reads, %u retries\n", total, snapshot_get_retries());
+    return test_report("snapshot");
+}
+
+
+static void *reader(void *arg) {
+    reader_result_t *result = arg;
+    uint32_t         last   = 0;
+
+    while (!atomic_load(&done)) {
+        model_snapshot_t snapshot = {0};
+        snapshot_read(&snapshot);
+        result->reads++;
+
+        uint32_t k                   = snapshot.night_mode_start;
+        char     ssid[MAX_SSID_SIZE] = {0};
+        snprintf(ssid, sizeof(ssid), "ssid-%u", k);
+        if (k == 0) {
+            continue;
+        }
+        if (snapshot.night_mode_end != ~k || snapshot.num_alarms != (k & 0xFFFF) ||
+            snapshot.ip_addr != k * 2654435761U || strcmp(snapshot.ssid, ssid) != 0) {
+            result->torn++;
+            result->torn_state = k;
+        }
+        if (k < last) {
+            result->backwards++;
+        }
+        last = k;
+    }
+    return NULL;
+}
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include "model/civil_time.h"
+#include "model/solar.h"
+#include "test.h"
+
+
+// The almanac rounds to the minute and the equation is good to about a minute
+#define TOLERANCE 120
+
+
+typedef struct {
+    const char *place;
+    double      latitude;
+    double      longitude;
+    int32_t     year;
+    uint32_t    month;
+    uint32_t    mday;
+    // Offset of the local times below from UTC, in minutes
+    int32_t     offset;
+    // Local times in minutes after midnight; may exceed a day when the sun sets after midnight
+    int32_t     sunrise;
+    int32_t     sunset;
+} almanac_day_t;
+
+
+#define HM(hours, minutes) ((hours) * 60 + (minutes))
+
+
+static void    check_day(const almanac_day_t *almanac);
+static void    check_polar(void);
+static int64_t local_to_epoch(const almanac_day_t *almanac, int32_t minutes);
+
+
+// Published sunrise and sunset times (USNO / timeanddate.com)
+static const almanac_day_t almanac[] = {
+    {"London", 51.5074, -0.1278, 2024, 6, 20, 60, HM(4, 43), HM(21, 21)},
+    {"London", 51.5074, -0.1278, 2024, 12, 21, 0, HM(8, 4), HM(15, 53)},
+    {"New York", 40.7128, -74.0060, 2024, 6, 20, -240, HM(5, 25), HM(20, 31)},
+    {"New York", 40.7128, -74.0060, 2024, 12, 21, -300, HM(7, 17), HM(16, 32)},
+    {"Sydney", -33.8688, 151.2093, 2024, 6, 21, 600, HM(7, 0), HM(16, 54)},
+    {"Sydney", -33.8688, 151.2093, 2024, 12, 21, 660, HM(5, 41), HM(20, 5)},
+    {"Reykjavik", 64.1466, -21.9426, 2024, 6, 21, 0, HM(2, 55), HM(24, 3)},
+};
+
+
+/*
+ * Compares sunrise and sunset with almanac times for both solstices on both hemispheres, then checks the polar
+ * days where the sun does not cross the horizon
+ */
+int main(void) {
+    for (size_t i = 0; i < sizeof(almanac) / sizeof(almanac[0]); i++) {
+        check_day(&almanac[i]);
+    }
+    check_polar();
+    return test_report("solar");
+}
+
+
+static void check_day(const almanac_day_t *almanac) {
+    solar_day_t day = {0};
+    solar_compute_day(&day, almanac->year, almanac->month, almanac->mday, almanac->latitude, almanac->longitude);
+
+    int64_t sunrise = local_to_epoch(almanac, almanac->sunrise);
+    int64_t sunset  = local_to_epoch(almanac, almanac->sunset);
+    TEST_CHECK(llabs(day.sunrise - sunrise) <= TOLERANCE, "%s %04i-%02u-%02u: sunrise off by %lli s", almanac->place,
+               almanac->year, almanac->month, almanac->mday, (long long)(day.sunrise - sunrise));
+    TEST_CHECK(llabs(day.sunset - sunset) <= TOLERANCE, "%s %04i-%02u-%02u: sunset off by %lli s", almanac->place,
+               almanac->year, almanac->month, almanac->mday, (long long)(day.sunset - sunset));
+
+    TEST_CHECK(day.dawn < day.sunrise && day.sunrise < day.noon && day.noon < day.sunset && day.sunset < day.dusk,
+               "%s %04i-%02u-%02u: events out of order", almanac->place, almanac->year, almanac->month,
+               almanac->mday);
+}
+
+
+/*
+ * Tromsø has midnight sun at the June solstice and polar night at the December one
+ */
+static void check_polar(void) {
+    solar_day_t day = {0};
+
+    solar_compute_day(&day, 2024, 6, 21, 69.6492, 18.9553);
+    TEST_CHECK(day.sunrise == day.noon - 43200 && day.sunset == day.noon + 43200, "Tromsø: no midnight sun");
+
+    solar_compute_day(&day, 2024, 12, 21, 69.6492, 18.9553);
+    TEST_CHECK(day.sunrise == day.noon && day.sunset == day.noon, "Tromsø: no polar night");
+    // The civil twilight still happens around noon
+    TEST_CHECK(day.dawn < day.noon && day.dusk > day.noon, "Tromsø: no twilight in the polar night");
+}
+
+
+static int64_t local_to_epoch(const almanac_day_t *almanac, int32_t minutes) {
+    return civil_time_days_from_civil(almanac->year, almanac->month, almanac->mday) * 86400 +
+           (int64_t)(minutes - almanac->offset) * 60;
+}
@@ -0,0 +1,349 @@
+#include <limits.h>
+#include "controller/timer_wheel.h"
+#include "test.h"
+
+
+#define RANDOM_JOBS      200
+#define RANDOM_RESTARTS  5
+// Long enough for the jobs parked past the range of the wheel
+#define RANDOM_MAX_DELAY (60UL * 60 * 60 * 1000)
+// Ticks covered by the whole wheel, about 46.6 hours
+#define WHEEL_RANGE_MS   ((1UL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) * TIMER_WHEEL_TICK_MS)
+
+
+typedef struct {
+    timer_wheel_job_t     job;
+    timer_wheel_outcome_t outcome;
+    unsigned long         due;            // When the job should run next, ULONG_MAX if it should not
+    unsigned long         runs[8];        // When it ran, up to the size of the array
+    size_t                count;
+    size_t                restarts;
+} probe_t;
+
+
+static void                  check_random(void);
+static void                  check_cascade(void);
+static void                  check_range(void);
+static void                  check_retry(void);
+static void                  check_pending(void);
+static void                  check_jitter(void);
+static void                  check_timeout(void);
+static void                  advance(timer_wheel_t *wheel, unsigned long to);
+static unsigned long         due_after(unsigned long now, unsigned long delay);
+static uint32_t              next_random(void);
+static timer_wheel_outcome_t probe_cb(void *arg);
+static timer_wheel_outcome_t restart_cb(void *arg);
+
+
+static timer_wheel_t wheel;
+// Time of the dispatch in progress, and of the previous one
+static unsigned long now           = 0;
+static unsigned long last_dispatch = 0;
+static uint32_t      seed          = 12345;
+
+
+int main(void) {
+    check_random();
+    check_cascade();
+    check_range();
+    check_retry();
+    check_pending();
+    check_jitter();
+    check_timeout();
+    return test_report("timer_wheel");
+}
+
+
+/*
+ * Jobs with random delays, restarted from their callbacks, against a list of their deadlines: every one must run at
+ * the first dispatch past its deadline and get_timeout must always point at the earliest one
+ */
+static void check_random(void) {
+    static probe_t probes[RANDOM_JOBS];
+    now = last_dispatch = 0;
+    timer_wheel_init(&wheel, now);
+
+    for (size_t i = 0; i < RANDOM_JOBS; i++) {
+        probes[i]          = (probe_t){.outcome = TIMER_WHEEL_JOB_STOP};
+        timer_wheel_job_init(&probes[i].job, restart_cb, &probes[i], 0, 0, 0, 0);
+        unsigned long delay = 1 + next_random() % RANDOM_MAX_DELAY;
+        probes[i].due       = due_after(now, delay);
+        timer_wheel_start(&wheel, &probes[i].job, delay, now);
+    }
+
+    for (;;) {
+        unsigned long earliest = ULONG_MAX;
+        for (size_t i = 0; i < RANDOM_JOBS; i++) {
+            if (probes[i].due < earliest) {
+                earliest = probes[i].due;
+            }
+        }
+
+        unsigned long timeout = timer_wheel_get_timeout(&wheel, now);
+        if (earliest == ULONG_MAX) {
+            TEST_CHECK(timeout == ULONG_MAX, "timeout %lu with no job armed", timeout);
+            break;
+        }
+        TEST_CHECK(timeout == earliest - now, "timeout %lu at %lu, earliest deadline %lu", timeout, now, earliest);
+
+        // Mostly short steps, with the occasional sleep of hours that crosses several levels at once
+        uint32_t      kind = next_random() % 8;
+        unsigned long step = kind == 0 ? next_random() % (8UL * 60 * 60 * 1000) : 1 + next_random() % 5000;
+        // Sometimes exactly to the deadline, as the loop does when it sleeps for the timeout
+        advance(&wheel, kind == 1 ? earliest : now + step);
+    }
+
+    for (size_t i = 0; i < RANDOM_JOBS; i++) {
+        TEST_CHECK(probes[i].count == RANDOM_RESTARTS + 1, "job %zu ran %zu times", i, probes[i].count);
+    }
+}
+
+
+/*
+ * Deadlines around the boundaries of every level, each with the wheel at a different phase
+ */
+static void check_cascade(void) {
+    static const unsigned long ticks[] = {
+        1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145, 16777215,
+    };
+    static const unsigned long phases[] = {0, 10, 630, 640, 40950, 2621430};
+
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+        for (size_t t = 0; t < sizeof(ticks) / sizeof(ticks[0]); t++) {
+            probe_t probe = {.outcome = TIMER_WHEEL_JOB_STOP};
+            now = last_dispatch = 0;
+            timer_wheel_init(&wheel, now);
+            advance(&wheel, phases[p]);
+
+            unsigned long delay = ticks[t] * TIMER_WHEEL_TICK_MS;
+            probe.due           = due_after(now, delay);
+            timer_wheel_job_init(&probe.job, probe_cb, &probe, 0, 0, 0, 0);
+            timer_wheel_start(&wheel, &probe.job, delay, now);
+
+            // One tick at a time across the deadline, the rest at once
+            advance(&wheel, probe.due - TIMER_WHEEL_TICK_MS);
+            TEST_CHECK(probe.count == 0, "%lu ticks at phase %lu: ran early", ticks[t], phases[p]);
+            advance(&wheel, probe.due);
+            TEST_CHECK(probe.count == 1 && probe.runs[0] == probe.due, "%lu ticks at phase %lu: ran %zu times",
+                       ticks[t], phases[p], probe.count);
+        }
+    }
+}
+
+
+/*
+ * Jobs past the 46.6 hours the levels cover are parked in the farthest slot and still run on time
+ */
+static void check_range(void) {
+    static const unsigned long delays[] = {
+        WHEEL_RANGE_MS - TIMER_WHEEL_TICK_MS,
+        WHEEL_RANGE_MS,
+        WHEEL_RANGE_MS + TIMER_WHEEL_TICK_MS,
+        50UL * 60 * 60 * 1000,
+        7UL * 24 * 60 * 60 * 1000,
+    };
+
+    for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        probe_t probe = {.outcome = TIMER_WHEEL_JOB_STOP};
+        now = last_dispatch = 0;
+        timer_wheel_init(&wheel, now);
+        advance(&wheel, 12345);
+
+        probe.due = due_after(now, delays[i]);
+        timer_wheel_job_init(&probe.job, probe_cb, &probe, 0, 0, 0, 0);
+        timer_wheel_start(&wheel, &probe.job, delays[i], now);
+        TEST_CHECK(timer_wheel_get_timeout(&wheel, now) <= probe.due - now, "%lu ms: timeout past the deadline",
+                   delays[i]);
+
+        // Waking up at every timeout, as the main loop does
+        while (probe.count == 0 && now < probe.due) {
+            advance(&wheel, now + timer_wheel_get_timeout(&wheel, now));
+        }
+        TEST_CHECK(probe.count == 1 && probe.runs[0] == probe.due, "%lu ms: ran %zu times, at %lu instead of %lu",
+                   delays[i], probe.count, probe.runs[0], probe.due);
+    }
+}
+
+
+/*
+ * Failures run again after a delay that doubles up to the maximum, a success goes back to the period
+ */
+static void check_retry(void) {
+    probe_t probe = {.outcome = TIMER_WHEEL_JOB_FAILED};
+    now = last_dispatch = 0;
+    timer_wheel_init(&wheel, now);
+    timer_wheel_job_init(&probe.job, probe_cb, &probe, 5000, 0, 100, 800);
+    timer_wheel_start(&wheel, &probe.job, 1000, now);
+
+    static const unsigned long expected[] = {1000, 1100, 1300, 1700, 2500, 3300};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        advance(&wheel, now + timer_wheel_get_timeout(&wheel, now));
+    }
+    probe.outcome = TIMER_WHEEL_JOB_DONE;
+    advance(&wheel, now + timer_wheel_get_timeout(&wheel, now));
+    probe.outcome = TIMER_WHEEL_JOB_FAILED;
+    advance(&wheel, now + timer_wheel_get_timeout(&wheel, now));
+
+    TEST_CHECK(probe.count == 8, "ran %zu times", probe.count);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_CHECK(probe.runs[i] == expected[i], "run %zu at %lu instead of %lu", i, probe.runs[i], expected[i]);
+    }
+    // The retry that succeeds goes back to the period and resets the retry delay
+    TEST_CHECK(probe.runs[6] == 4100, "success at %lu", probe.runs[6]);
+    TEST_CHECK(probe.runs[7] == 9100, "first failure after the success at %lu", probe.runs[7]);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, now) == 100, "retry after %lu", timer_wheel_get_timeout(&wheel, now));
+    timer_wheel_stop(&wheel, &probe.job);
+
+    // Without a retry delay failures count as successes
+    probe_t plain = {.outcome = TIMER_WHEEL_JOB_FAILED};
+    timer_wheel_job_init(&plain.job, probe_cb, &plain, 5000, 0, 0, 0);
+    timer_wheel_start(&wheel, &plain.job, 0, now);
+    advance(&wheel, now + TIMER_WHEEL_TICK_MS);
+    TEST_CHECK(plain.count == 1 && timer_wheel_get_timeout(&wheel, now) == 5000, "failure without retry after %lu",
+               timer_wheel_get_timeout(&wheel, now));
+    timer_wheel_stop(&wheel, &plain.job);
+}
+
+
+/*
+ * A pending job is armed for its period, and timer_wheel_complete moves it to count from the completion
+ */
+static void check_pending(void) {
+    probe_t probe = {.outcome = TIMER_WHEEL_JOB_PENDING};
+    now = last_dispatch = 0;
+    timer_wheel_init(&wheel, now);
+    timer_wheel_job_init(&probe.job, probe_cb, &probe, 10000, 0, 500, 4000);
+    timer_wheel_start(&wheel, &probe.job, 1000, now);
+
+    advance(&wheel, 1000);
+    TEST_CHECK(probe.count == 1 && timer_wheel_get_timeout(&wheel, now) == 10000, "pending job not armed");
+
+    // The request fails 2.5 s later
+    advance(&wheel, 3500);
+    timer_wheel_complete(&wheel, &probe.job, TIMER_WHEEL_JOB_FAILED, now);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, now) == 500, "retry after %lu", timer_wheel_get_timeout(&wheel, now));
+
+    // Then it fails again, 55 ms into a tick
+    advance(&wheel, 4000);
+    TEST_CHECK(probe.count == 2, "retry did not run");
+    advance(&wheel, 4055);
+    timer_wheel_complete(&wheel, &probe.job, TIMER_WHEEL_JOB_FAILED, now);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, now) == 1005, "second retry after %lu",
+               timer_wheel_get_timeout(&wheel, now));
+
+    // And succeeds before the retry, which settles the period from the completion
+    advance(&wheel, 5000);
+    timer_wheel_complete(&wheel, &probe.job, TIMER_WHEEL_JOB_DONE, now);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, now) == 10000, "period after %lu",
+               timer_wheel_get_timeout(&wheel, now));
+
+    // A job that runs once is disarmed by a late success
+    probe_t once = {.outcome = TIMER_WHEEL_JOB_PENDING};
+    timer_wheel_job_init(&once.job, probe_cb, &once, 0, 0, 0, 0);
+    timer_wheel_start(&wheel, &once.job, 10, now);
+    advance(&wheel, now + 10);
+    TEST_CHECK(once.count == 1 && !timer_wheel_is_armed(&once.job), "job that runs once still armed");
+    timer_wheel_complete(&wheel, &once.job, TIMER_WHEEL_JOB_DONE, now);
+    TEST_CHECK(!timer_wheel_is_armed(&once.job), "job that runs once armed by the completion");
+    timer_wheel_stop(&wheel, &probe.job);
+}
+
+
+/*
+ * Periods stay within the jitter and do spread
+ */
+static void check_jitter(void) {
+    probe_t       probe = {.outcome = TIMER_WHEEL_JOB_DONE};
+    unsigned long shortest = ULONG_MAX, longest = 0, previous = 0;
+    now = last_dispatch = 0;
+    timer_wheel_init(&wheel, now);
+    timer_wheel_job_init(&probe.job, probe_cb, &probe, 1000, 200, 0, 0);
+    timer_wheel_start(&wheel, &probe.job, 1000, now);
+
+    for (size_t i = 0; i < 1000; i++) {
+        advance(&wheel, now + timer_wheel_get_timeout(&wheel, now));
+        if (i > 0) {
+            unsigned long period = now - previous;
+            shortest             = period < shortest ? period : shortest;
+            longest              = period > longest ? period : longest;
+        }
+        previous = now;
+    }
+
+    TEST_CHECK(shortest >= 1000 && longest <= 1200, "periods between %lu and %lu", shortest,
+               longest);
+    TEST_CHECK(shortest < 1050 && longest > 1150, "periods only between %lu and %lu", shortest, longest);
+    timer_wheel_stop(&wheel, &probe.job);
+}
+
+
+/*
+ * The timeout counts from `now` even when it is not on a tick, and is 0 for an overdue job
+ */
+static void check_timeout(void) {
+    probe_t probe = {.outcome = TIMER_WHEEL_JOB_STOP};
+    now = last_dispatch = 0;
+    timer_wheel_init(&wheel, now);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, now) == ULONG_MAX, "timeout with no job");
+
+    timer_wheel_job_init(&probe.job, probe_cb, &probe, 0, 0, 0, 0);
+    timer_wheel_start(&wheel, &probe.job, 500, now);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, 0) == 500, "timeout %lu", timer_wheel_get_timeout(&wheel, 0));
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, 123) == 377, "timeout %lu", timer_wheel_get_timeout(&wheel, 123));
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, 900) == 0, "overdue timeout %lu", timer_wheel_get_timeout(&wheel, 900));
+
+    timer_wheel_stop(&wheel, &probe.job);
+    TEST_CHECK(timer_wheel_get_timeout(&wheel, now) == ULONG_MAX, "timeout after stopping");
+    advance(&wheel, 1000);
+    TEST_CHECK(probe.count == 0, "stopped job ran");
+}
+
+
+static void advance(timer_wheel_t *wheel, unsigned long to) {
+    last_dispatch = now;
+    now           = to;
+    timer_wheel_dispatch(wheel, now);
+}
+
+
+/*
+ * Deadlines are rounded up to the next tick of the wheel, which started at 0
+ */
+static unsigned long due_after(unsigned long now, unsigned long delay) {
+    return (now + delay + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS * TIMER_WHEEL_TICK_MS;
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+
+static timer_wheel_outcome_t probe_cb(void *arg) {
+    probe_t *probe = arg;
+    if (probe->count < sizeof(probe->runs) / sizeof(probe->runs[0])) {
+        probe->runs[probe->count] = now;
+    }
+    probe->count++;
+    return probe->outcome;
+}
+
+
+static timer_wheel_outcome_t restart_cb(void *arg) {
+    probe_t *probe = arg;
+    TEST_CHECK(probe->due <= now && last_dispatch < probe->due, "due at %lu, ran at %lu after a dispatch at %lu",
+               probe->due, now, last_dispatch);
+
+    probe_cb(probe);
+    if (probe->restarts++ < RANDOM_RESTARTS) {
+        unsigned long delay = 1 + next_random() % RANDOM_MAX_DELAY;
+        probe->due          = due_after(now, delay);
+        timer_wheel_start(&wheel, &probe->job, delay, now);
+    } else {
+        probe->due = ULONG_MAX;
+    }
+    return probe->outcome;
+}
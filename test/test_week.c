@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+#include "config/app_config.h"
+#include "model/model.h"
+#include "model/updater.h"
+#include "fake_clock.h"
+#include "test.h"
+
+
+#define DAYS         7
+#define SINGLES      80
+#define MAX_EXPECTED 256
+#define MAX_EDGES    (4 * DAYS)
+
+
+typedef struct {
+    size_t   num;
+    uint64_t at;
+} due_t;
+
+
+static int      add_alarm(model_updater_t updater, time_t timestamp, alarm_recurrence_t recurrence, uint8_t weekdays);
+static size_t   expected_alarms(model_t *pmodel, time_t start, due_t *expected);
+static int      due_precedes(const void *first, const void *second);
+static time_t   local(int year, int month, int day, int hour, int minute);
+static uint32_t next_random(void);
+
+
+static uint32_t seed = 12345;
+
+
+/*
+ * A week across the DST change of the 31st, second by second as the controller loop sees it: the alarms that come
+ * due, the night mode window opening and closing and the standby brightness following it, all from the model alone.
+ * Midweek its end is moved back, as from the settings page, while it is open: it closes right away and then at the
+ * new end
+ */
+int main(void) {
+    static struct model model;
+    civil_time_set_local(APP_CONFIG_TIMEZONE);
+
+    time_t start      = local(2024, 3, 27, 12, 0);
+    time_t moved      = local(2024, 3, 30, 6, 30);
+    fake_clock_millis = (int64_t)start * 1000;
+    civil_time_prepare_local(start);
+
+    model_updater_t updater = model_updater_init(&model);
+    model_updater_set_night_mode(updater, 1);
+    model_updater_set_night_mode_start(updater, 22 * 3600 + 30 * 60);
+    model_updater_set_night_mode_end(updater, 7 * 3600);
+    for (size_t i = 0; i < SINGLES; i++) {
+        add_alarm(updater, start + 60 + (next_random() % (DAYS * 24 * 60)) * 60, ALARM_RECURRENCE_NONE, 0);
+    }
+    add_alarm(updater, local(2024, 3, 27, 6, 30), ALARM_RECURRENCE_DAILY, 0);
+    add_alarm(updater, local(2024, 3, 28, 7, 15), ALARM_RECURRENCE_WEEKDAYS, 0);
+    add_alarm(updater, local(2024, 3, 30, 2, 30), ALARM_RECURRENCE_WEEKLY, 0x41);     // Saturday and Sunday
+
+    due_t  expected[MAX_EXPECTED];
+    size_t expected_count = expected_alarms(&model, start, expected);
+
+    // The window opens the second after its start and closes at its end, in local time
+    uint64_t expected_edges[MAX_EDGES];
+    size_t   expected_edge_count = 0;
+    for (int day = 0; day < DAYS; day++) {
+        int    mday   = 28 + day;
+        time_t closes = mday < 30 ? local(2024, 3, mday, 7, 0) : mday == 30 ? moved : local(2024, 3, mday, 6, 0);
+        expected_edges[expected_edge_count++] = local(2024, 3, 27 + day, 22, 30) + 1;
+        expected_edges[expected_edge_count++] = closes;
+    }
+
+    due_t    notified[MAX_EXPECTED];
+    size_t   notified_count = 0;
+    uint64_t edges[MAX_EDGES];
+    size_t   edge_count = 0;
+    size_t   mismatched = 0;
+    size_t   alarm_num  = SIZE_MAX;
+    uint64_t checked    = start;
+    uint64_t end        = start + DAYS * 86400;
+    uint8_t  active     = model.run.night.active;
+    uint8_t  brightness = model_get_standby_brightness(&model, start);
+
+    double begin = test_seconds();
+    for (uint64_t now = start + 1; now <= end; now++) {
+        fake_clock_millis = (int64_t)now * 1000;
+        if (now == (uint64_t)moved) {
+            model_updater_set_night_mode_end(updater, 6 * 3600);
+        }
+
+        // As the controller loop
+        model_updater_refresh_today(updater);
+        model_updater_refresh_night_mode(updater);
+
+        uint64_t occurrence = checked;
+        while (model_get_following_alarm(&model, &alarm_num, &occurrence) && occurrence <= now) {
+            if (notified_count < MAX_EXPECTED) {
+                notified[notified_count++] = (due_t){.num = alarm_num, .at = now};
+            }
+        }
+        alarm_num = SIZE_MAX;
+        checked   = now;
+
+        if (model.run.night.active != active) {
+            active = model.run.night.active;
+            if (edge_count < MAX_EDGES) {
+                edges[edge_count++] = now;
+            }
+        }
+        uint8_t standby = model_get_standby_brightness(&model, now);
+        if (standby != (active ? 0 : model.config.standby_brightness)) {
+            mismatched++;
+        }
+        brightness = standby;
+    }
+    double elapsed = test_seconds() - begin;
+
+    TEST_CHECK(notified_count == expected_count, "%zu alarms due, %zu expected", notified_count, expected_count);
+    size_t wrong = 0;
+    for (size_t i = 0; i < notified_count && i < expected_count; i++) {
+        if (notified[i].num != expected[i].num || notified[i].at != expected[i].at) {
+            if (wrong++ == 0) {
+                TEST_CHECK(0, "alarm %zu due at %llu, alarm %zu found at %llu", expected[i].num,
+                           (unsigned long long)expected[i].at, notified[i].num, (unsigned long long)notified[i].at);
+            }
+        }
+    }
+    TEST_CHECK(wrong == 0, "%zu alarms due at the wrong time", wrong);
+
+    TEST_CHECK(edge_count == expected_edge_count, "%zu night mode edges, %zu expected", edge_count,
+               expected_edge_count);
+    for (size_t i = 0; i < edge_count && i < expected_edge_count; i++) {
+        TEST_CHECK(edges[i] == expected_edges[i], "night mode edge %zu at %llu instead of %llu", i,
+                   (unsigned long long)edges[i], (unsigned long long)expected_edges[i]);
+    }
+    TEST_CHECK(mismatched == 0, "standby brightness wrong for %zu seconds", mismatched);
+    TEST_CHECK(brightness == model.config.standby_brightness, "standby brightness %u at noon", brightness);
+
+    printf("%u seconds, %zu alarms due, %zu night mode edges, %.1f ms\n", DAYS * 86400, notified_count, edge_count,
+           elapsed * 1e3);
+    return test_report("week");
+}
+
+
+static int add_alarm(model_updater_t updater, time_t timestamp, alarm_recurrence_t recurrence, uint8_t weekdays) {
+    struct tm tm        = civil_time_localtime(timestamp);
+    int       alarm_num = model_updater_add_alarm(updater, tm.tm_mday, tm.tm_mon, tm.tm_year);
+    if (alarm_num >= 0) {
+        model_updater_set_alarm_time(updater, alarm_num, timestamp);
+        model_updater_set_alarm_recurrence(updater, alarm_num, recurrence, weekdays);
+    }
+    return alarm_num;
+}
+
+
+/*
+ * Every occurrence within the week after `start`, by time and then by number. Recurring alarms keep their local time
+ * across the DST change
+ */
+static size_t expected_alarms(model_t *pmodel, time_t start, due_t *expected) {
+    size_t count = 0;
+    for (size_t num = 0; num < pmodel->config.num_alarms; num++) {
+        const alarm_t *alarm = &pmodel->config.alarms[num];
+        if (alarm->recurrence == ALARM_RECURRENCE_NONE) {
+            if (alarm->timestamp > (uint64_t)start && alarm->timestamp <= (uint64_t)start + DAYS * 86400) {
+                expected[count++] = (due_t){.num = num, .at = alarm->timestamp};
+            }
+            continue;
+        }
+
+        struct tm alarm_tm = civil_time_localtime(alarm->timestamp);
+        for (int day = 0; day <= DAYS; day++) {
+            time_t    at     = local(2024, 3, 27 + day, alarm_tm.tm_hour, alarm_tm.tm_min);
+            struct tm day_tm = civil_time_localtime(at);
+            if (at > start && at <= start + DAYS * 86400 && at >= (time_t)alarm->timestamp &&
+                model_alarm_occurs_on(alarm, &day_tm)) {
+                expected[count++] = (due_t){.num = num, .at = at};
+            }
+        }
+    }
+    qsort(expected, count, sizeof(due_t), due_precedes);
+    return count;
+}
+
+
+static int due_precedes(const void *first, const void *second) {
+    const due_t *a = first, *b = second;
+    if (a->at != b->at) {
+        return a->at < b->at ? -1 : 1;
+    }
+    return a->num < b->num ? -1 : a->num > b->num;
+}
+
+
+static time_t local(int year, int month, int day, int hour, int minute) {
+    struct tm tm = {
+        .tm_year  = year - 1900,
+        .tm_mon   = month - 1,
+        .tm_mday  = day,
+        .tm_hour  = hour,
+        .tm_min   = minute,
+        .tm_isdst = -1,
+    };
+    return civil_time_mktime(&tm);
+}
+
+
+static uint32_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}